@@ -0,0 +1,528 @@
+/* Benchmark for the open, parse, render and encode phases of libgxps
+ *
+ * Copyright (C) 2026  libgxps contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <cairo.h>
+#include <locale.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include <libgxps/gxps.h>
+
+/* Built with the library objects, to compare internal implementations */
+#include "gxps-private.h"
+
+/* Every phase is timed on its own so that a regression can be pinned to
+ * the code that caused it:
+ *
+ *  open:     gxps_file_new(), opening the archive and parsing the
+ *            FixedDocumentSequence
+ *  document: gxps_file_get_document(), parsing the FixedDocument page table
+ *  page:     gxps_document_get_page(), parsing the FixedPage resources
+ *  links:    gxps_page_get_links(), parsing the FixedPage again to get the
+ *            link areas
+ *  links-cairo: the same with _gxps_page_get_links_with_cairo(), which
+ *            measures every link path by building it on a recording
+ *            surface, to compare with the bounds computed without cairo
+ *  render:   gxps_page_render() to an image surface
+ *  encode:   writing the rendered surface as PNG to a null sink
+ *
+ * The results are printed as JSON with the percentiles of every phase in
+ * milliseconds.
+ */
+
+typedef enum {
+        PHASE_OPEN,
+        PHASE_DOCUMENT,
+        PHASE_PAGE,
+        PHASE_LINKS,
+        PHASE_LINKS_CAIRO,
+        PHASE_RENDER,
+        PHASE_ENCODE,
+        N_PHASES
+} BenchPhase;
+
+static const gchar *phase_names[N_PHASES] = {
+        "open",
+        "document",
+        "page",
+        "links",
+        "links-cairo",
+        "render",
+        "encode"
+};
+
+typedef struct {
+        gchar  *filename;
+        guint   n_documents;
+        guint   n_pages;
+        GArray *samples[N_PHASES];
+        guint64 encoded_bytes;
+        gchar  *error;
+} BenchFile;
+
+static gint      iterations = 10;
+static gint      warmup = 1;
+static gdouble   resolution = 96.0;
+static gint      max_pages = 0;
+static gboolean  no_encode = FALSE;
+static gchar    *output_filename = NULL;
+static gchar   **filenames = NULL;
+
+static const GOptionEntry options[] =
+{
+        { "iterations", 'n', 0, G_OPTION_ARG_INT, &iterations, "number of timed iterations [default: 10]", "N" },
+        { "warmup", 'w', 0, G_OPTION_ARG_INT, &warmup, "number of untimed iterations run first [default: 1]", "N" },
+        { "resolution", 'r', 0, G_OPTION_ARG_DOUBLE, &resolution, "render resolution in pixels per inch [default: 96]", "DPI" },
+        { "max-pages", 'p', 0, G_OPTION_ARG_INT, &max_pages, "only benchmark the first N pages of every document [default: all]", "N" },
+        { "no-encode", '\0', 0, G_OPTION_ARG_NONE, &no_encode, "do not time the encode phase", NULL },
+        { "output", 'o', 0, G_OPTION_ARG_FILENAME, &output_filename, "write the results to FILE instead of stdout", "FILE" },
+        { G_OPTION_REMAINING, '\0', 0, G_OPTION_ARG_FILENAME_ARRAY, &filenames, NULL, NULL },
+        { NULL }
+};
+
+static BenchFile *
+bench_file_new (const gchar *filename)
+{
+        BenchFile *bench;
+        guint      i;
+
+        bench = g_slice_new0 (BenchFile);
+        bench->filename = g_strdup (filename);
+        for (i = 0; i < N_PHASES; i++)
+                bench->samples[i] = g_array_new (FALSE, FALSE, sizeof (gdouble));
+
+        return bench;
+}
+
+static void
+bench_file_free (BenchFile *bench)
+{
+        guint i;
+
+        if (G_UNLIKELY (!bench))
+                return;
+
+        g_free (bench->filename);
+        g_free (bench->error);
+        for (i = 0; i < N_PHASES; i++)
+                g_array_free (bench->samples[i], TRUE);
+
+        g_slice_free (BenchFile, bench);
+}
+
+static void
+bench_file_add_sample (BenchFile *bench,
+                       BenchPhase phase,
+                       gint64     start,
+                       gboolean   record)
+{
+        gdouble ms;
+
+        if (!record)
+                return;
+
+        ms = (g_get_monotonic_time () - start) / 1000.0;
+        g_array_append_val (bench->samples[phase], ms);
+}
+
+static cairo_status_t
+null_write_func (void                *closure,
+                 const unsigned char *data,
+                 unsigned int         length)
+{
+        *(guint64 *)closure += length;
+
+        return CAIRO_STATUS_SUCCESS;
+}
+
+static gboolean
+bench_page (BenchFile    *bench,
+            GXPSDocument *doc,
+            guint         n_page,
+            gboolean      record,
+            GError      **error)
+{
+        GXPSPage        *page;
+        cairo_surface_t *surface;
+        cairo_t         *cr;
+        gdouble          page_width, page_height;
+        gint             width, height;
+        GList           *links;
+        gint64           start;
+        guint64          n_bytes = 0;
+        GError          *err = NULL;
+
+        start = g_get_monotonic_time ();
+        page = gxps_document_get_page (doc, n_page, error);
+        if (!page)
+                return FALSE;
+        bench_file_add_sample (bench, PHASE_PAGE, start, record);
+
+        start = g_get_monotonic_time ();
+        links = gxps_page_get_links (page, &err);
+        g_list_free_full (links, (GDestroyNotify)gxps_link_free);
+        if (err) {
+                g_propagate_error (error, err);
+                g_object_unref (page);
+
+                return FALSE;
+        }
+        bench_file_add_sample (bench, PHASE_LINKS, start, record);
+
+        /* The links are not cached this way */
+        start = g_get_monotonic_time ();
+        links = _gxps_page_get_links_with_cairo (page, &err);
+        g_list_free_full (links, (GDestroyNotify)gxps_link_free);
+        if (err) {
+                g_propagate_error (error, err);
+                g_object_unref (page);
+
+                return FALSE;
+        }
+        bench_file_add_sample (bench, PHASE_LINKS_CAIRO, start, record);
+
+        gxps_page_get_size (page, &page_width, &page_height);
+        width = MAX (1, (gint) ceil (page_width * resolution / 96.0));
+        height = MAX (1, (gint) ceil (page_height * resolution / 96.0));
+
+        start = g_get_monotonic_time ();
+        surface = cairo_image_surface_create (CAIRO_FORMAT_RGB24, width, height);
+        cr = cairo_create (surface);
+        cairo_set_source_rgb (cr, 1., 1., 1.);
+        cairo_paint (cr);
+        cairo_scale (cr, resolution / 96.0, resolution / 96.0);
+        if (!gxps_page_render (page, cr, error)) {
+                cairo_destroy (cr);
+                cairo_surface_destroy (surface);
+                g_object_unref (page);
+
+                return FALSE;
+        }
+        cairo_destroy (cr);
+        cairo_surface_flush (surface);
+        bench_file_add_sample (bench, PHASE_RENDER, start, record);
+
+#ifdef CAIRO_HAS_PNG_FUNCTIONS
+        if (!no_encode) {
+                start = g_get_monotonic_time ();
+                cairo_surface_write_to_png_stream (surface, null_write_func, &n_bytes);
+                bench_file_add_sample (bench, PHASE_ENCODE, start, record);
+                if (record)
+                        bench->encoded_bytes += n_bytes;
+        }
+#endif
+
+        cairo_surface_destroy (surface);
+        g_object_unref (page);
+
+        return TRUE;
+}
+
+static gboolean
+bench_iteration (BenchFile *bench,
+                 gboolean   record,
+                 GError   **error)
+{
+        GFile    *file;
+        GXPSFile *xps;
+        guint     n_docs, n_doc;
+        gint64    start;
+
+        file = g_file_new_for_commandline_arg (bench->filename);
+        start = g_get_monotonic_time ();
+        xps = gxps_file_new (file, error);
+        g_object_unref (file);
+        if (!xps)
+                return FALSE;
+        bench_file_add_sample (bench, PHASE_OPEN, start, record);
+
+        n_docs = gxps_file_get_n_documents (xps);
+        bench->n_documents = n_docs;
+        bench->n_pages = 0;
+
+        for (n_doc = 0; n_doc < n_docs; n_doc++) {
+                GXPSDocument *doc;
+                guint         n_pages, n_page;
+
+                start = g_get_monotonic_time ();
+                doc = gxps_file_get_document (xps, n_doc, error);
+                if (!doc) {
+                        g_object_unref (xps);
+                        return FALSE;
+                }
+                bench_file_add_sample (bench, PHASE_DOCUMENT, start, record);
+
+                n_pages = gxps_document_get_n_pages (doc);
+                if (max_pages > 0)
+                        n_pages = MIN (n_pages, (guint) max_pages);
+                bench->n_pages += n_pages;
+
+                for (n_page = 0; n_page < n_pages; n_page++) {
+                        if (!bench_page (bench, doc, n_page, record, error)) {
+                                g_object_unref (doc);
+                                g_object_unref (xps);
+                                return FALSE;
+                        }
+                }
+
+                g_object_unref (doc);
+        }
+
+        g_object_unref (xps);
+
+        return TRUE;
+}
+
+static void
+bench_file_run (BenchFile *bench)
+{
+        GError *error = NULL;
+        gint    i;
+
+        for (i = 0; i < warmup + iterations; i++) {
+                if (!bench_iteration (bench, i >= warmup, &error)) {
+                        bench->error = g_strdup (error->message);
+                        g_error_free (error);
+                        return;
+                }
+        }
+}
+
+static gint
+compare_doubles (gconstpointer a,
+                 gconstpointer b)
+{
+        gdouble da = *(const gdouble *)a;
+        gdouble db = *(const gdouble *)b;
+
+        return da < db ? -1 : da > db ? 1 : 0;
+}
+
+/* Nearest rank percentile of a sorted array */
+static gdouble
+percentile (GArray *sorted,
+            gdouble p)
+{
+        guint rank;
+
+        rank = (guint) ceil (p / 100. * sorted->len);
+        rank = CLAMP (rank, 1, sorted->len);
+
+        return g_array_index (sorted, gdouble, rank - 1);
+}
+
+static void
+json_append_string (GString     *json,
+                    const gchar *str)
+{
+        const gchar *p;
+
+        g_string_append_c (json, '"');
+        for (p = str; *p; p++) {
+                switch (*p) {
+                case '"':
+                        g_string_append (json, "\\\"");
+                        break;
+                case '\\':
+                        g_string_append (json, "\\\\");
+                        break;
+                case '\n':
+                        g_string_append (json, "\\n");
+                        break;
+                case '\t':
+                        g_string_append (json, "\\t");
+                        break;
+                default:
+                        if ((guchar)*p < 0x20)
+                                g_string_append_printf (json, "\\u%04x", (guint)*p);
+                        else
+                                g_string_append_c (json, *p);
+                }
+        }
+        g_string_append_c (json, '"');
+}
+
+static void
+json_append_double (GString     *json,
+                    const gchar *name,
+                    gdouble      value)
+{
+        gchar buffer[G_ASCII_DTOSTR_BUF_SIZE];
+
+        g_string_append_printf (json, "\"%s\": %s", name,
+                                g_ascii_formatd (buffer, sizeof (buffer), "%.3f", value));
+}
+
+static void
+json_append_phase (GString     *json,
+                   const gchar *name,
+                   GArray      *samples)
+{
+        GArray *sorted;
+        gdouble sum = 0;
+        guint   i;
+
+        g_string_append_printf (json, "        \"%s\": { \"samples\": %u", name, samples->len);
+        if (samples->len == 0) {
+                g_string_append (json, " }");
+                return;
+        }
+
+        sorted = g_array_sized_new (FALSE, FALSE, sizeof (gdouble), samples->len);
+        g_array_append_vals (sorted, samples->data, samples->len);
+        g_array_sort (sorted, compare_doubles);
+        for (i = 0; i < sorted->len; i++)
+                sum += g_array_index (sorted, gdouble, i);
+
+        g_string_append (json, ", ");
+        json_append_double (json, "min", g_array_index (sorted, gdouble, 0));
+        g_string_append (json, ", ");
+        json_append_double (json, "mean", sum / sorted->len);
+        g_string_append (json, ", ");
+        json_append_double (json, "p50", percentile (sorted, 50));
+        g_string_append (json, ", ");
+        json_append_double (json, "p90", percentile (sorted, 90));
+        g_string_append (json, ", ");
+        json_append_double (json, "p95", percentile (sorted, 95));
+        g_string_append (json, ", ");
+        json_append_double (json, "p99", percentile (sorted, 99));
+        g_string_append (json, ", ");
+        json_append_double (json, "max", g_array_index (sorted, gdouble, sorted->len - 1));
+        g_string_append (json, ", ");
+        json_append_double (json, "total", sum);
+        g_string_append (json, " }");
+
+        g_array_free (sorted, TRUE);
+}
+
+static gchar *
+bench_results_to_json (GPtrArray *results)
+{
+        GString *json;
+        gchar    buffer[G_ASCII_DTOSTR_BUF_SIZE];
+        guint    i, j;
+
+        json = g_string_new ("{\n");
+        g_string_append_printf (json, "  \"version\": \"%s\",\n", GXPS_VERSION_STRING);
+        g_string_append_printf (json, "  \"cairo\": \"%s\",\n", cairo_version_string ());
+        g_string_append_printf (json, "  \"iterations\": %d,\n", iterations);
+        g_string_append_printf (json, "  \"warmup\": %d,\n", warmup);
+        g_string_append_printf (json, "  \"resolution\": %s,\n",
+                                g_ascii_formatd (buffer, sizeof (buffer), "%.2f", resolution));
+        g_string_append (json, "  \"unit\": \"ms\",\n");
+        g_string_append (json, "  \"files\": [\n");
+
+        for (i = 0; i < results->len; i++) {
+                BenchFile *bench = g_ptr_array_index (results, i);
+
+                g_string_append (json, "    {\n      \"file\": ");
+                json_append_string (json, bench->filename);
+                g_string_append (json, ",\n");
+                if (bench->error) {
+                        g_string_append (json, "      \"error\": ");
+                        json_append_string (json, bench->error);
+                        g_string_append (json, ",\n");
+                }
+                g_string_append_printf (json, "      \"n_documents\": %u,\n", bench->n_documents);
+                g_string_append_printf (json, "      \"n_pages\": %u,\n", bench->n_pages);
+                g_string_append_printf (json, "      \"encoded_bytes\": %" G_GUINT64_FORMAT ",\n",
+                                        bench->encoded_bytes);
+                g_string_append (json, "      \"phases\": {\n");
+                for (j = 0; j < N_PHASES; j++) {
+                        json_append_phase (json, phase_names[j], bench->samples[j]);
+                        g_string_append (json, j < N_PHASES - 1 ? ",\n" : "\n");
+                }
+                g_string_append (json, "      }\n");
+                g_string_append (json, i < results->len - 1 ? "    },\n" : "    }\n");
+        }
+
+        g_string_append (json, "  ]\n}\n");
+
+        return g_string_free (json, FALSE);
+}
+
+gint main (gint argc, gchar **argv)
+{
+        GOptionContext *context;
+        GPtrArray      *results;
+        gchar          *json;
+        gboolean        failed = FALSE;
+        GError         *error = NULL;
+        guint           i;
+
+        setlocale (LC_ALL, "");
+
+#if !GLIB_CHECK_VERSION (2, 35, 0)
+        g_type_init ();
+#endif
+
+        context = g_option_context_new ("FILE [FILE...]");
+        g_option_context_set_summary (context, "Measure the time spent in every phase of loading and rendering XPS files");
+        g_option_context_add_main_entries (context, options, NULL);
+        if (!g_option_context_parse (context, &argc, &argv, &error)) {
+                g_printerr ("Error parsing arguments: %s\n", error->message);
+                g_error_free (error);
+                g_option_context_free (context);
+
+                return EXIT_FAILURE;
+        }
+
+        if (!filenames || iterations < 1 || warmup < 0 || resolution <= 0) {
+                gchar *help = g_option_context_get_help (context, TRUE, NULL);
+
+                g_printerr ("%s", help);
+                g_free (help);
+                g_option_context_free (context);
+
+                return EXIT_FAILURE;
+        }
+        g_option_context_free (context);
+
+        results = g_ptr_array_new_with_free_func ((GDestroyNotify)bench_file_free);
+        for (i = 0; filenames[i]; i++) {
+                BenchFile *bench = bench_file_new (filenames[i]);
+
+                bench_file_run (bench);
+                if (bench->error) {
+                        g_printerr ("Error benchmarking %s: %s\n", bench->filename, bench->error);
+                        failed = TRUE;
+                }
+                g_ptr_array_add (results, bench);
+        }
+
+        json = bench_results_to_json (results);
+        if (output_filename) {
+                if (!g_file_set_contents (output_filename, json, -1, &error)) {
+                        g_printerr ("Error writing %s: %s\n", output_filename, error->message);
+                        g_error_free (error);
+                        failed = TRUE;
+                }
+        } else {
+                g_print ("%s", json);
+        }
+
+        g_free (json);
+        g_ptr_array_free (results, TRUE);
+        g_strfreev (filenames);
+        g_free (output_filename);
+
+        return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,201 @@
+/* Benchmark for the pixel conversion kernels
+ *
+ * Copyright (C) 2026  libgxps contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <glib.h>
+#include <locale.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gxps-pixels.h"
+
+/* Every conversion is timed with every implementation supported by
+ * the CPU, converting rows of --width pixels for --rows rows. The best
+ * of the timed iterations is reported as throughput in megapixels per
+ * second, together with the speedup over the scalar implementation.
+ * The rows are small enough to stay in the cache, like the ones
+ * converted by the image decoders and the PNG writer.
+ */
+
+typedef void (* ConvertFunc) (gpointer dst, gconstpointer src, gsize n_pixels);
+
+typedef struct {
+        const gchar *name;
+        ConvertFunc  convert;
+} Conversion;
+
+static const Conversion conversions[] = {
+        { "premultiply-rgba", (ConvertFunc)gxps_pixels_premultiply_rgba },
+        { "rgbx-to-xrgb", (ConvertFunc)gxps_pixels_rgbx_to_xrgb },
+        { "rgb-to-xrgb", (ConvertFunc)gxps_pixels_rgb_to_xrgb },
+        { "gray-to-xrgb", (ConvertFunc)gxps_pixels_gray_to_xrgb },
+        { "cmyk-to-xrgb", (ConvertFunc)gxps_pixels_cmyk_to_xrgb },
+        { "abgr-to-argb", (ConvertFunc)gxps_pixels_abgr_to_argb },
+        { "unpremultiply-rgba", (ConvertFunc)gxps_pixels_unpremultiply_rgba },
+        { "xrgb-to-rgbx", (ConvertFunc)gxps_pixels_xrgb_to_rgbx }
+};
+
+static const gchar *implementations[] = {
+        "scalar",
+        "sse2",
+        "ssse3",
+        "avx2"
+};
+
+static gint      iterations = 10;
+static gint      width = 2048;
+static gint      rows = 1024;
+static gchar    *output_filename = NULL;
+
+static const GOptionEntry options[] =
+{
+        { "iterations", 'n', 0, G_OPTION_ARG_INT, &iterations, "number of timed iterations [default: 10]", "N" },
+        { "width", 'w', 0, G_OPTION_ARG_INT, &width, "pixels converted per row [default: 2048]", "N" },
+        { "rows", 'r', 0, G_OPTION_ARG_INT, &rows, "rows converted per iteration [default: 1024]", "N" },
+        { "output", 'o', 0, G_OPTION_ARG_FILENAME, &output_filename, "write the results to FILE instead of stdout", "FILE" },
+        { NULL }
+};
+
+/* Best time of all the iterations, in milliseconds */
+static gdouble
+bench_conversion (const Conversion *conversion,
+                  guint8           *dst,
+                  const guint8     *src)
+{
+        gdouble best = G_MAXDOUBLE;
+        gint    i, row;
+
+        /* Warm up the cache and the branch predictors */
+        conversion->convert (dst, src, width);
+
+        for (i = 0; i < iterations; i++) {
+                gint64 start = g_get_monotonic_time ();
+
+                for (row = 0; row < rows; row++)
+                        conversion->convert (dst, src, width);
+                best = MIN (best, (g_get_monotonic_time () - start) / 1000.0);
+        }
+
+        return best;
+}
+
+static void
+json_append_double (GString     *json,
+                    const gchar *name,
+                    gdouble      value)
+{
+        gchar buffer[G_ASCII_DTOSTR_BUF_SIZE];
+
+        g_string_append_printf (json, "\"%s\": %s", name,
+                                g_ascii_formatd (buffer, sizeof (buffer), "%.3f", value));
+}
+
+gint main (gint argc, gchar **argv)
+{
+        GOptionContext *context;
+        GString        *json;
+        guint8         *src, *dst;
+        gdouble         scalar_ms[G_N_ELEMENTS (conversions)];
+        gboolean        failed = FALSE;
+        GError         *error = NULL;
+        guint           i, j, n_implementations = 0;
+
+        setlocale (LC_ALL, "");
+
+        context = g_option_context_new (NULL);
+        g_option_context_set_summary (context, "Measure the throughput of every pixel conversion kernel");
+        g_option_context_add_main_entries (context, options, NULL);
+        if (!g_option_context_parse (context, &argc, &argv, &error)) {
+                g_printerr ("Error parsing arguments: %s\n", error->message);
+                g_error_free (error);
+                g_option_context_free (context);
+
+                return EXIT_FAILURE;
+        }
+
+        if (iterations < 1 || width < 1 || rows < 1) {
+                gchar *help = g_option_context_get_help (context, TRUE, NULL);
+
+                g_printerr ("%s", help);
+                g_free (help);
+                g_option_context_free (context);
+
+                return EXIT_FAILURE;
+        }
+        g_option_context_free (context);
+
+        /* Random opaque and translucent pixels, so that the kernels
+         * don't take any shortcut for fully transparent ones.
+         */
+        src = g_malloc ((gsize) width * 4);
+        dst = g_malloc ((gsize) width * 4);
+        for (i = 0; i < (guint) width * 4; i++)
+                src[i] = g_random_int_range (0, 256);
+        for (i = 3; i < (guint) width * 4; i += 4)
+                src[i] = MAX (src[i], MAX (src[i - 1], MAX (src[i - 2], src[i - 3])));
+
+        json = g_string_new ("{\n");
+        g_string_append_printf (json, "  \"iterations\": %d,\n", iterations);
+        g_string_append_printf (json, "  \"width\": %d,\n", width);
+        g_string_append_printf (json, "  \"rows\": %d,\n", rows);
+        g_string_append (json, "  \"unit\": \"Mpixels/s\",\n");
+        g_string_append (json, "  \"implementations\": {\n");
+
+        for (i = 0; i < G_N_ELEMENTS (implementations); i++) {
+                if (!gxps_pixels_set_implementation (implementations[i]))
+                        continue;
+
+                if (n_implementations++ > 0)
+                        g_string_append (json, ",\n");
+                g_string_append_printf (json, "    \"%s\": {\n", implementations[i]);
+
+                for (j = 0; j < G_N_ELEMENTS (conversions); j++) {
+                        gdouble ms, mpixels;
+
+                        ms = bench_conversion (&conversions[j], dst, src);
+                        if (i == 0)
+                                scalar_ms[j] = ms;
+                        mpixels = ((gdouble) width * rows / 1000000.) / MAX (ms / 1000., 1e-9);
+
+                        g_string_append_printf (json, "      \"%s\": { ", conversions[j].name);
+                        json_append_double (json, "throughput", mpixels);
+                        g_string_append (json, ", ");
+                        json_append_double (json, "speedup", scalar_ms[j] / MAX (ms, 1e-6));
+                        g_string_append (json, j < G_N_ELEMENTS (conversions) - 1 ? " },\n" : " }\n");
+                }
+                g_string_append (json, "    }");
+        }
+        g_string_append (json, "\n  }\n}\n");
+
+        if (output_filename) {
+                if (!g_file_set_contents (output_filename, json->str, -1, &error)) {
+                        g_printerr ("Error writing %s: %s\n", output_filename, error->message);
+                        g_error_free (error);
+                        failed = TRUE;
+                }
+        } else {
+                g_print ("%s", json->str);
+        }
+
+        g_string_free (json, TRUE);
+        g_free (src);
+        g_free (dst);
+        g_free (output_filename);
+
+        return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
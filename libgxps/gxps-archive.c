@@ -24,6 +24,7 @@
 #include <archive_entry.h>
 
 #include "gxps-archive.h"
+#include "gxps-trace.h"
 
 enum {
 	PROP_0,
@@ -39,6 +40,13 @@ struct _GXPSArchive {
 	GHashTable *entries;
 
 	GXPSResources *resources;
+
+	/* stats is only accessed with stats_lock held, stats_enabled
+	 * can be checked atomically without it to skip counting.
+	 */
+	GMutex      stats_lock;
+	GXPSStats  *stats;
+	gint        stats_enabled;
 };
 
 struct _GXPSArchiveClass {
@@ -52,6 +60,9 @@ G_DEFINE_TYPE_WITH_CODE (GXPSArchive, gxps_archive, G_TYPE_OBJECT,
 
 #define BUFFER_SIZE 4096
 
+/* Stats of the page being loaded or rendered in the current thread */
+static GPrivate page_stats = G_PRIVATE_INIT (NULL);
+
 /* Based on code from GVFS */
 typedef struct {
 	struct archive   *archive;
@@ -183,6 +194,8 @@ gxps_archive_finalize (GObject *object)
 	g_clear_object (&archive->filename);
 	g_clear_error (&archive->init_error);
 	g_clear_object (&archive->resources);
+	g_clear_pointer (&archive->stats, gxps_stats_free);
+	g_mutex_clear (&archive->stats_lock);
 
 	G_OBJECT_CLASS (gxps_archive_parent_class)->finalize (object);
 }
@@ -211,6 +224,7 @@ static void
 gxps_archive_init (GXPSArchive *archive)
 {
 	archive->entries = g_hash_table_new_full (caseless_hash, caseless_equal, g_free, NULL);
+	g_mutex_init (&archive->stats_lock);
 }
 
 static void
@@ -335,11 +349,143 @@ gxps_archive_get_resources (GXPSArchive *archive)
 	return archive->resources;
 }
 
+GFile *
+gxps_archive_get_file (GXPSArchive *archive)
+{
+	g_return_val_if_fail (GXPS_IS_ARCHIVE (archive), NULL);
+
+	return archive->filename;
+}
+
+/* Stats are only collected once enabled, counting is a no-op otherwise.
+ * Counters are added to the archive stats and to the stats of the page
+ * set for the current thread with gxps_archive_stats_push_page().
+ */
+void
+gxps_archive_set_stats_enabled (GXPSArchive *archive,
+				gboolean     enabled)
+{
+	g_return_if_fail (GXPS_IS_ARCHIVE (archive));
+
+	g_mutex_lock (&archive->stats_lock);
+	if (enabled && !archive->stats)
+		archive->stats = g_slice_new0 (GXPSStats);
+	else if (!enabled)
+		g_clear_pointer (&archive->stats, gxps_stats_free);
+	g_atomic_int_set (&archive->stats_enabled, enabled != FALSE);
+	g_mutex_unlock (&archive->stats_lock);
+}
+
+gboolean
+gxps_archive_get_stats_enabled (GXPSArchive *archive)
+{
+	return g_atomic_int_get (&archive->stats_enabled);
+}
+
+/* Returns a copy of the stats, or %NULL if they're disabled */
+GXPSStats *
+gxps_archive_get_stats (GXPSArchive *archive)
+{
+	GXPSStats *stats = NULL;
+
+	g_mutex_lock (&archive->stats_lock);
+	if (archive->stats)
+		stats = gxps_stats_copy (archive->stats);
+	g_mutex_unlock (&archive->stats_lock);
+
+	return stats;
+}
+
+void
+gxps_archive_reset_stats (GXPSArchive *archive)
+{
+	g_mutex_lock (&archive->stats_lock);
+	if (archive->stats)
+		memset (archive->stats, 0, sizeof (GXPSStats));
+	g_mutex_unlock (&archive->stats_lock);
+}
+
+void
+gxps_archive_stats_add (GXPSArchive *archive,
+			gsize        offset,
+			guint64      value)
+{
+	GXPSStats *stats;
+
+	if (G_LIKELY (!g_atomic_int_get (&archive->stats_enabled)))
+		return;
+
+	g_mutex_lock (&archive->stats_lock);
+	if (archive->stats)
+		G_STRUCT_MEMBER (guint64, archive->stats, offset) += value;
+	g_mutex_unlock (&archive->stats_lock);
+
+	stats = g_private_get (&page_stats);
+	if (stats)
+		G_STRUCT_MEMBER (guint64, stats, offset) += value;
+}
+
+void
+gxps_archive_stats_add_element (GXPSArchive     *archive,
+				GXPSStatsElement element)
+{
+	gxps_archive_stats_add (archive,
+				G_STRUCT_OFFSET (GXPSStats, elements) + element * sizeof (guint64),
+				1);
+}
+
+/* Returns the start time of a phase to be passed to
+ * gxps_archive_stats_end(), or 0 when stats are disabled.
+ */
+gint64
+gxps_archive_stats_begin (GXPSArchive *archive)
+{
+	if (G_LIKELY (!g_atomic_int_get (&archive->stats_enabled)))
+		return 0;
+
+	return g_get_monotonic_time ();
+}
+
+void
+gxps_archive_stats_end (GXPSArchive   *archive,
+			GXPSStatsPhase phase,
+			gint64         start)
+{
+	if (start == 0)
+		return;
+
+	gxps_archive_stats_add (archive,
+				G_STRUCT_OFFSET (GXPSStats, phase_time) + phase * sizeof (guint64),
+				g_get_monotonic_time () - start);
+}
+
+/* Sets @stats as the page stats of the current thread and returns the
+ * previous ones, to be restored with gxps_archive_stats_pop_page().
+ */
+GXPSStats *
+gxps_archive_stats_push_page (GXPSStats *stats)
+{
+	GXPSStats *previous;
+
+	previous = g_private_get (&page_stats);
+	g_private_set (&page_stats, stats);
+
+	return previous;
+}
+
+void
+gxps_archive_stats_pop_page (GXPSStats *previous)
+{
+	g_private_set (&page_stats, previous);
+}
+
 /* GXPSArchiveInputStream */
 typedef struct _GXPSArchiveInputStream {
 	GInputStream          parent;
 
+	GXPSArchive          *archive;
 	ZipArchive           *zip;
+	gchar                *path;
         gboolean              is_interleaved;
         guint                 piece;
 	struct archive_entry *entry;
@@ -353,6 +499,7 @@ static GType gxps_archive_input_stream_get_type (void) G_GNUC_CONST;
 
 #define GXPS_TYPE_ARCHIVE_INPUT_STREAM (gxps_archive_input_stream_get_type())
 #define GXPS_ARCHIVE_INPUT_STREAM(obj) (G_TYPE_CHECK_INSTANCE_CAST (obj, GXPS_TYPE_ARCHIVE_INPUT_STREAM, GXPSArchiveInputStream))
+#define GXPS_IS_ARCHIVE_INPUT_STREAM(obj) (G_TYPE_CHECK_INSTANCE_TYPE (obj, GXPS_TYPE_ARCHIVE_INPUT_STREAM))
 
 G_DEFINE_TYPE (GXPSArchiveInputStream, gxps_archive_input_stream, G_TYPE_INPUT_STREAM)
 
@@ -369,18 +516,25 @@ gxps_archive_open (GXPSArchive *archive,
 	if (path[0] == '/')
 		path++;
 
+	GXPS_TRACE_BEGIN ("gxps_archive_open", path);
+
 	if (!g_hash_table_contains (archive->entries, path)) {
                 first_piece_path = g_build_path ("/", path, "[0].piece", NULL);
                 if (!g_hash_table_contains (archive->entries, first_piece_path)) {
                         g_free (first_piece_path);
+                        GXPS_TRACE_END ("gxps_archive_open");
 
                         return NULL;
                 }
-                path = first_piece_path;
         }
 
 	stream = (GXPSArchiveInputStream *)g_object_new (GXPS_TYPE_ARCHIVE_INPUT_STREAM, NULL);
+	stream->archive = g_object_ref (archive);
+	stream->path = g_strdup (path);
+	if (first_piece_path)
+		path = first_piece_path;
 	stream->zip = gxps_zip_archive_create (archive->filename);
+	GXPS_STATS_ADD (archive, ENTRIES_OPENED, 1);
         stream->is_interleaved = first_piece_path != NULL;
 
         while (gxps_zip_archive_iter_next (stream->zip, &stream->entry)) {
@@ -391,9 +545,40 @@ gxps_archive_open (GXPSArchive *archive,
 
         g_free (first_piece_path);
 
+	GXPS_TRACE_END ("gxps_archive_open");
+
 	return G_INPUT_STREAM (stream);
 }
 
+/* Returns the path of the entry opened by gxps_archive_open(), or %NULL
+ * if @stream is not an archive stream.
+ */
+const gchar *
+gxps_archive_input_stream_get_path (GInputStream *stream)
+{
+	if (!GXPS_IS_ARCHIVE_INPUT_STREAM (stream))
+		return NULL;
+
+	return GXPS_ARCHIVE_INPUT_STREAM (stream)->path;
+}
+
+/* Returns the uncompressed size of the entry opened by
+ * gxps_archive_open(), or -1 if it's not known in advance.
+ */
+gssize
+gxps_archive_input_stream_get_size (GInputStream *stream)
+{
+	GXPSArchiveInputStream *istream = GXPS_ARCHIVE_INPUT_STREAM (stream);
+	gssize                  entry_size;
+
+	if (istream->is_interleaved || !istream->entry)
+		return -1;
+
+	entry_size = archive_entry_size (istream->entry);
+
+	return entry_size > 0 ? entry_size : -1;
+}
+
 gboolean
 gxps_archive_read_entry (GXPSArchive *archive,
 			 const gchar *path,
@@ -527,6 +712,8 @@ gxps_archive_input_stream_read (GInputStream  *stream,
                                      archive_error_string (istream->zip->archive));
                 return -1;
         }
+        if (bytes_read > 0)
+                GXPS_STATS_ADD (istream->archive, BYTES_INFLATED, bytes_read);
         if (bytes_read == 0 && istream->is_interleaved && !gxps_archive_input_stream_is_last_piece (istream)) {
                 /* Read next piece */
                 gxps_archive_input_stream_next_piece (istream);
@@ -566,6 +753,8 @@ gxps_archive_input_stream_finalize (GObject *object)
 	GXPSArchiveInputStream *stream = GXPS_ARCHIVE_INPUT_STREAM (object);
 
 	g_clear_pointer (&stream->zip, gxps_zip_archive_destroy);
+	g_clear_object (&stream->archive);
+	g_clear_pointer (&stream->path, g_free);
 
 	G_OBJECT_CLASS (gxps_archive_input_stream_parent_class)->finalize (object);
 }
@@ -25,6 +25,7 @@
 #include <archive.h>
 #include <libgxps/gxps-version.h>
 #include <libgxps/gxps-resources.h>
+#include "gxps-stats-private.h"
 
 G_BEGIN_DECLS
 
@@ -44,6 +45,7 @@ GXPSArchive      *gxps_archive_new            (GFile            *filename,
 gboolean          gxps_archive_has_entry      (GXPSArchive      *archive,
 					       const gchar      *path);
 GXPSResources    *gxps_archive_get_resources  (GXPSArchive      *archive);
+GFile            *gxps_archive_get_file       (GXPSArchive      *archive);
 GInputStream     *gxps_archive_open           (GXPSArchive      *archive,
 					       const gchar      *path);
 gboolean          gxps_archive_read_entry     (GXPSArchive      *archive,
@@ -51,6 +53,31 @@ gboolean          gxps_archive_read_entry     (GXPSArchive      *archive,
 					       guchar          **buffer,
 					       gsize            *bytes_read,
 					       GError          **error);
+gssize            gxps_archive_input_stream_get_size (GInputStream *stream);
+const gchar      *gxps_archive_input_stream_get_path (GInputStream *stream);
+
+void              gxps_archive_set_stats_enabled (GXPSArchive      *archive,
+						  gboolean          enabled);
+gboolean          gxps_archive_get_stats_enabled (GXPSArchive      *archive);
+GXPSStats        *gxps_archive_get_stats         (GXPSArchive      *archive);
+void              gxps_archive_reset_stats       (GXPSArchive      *archive);
+void              gxps_archive_stats_add         (GXPSArchive      *archive,
+						  gsize             offset,
+						  guint64           value);
+void              gxps_archive_stats_add_element (GXPSArchive      *archive,
+						  GXPSStatsElement  element);
+gint64            gxps_archive_stats_begin       (GXPSArchive      *archive);
+void              gxps_archive_stats_end         (GXPSArchive      *archive,
+						  GXPSStatsPhase    phase,
+						  gint64            start);
+GXPSStats        *gxps_archive_stats_push_page   (GXPSStats        *stats);
+void              gxps_archive_stats_pop_page    (GXPSStats        *previous);
+
+#define GXPS_STATS_ADD(archive, counter, value) \
+	gxps_archive_stats_add ((archive), \
+				G_STRUCT_OFFSET (GXPSStats, counters) + \
+				GXPS_STATS_COUNTER_ ## counter * sizeof (guint64), \
+				(value))
 
 G_END_DECLS
 
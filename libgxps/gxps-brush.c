@@ -47,6 +47,8 @@ struct _GXPSBrushVisual {
         cairo_extend_t    extend;
 };
 
+static const cairo_user_data_key_t brush_opacity_key;
+
 GXPSBrush *
 gxps_brush_new (GXPSRenderContext *ctx)
 {
@@ -76,6 +78,109 @@ gxps_brush_free (GXPSBrush *brush)
         g_slice_free (GXPSBrush, brush);
 }
 
+/* Opacity of an image brush that hasn't been applied to its pattern
+ * yet. Consumers that paint the pattern with a single operation pass
+ * it to cairo_paint_with_alpha() so that no intermediate group is needed.
+ */
+gdouble
+gxps_brush_pattern_get_opacity (cairo_pattern_t *pattern)
+{
+        gdouble *opacity;
+
+        if (!pattern)
+                return 1.0;
+
+        opacity = cairo_pattern_get_user_data (pattern, &brush_opacity_key);
+
+        return opacity ? *opacity : 1.0;
+}
+
+static void
+gxps_brush_pattern_set_opacity (cairo_pattern_t *pattern,
+                                gdouble          opacity)
+{
+        gdouble *data;
+
+        data = g_new (gdouble, 1);
+        *data = opacity;
+        if (cairo_pattern_set_user_data (pattern, &brush_opacity_key, data, g_free))
+                g_free (data);
+}
+
+/* Returns a new pattern equivalent to @pattern with @opacity multiplied
+ * into its color alpha, or %NULL if the pattern is a surface pattern
+ * whose pixels can't be modified without painting it into a group.
+ */
+cairo_pattern_t *
+gxps_brush_pattern_fold_opacity (cairo_pattern_t *pattern,
+                                 gdouble          opacity)
+{
+        cairo_pattern_t *retval;
+        cairo_matrix_t   matrix;
+        gdouble          r, g, b, a;
+        gint             n_stops, i;
+
+        switch (cairo_pattern_get_type (pattern)) {
+        case CAIRO_PATTERN_TYPE_SOLID:
+                cairo_pattern_get_rgba (pattern, &r, &g, &b, &a);
+
+                return cairo_pattern_create_rgba (r, g, b, a * opacity);
+        case CAIRO_PATTERN_TYPE_LINEAR: {
+                gdouble x0, y0, x1, y1;
+
+                cairo_pattern_get_linear_points (pattern, &x0, &y0, &x1, &y1);
+                retval = cairo_pattern_create_linear (x0, y0, x1, y1);
+        }
+                break;
+        case CAIRO_PATTERN_TYPE_RADIAL: {
+                gdouble x0, y0, r0, x1, y1, r1;
+
+                cairo_pattern_get_radial_circles (pattern, &x0, &y0, &r0, &x1, &y1, &r1);
+                retval = cairo_pattern_create_radial (x0, y0, r0, x1, y1, r1);
+        }
+                break;
+        default:
+                return NULL;
+        }
+
+        cairo_pattern_get_color_stop_count (pattern, &n_stops);
+        for (i = 0; i < n_stops; i++) {
+                gdouble offset;
+
+                cairo_pattern_get_color_stop_rgba (pattern, i, &offset, &r, &g, &b, &a);
+                cairo_pattern_add_color_stop_rgba (retval, offset, r, g, b, a * opacity);
+        }
+
+        cairo_pattern_get_matrix (pattern, &matrix);
+        cairo_pattern_set_matrix (retval, &matrix);
+        cairo_pattern_set_extend (retval, cairo_pattern_get_extend (pattern));
+        cairo_pattern_set_filter (retval, cairo_pattern_get_filter (pattern));
+
+        return retval;
+}
+
+/* Returns a new reference to a pattern with the pending brush opacity
+ * applied, for consumers that can't paint @pattern with a single
+ * cairo_paint_with_alpha() call (strokes and opacity masks).
+ */
+cairo_pattern_t *
+gxps_brush_pattern_realize (cairo_pattern_t   *pattern,
+                            GXPSRenderContext *ctx)
+{
+        gdouble opacity;
+
+        opacity = gxps_brush_pattern_get_opacity (pattern);
+        if (opacity == 1.0)
+                return cairo_pattern_reference (pattern);
+
+        cairo_push_group (ctx->cr);
+        GXPS_STATS_ADD (ctx->page->priv->zip, PUSH_GROUPS, 1);
+        cairo_set_source (ctx->cr, pattern);
+        cairo_paint_with_alpha (ctx->cr, opacity);
+
+        return cairo_pop_group (ctx->cr);
+}
+
 static gboolean
 hex (const gchar *spec,
      gint         len,
@@ -349,6 +454,225 @@ gxps_brush_image_free (GXPSBrushImage *image)
         g_slice_free (GXPSBrushImage, image);
 }
 
+/* Resolution, in device pixels per inch of image, the image brush is
+ * going to be rendered at. Returns 0 when the target is not a raster
+ * surface, in which case the image is needed at its full resolution.
+ */
+static gdouble
+gxps_brush_image_get_target_resolution (GXPSBrushImage *image,
+                                        cairo_t        *cr)
+{
+        cairo_surface_t *target = cairo_get_target (cr);
+        cairo_matrix_t   ctm, matrix;
+        gdouble          x_res, y_res;
+        gdouble          x_scale = 1, y_scale = 1;
+
+        switch (cairo_surface_get_type (target)) {
+        case CAIRO_SURFACE_TYPE_IMAGE:
+        case CAIRO_SURFACE_TYPE_XLIB:
+        case CAIRO_SURFACE_TYPE_XCB:
+        case CAIRO_SURFACE_TYPE_WIN32:
+        case CAIRO_SURFACE_TYPE_QUARTZ:
+                break;
+        default:
+                return 0;
+        }
+
+        if (image->viewbox.width <= 0 || image->viewbox.height <= 0)
+                return 0;
+
+#if CAIRO_VERSION >= CAIRO_VERSION_ENCODE (1, 14, 0)
+        cairo_surface_get_device_scale (target, &x_scale, &y_scale);
+#endif
+        cairo_get_matrix (cr, &ctm);
+        cairo_matrix_multiply (&matrix, &image->matrix, &ctm);
+
+        /* Viewbox units are 1/96 inch of the image */
+        x_res = gxps_transform_hypot (&matrix, image->viewport.width, 0) * x_scale / image->viewbox.width * 96;
+        y_res = gxps_transform_hypot (&matrix, 0, image->viewport.height) * y_scale / image->viewbox.height * 96;
+
+        return MAX (x_res, y_res);
+}
+
+/* Whether anything painted with the image brush can be visible at all */
+static gboolean
+gxps_brush_image_is_visible (GXPSBrushImage *image,
+                             cairo_t        *cr)
+{
+        gdouble x1, y1, x2, y2;
+
+        if (image->brush->opacity <= 0)
+                return FALSE;
+
+        /* The clip can only shrink until the brush is used */
+        cairo_clip_extents (cr, &x1, &y1, &x2, &y2);
+
+        return x1 < x2 && y1 < y2;
+}
+
+#if CAIRO_VERSION >= CAIRO_VERSION_ENCODE (1, 12, 0)
+/* An image that is only decoded when cairo needs its pixels. The
+ * pattern is created from the size and resolution in the image header,
+ * so images that end up clipped away or painted fully transparent are
+ * never decoded. Copies of the pattern made by cairo share the handle,
+ * and the surface for the viewbox, built on the first acquire.
+ */
+typedef struct {
+        gint                  ref_count;
+        GXPSPage             *page;
+        gchar                *image_uri;
+        gdouble               target_res;
+        guint                 width;
+        guint                 height;
+        cairo_rectangle_int_t area;
+
+        GMutex                lock;
+        cairo_surface_t      *surface;
+} GXPSLazyImage;
+
+static void
+gxps_lazy_image_unref (GXPSLazyImage *lazy)
+{
+        if (!g_atomic_int_dec_and_test (&lazy->ref_count))
+                return;
+
+        g_object_unref (lazy->page);
+        g_free (lazy->image_uri);
+        if (lazy->surface)
+                cairo_surface_destroy (lazy->surface);
+        g_mutex_clear (&lazy->lock);
+        g_slice_free (GXPSLazyImage, lazy);
+}
+
+static cairo_surface_t *
+gxps_lazy_image_decode (GXPSLazyImage *lazy)
+{
+        GXPSImage       *image;
+        cairo_surface_t *surface;
+        cairo_t         *cr;
+        GError          *error = NULL;
+
+        GXPS_DEBUG (g_message ("decode image %s", lazy->image_uri));
+        /* Lazy images are only used for raster targets */
+        image = gxps_page_get_image (lazy->page, lazy->image_uri, lazy->target_res,
+                                     CAIRO_SURFACE_TYPE_IMAGE, &error);
+        if (!image) {
+                if (error) {
+                        GXPS_DEBUG (g_debug ("%s", error->message));
+                        g_error_free (error);
+                }
+
+                /* Paint nothing rather than putting cairo in error */
+                return cairo_image_surface_create (CAIRO_FORMAT_ARGB32, 1, 1);
+        }
+
+        /* The whole image, keeping its MIME data */
+        if (image->width == lazy->width && image->height == lazy->height &&
+            lazy->area.x == 0 && lazy->area.y == 0 &&
+            lazy->area.width == (gint)image->width && lazy->area.height == (gint)image->height)
+                return cairo_surface_reference (image->surface);
+
+        /* Copy the viewbox, scaling it if the cached image was decoded
+         * at a different resolution than the header said.
+         */
+        surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, lazy->area.width, lazy->area.height);
+        cr = cairo_create (surface);
+        cairo_translate (cr, -lazy->area.x, -lazy->area.y);
+        cairo_scale (cr,
+                     (gdouble)lazy->width / image->width,
+                     (gdouble)lazy->height / image->height);
+        cairo_set_source_surface (cr, image->surface, 0, 0);
+        cairo_paint (cr);
+        cairo_destroy (cr);
+
+        return surface;
+}
+
+static cairo_surface_t *
+gxps_lazy_image_acquire (cairo_pattern_t             *pattern,
+                         void                        *callback_data,
+                         cairo_surface_t             *target,
+                         const cairo_rectangle_int_t *extents)
+{
+        GXPSLazyImage   *lazy = (GXPSLazyImage *)callback_data;
+        cairo_surface_t *surface;
+
+        g_mutex_lock (&lazy->lock);
+        if (!lazy->surface)
+                lazy->surface = gxps_lazy_image_decode (lazy);
+        surface = cairo_surface_reference (lazy->surface);
+        g_mutex_unlock (&lazy->lock);
+
+        return surface;
+}
+
+static void
+gxps_lazy_image_release (cairo_pattern_t *pattern,
+                         void            *callback_data,
+                         cairo_surface_t *surface)
+{
+        cairo_surface_destroy (surface);
+}
+
+static cairo_status_t
+gxps_lazy_image_copy (cairo_pattern_t       *pattern,
+                      void                  *callback_data,
+                      const cairo_pattern_t *other)
+{
+        GXPSLazyImage *lazy = (GXPSLazyImage *)callback_data;
+
+        g_atomic_int_inc (&lazy->ref_count);
+
+        return CAIRO_STATUS_SUCCESS;
+}
+
+static void
+gxps_lazy_image_finish (cairo_pattern_t *pattern,
+                        void            *callback_data)
+{
+        gxps_lazy_image_unref ((GXPSLazyImage *)callback_data);
+}
+
+/* Returns a pattern for the viewbox area, in pixels, of an image of
+ * which only the header has been read.
+ */
+static cairo_pattern_t *
+gxps_lazy_image_create_pattern (GXPSPage                *page,
+                                const gchar             *image_uri,
+                                gdouble                  target_res,
+                                GXPSImage               *info,
+                                const cairo_rectangle_t *viewbox)
+{
+        GXPSLazyImage   *lazy;
+        cairo_pattern_t *pattern;
+
+        lazy = g_slice_new0 (GXPSLazyImage);
+        lazy->ref_count = 1;
+        lazy->page = g_object_ref (page);
+        lazy->image_uri = g_strdup (image_uri);
+        lazy->target_res = target_res;
+        lazy->width = info->width;
+        lazy->height = info->height;
+        g_mutex_init (&lazy->lock);
+
+        /* Same area cairo_surface_create_for_rectangle() would use */
+        lazy->area.x = ceil (viewbox->x);
+        lazy->area.y = ceil (viewbox->y);
+        lazy->area.width = MAX (floor (viewbox->x + viewbox->width) - lazy->area.x, 1);
+        lazy->area.height = MAX (floor (viewbox->y + viewbox->height) - lazy->area.y, 1);
+
+        pattern = cairo_pattern_create_raster_source (lazy, CAIRO_CONTENT_COLOR_ALPHA,
+                                                      lazy->area.width, lazy->area.height);
+        cairo_raster_source_pattern_set_acquire (pattern,
+                                                 gxps_lazy_image_acquire,
+                                                 gxps_lazy_image_release);
+        cairo_raster_source_pattern_set_copy (pattern, gxps_lazy_image_copy);
+        cairo_raster_source_pattern_set_finish (pattern, gxps_lazy_image_finish);
+
+        return pattern;
+}
+#endif /* CAIRO_VERSION >= 1.12 */
+
 static void
 brush_image_start_element (GMarkupParseContext  *context,
                            const gchar          *element_name,
@@ -514,37 +838,30 @@ static GMarkupParser brush_gradient_parser = {
         NULL
 };
 
-static gboolean
-gxps_box_parse (const gchar       *box,
-                cairo_rectangle_t *rect)
+static void
+gxps_brush_stats_add_element (GXPSBrush   *brush,
+                              const gchar *element_name)
 {
-        gchar **tokens;
-        gdouble b[4];
-        guint   i;
-
-        tokens = g_strsplit (box, ",", 4);
-        if (g_strv_length (tokens) != 4) {
-                g_strfreev (tokens);
+        GXPSArchive     *zip = brush->ctx->page->priv->zip;
+        GXPSStatsElement element;
 
-                return FALSE;
-        }
-
-        for (i = 0; i < 4; i++) {
-                if (!gxps_value_get_double (tokens[i], &b[i])) {
-                        g_strfreev (tokens);
-
-                        return FALSE;
-                }
-        }
-
-        rect->x = b[0];
-        rect->y = b[1];
-        rect->width = b[2];
-        rect->height = b[3];
+        if (G_LIKELY (!gxps_archive_get_stats_enabled (zip)))
+                return;
 
-        g_strfreev (tokens);
+        if (strcmp (element_name, "SolidColorBrush") == 0)
+                element = GXPS_STATS_ELEMENT_SOLID_COLOR_BRUSH;
+        else if (strcmp (element_name, "ImageBrush") == 0)
+                element = GXPS_STATS_ELEMENT_IMAGE_BRUSH;
+        else if (strcmp (element_name, "LinearGradientBrush") == 0)
+                element = GXPS_STATS_ELEMENT_LINEAR_GRADIENT_BRUSH;
+        else if (strcmp (element_name, "RadialGradientBrush") == 0)
+                element = GXPS_STATS_ELEMENT_RADIAL_GRADIENT_BRUSH;
+        else if (strcmp (element_name, "VisualBrush") == 0)
+                element = GXPS_STATS_ELEMENT_VISUAL_BRUSH;
+        else
+                return;
 
-        return TRUE;
+        gxps_archive_stats_add_element (zip, element);
 }
 
 static void
@@ -557,6 +874,8 @@ brush_start_element (GMarkupParseContext  *context,
 {
         GXPSBrush *brush = (GXPSBrush *)user_data;
 
+        gxps_brush_stats_add_element (brush, element_name);
+
         if (strcmp (element_name, "SolidColorBrush") == 0) {
                 const gchar *color_str = NULL;
                 gint i;
@@ -927,6 +1246,7 @@ brush_start_element (GMarkupParseContext  *context,
                 cairo_rectangle (brush->ctx->cr, 0, 0, width, height);
                 cairo_clip (brush->ctx->cr);
                 cairo_push_group (brush->ctx->cr);
+                GXPS_STATS_ADD (brush->ctx->page->priv->zip, PUSH_GROUPS, 1);
                 cairo_translate (brush->ctx->cr, -viewbox.x, -viewbox.y);
                 cairo_scale (brush->ctx->cr, width / viewbox.width, height / viewbox.height);
                 visual = gxps_brush_visual_new (brush, &viewport, &viewbox);
@@ -939,6 +1259,8 @@ brush_start_element (GMarkupParseContext  *context,
                 sub_ctx->page = brush->ctx->page;
                 sub_ctx->cr = brush->ctx->cr;
                 sub_ctx->visual = visual;
+                sub_ctx->draft = brush->ctx->draft;
+                sub_ctx->links = brush->ctx->links;
                 gxps_page_render_parser_push (context, sub_ctx);
         } else {
                 gxps_parse_error (context,
@@ -963,30 +1285,74 @@ brush_end_element (GMarkupParseContext  *context,
                 g_markup_parse_context_pop (context);
         } else if (strcmp (element_name, "ImageBrush") == 0) {
                 GXPSBrushImage  *brush_image;
-                GXPSImage       *image;
+                GXPSImage       *image = NULL;
+                GXPSImage       *info = NULL;
+                GXPSImage       *source;
+                gdouble          target_res;
                 GError          *err = NULL;
 
                 brush_image = g_markup_parse_context_pop (context);
 
                 GXPS_DEBUG (g_message ("set_fill_pattern (image)"));
-                image = gxps_page_get_image (brush->ctx->page, brush_image->image_uri, &err);
-                if (image) {
+                if (!gxps_brush_image_is_visible (brush_image, brush->ctx->cr)) {
+                        /* Don't even load the image, but a transparent
+                         * opacity mask must still hide its content.
+                         */
+                        GXPS_DEBUG (g_message ("image %s is not visible", brush_image->image_uri));
+                        brush_image->brush->pattern = cairo_pattern_create_rgba (0, 0, 0, 0);
+                        gxps_brush_image_free (brush_image);
+
+                        return;
+                }
+
+                target_res = gxps_brush_image_get_target_resolution (brush_image, brush->ctx->cr);
+                image = gxps_page_lookup_image (brush->ctx->page, brush_image->image_uri, target_res);
+#if CAIRO_VERSION >= CAIRO_VERSION_ENCODE (1, 12, 0)
+                /* Raster targets decode the image only when it's
+                 * actually drawn. Vector backends don't support raster
+                 * source patterns everywhere, so they still decode it here.
+                 */
+                if (!image && target_res > 0) {
+                        info = gxps_images_get_image_info (brush->ctx->page->priv->zip,
+                                                           brush_image->image_uri,
+                                                           target_res, NULL);
+                }
+#endif
+                if (!image && !info)
+                        image = gxps_page_get_image (brush->ctx->page, brush_image->image_uri, target_res,
+                                                     cairo_surface_get_type (cairo_get_target (brush->ctx->cr)),
+                                                     &err);
+
+                source = image ? image : info;
+                if (source) {
                         cairo_matrix_t   matrix;
                         gdouble          x_scale, y_scale;
-                        cairo_surface_t *clip_surface;
 
                         /* viewbox units is 1/96 inch, convert to pixels */
-                        brush_image->viewbox.x *= image->res_x / 96;
-                        brush_image->viewbox.y *= image->res_y / 96;
-                        brush_image->viewbox.width *= image->res_x / 96;
-                        brush_image->viewbox.height *= image->res_y / 96;
-
-                        clip_surface = cairo_surface_create_for_rectangle (image->surface,
-                                                                           brush_image->viewbox.x,
-                                                                           brush_image->viewbox.y,
-                                                                           brush_image->viewbox.width,
-                                                                           brush_image->viewbox.height);
-                        brush_image->brush->pattern = cairo_pattern_create_for_surface (clip_surface);
+                        brush_image->viewbox.x *= source->res_x / 96;
+                        brush_image->viewbox.y *= source->res_y / 96;
+                        brush_image->viewbox.width *= source->res_x / 96;
+                        brush_image->viewbox.height *= source->res_y / 96;
+
+                        if (image) {
+                                cairo_surface_t *clip_surface;
+
+                                clip_surface = cairo_surface_create_for_rectangle (image->surface,
+                                                                                   brush_image->viewbox.x,
+                                                                                   brush_image->viewbox.y,
+                                                                                   brush_image->viewbox.width,
+                                                                                   brush_image->viewbox.height);
+                                brush_image->brush->pattern = cairo_pattern_create_for_surface (clip_surface);
+                                cairo_surface_destroy (clip_surface);
+                        }
+#if CAIRO_VERSION >= CAIRO_VERSION_ENCODE (1, 12, 0)
+                        else {
+                                brush_image->brush->pattern = gxps_lazy_image_create_pattern (brush->ctx->page,
+                                                                                              brush_image->image_uri,
+                                                                                              target_res, info,
+                                                                                              &brush_image->viewbox);
+                        }
+#endif
                         cairo_pattern_set_extend (brush_image->brush->pattern, brush_image->extend);
 
                         x_scale = brush_image->viewport.width / brush_image->viewbox.width;
@@ -997,24 +1363,22 @@ brush_end_element (GMarkupParseContext  *context,
                         cairo_matrix_invert (&matrix);
                         cairo_pattern_set_matrix (brush_image->brush->pattern, &matrix);
 
-                        if (brush->opacity != 1.0) {
-                                cairo_push_group (brush->ctx->cr);
-                                cairo_set_source (brush->ctx->cr, brush_image->brush->pattern);
-                                cairo_pattern_destroy (brush_image->brush->pattern);
-                                cairo_paint_with_alpha (brush->ctx->cr, brush->opacity);
-                                brush_image->brush->pattern = cairo_pop_group (brush->ctx->cr);
-                        }
+                        /* Don't paint the image into a group here, the
+                         * opacity is applied when the pattern is consumed.
+                         */
+                        if (brush->opacity != 1.0)
+                                gxps_brush_pattern_set_opacity (brush_image->brush->pattern, brush->opacity);
 
                         if (cairo_pattern_status (brush_image->brush->pattern)) {
                                 GXPS_DEBUG (g_debug ("%s", cairo_status_to_string (cairo_pattern_status (brush_image->brush->pattern))));
                                 cairo_pattern_destroy (brush_image->brush->pattern);
                                 brush_image->brush->pattern = NULL;
                         }
-                        cairo_surface_destroy (clip_surface);
                 } else if (err) {
                         GXPS_DEBUG (g_debug ("%s", err->message));
                         g_error_free (err);
                 }
+                gxps_image_free (info);
                 gxps_brush_image_free (brush_image);
         } else if (strcmp (element_name, "VisualBrush") == 0) {
                 GXPSRenderContext *sub_ctx;
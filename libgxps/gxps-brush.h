@@ -42,6 +42,12 @@ gboolean   gxps_brush_solid_color_parse (const gchar         *data,
 void       gxps_brush_parser_push       (GMarkupParseContext *context,
                                          GXPSBrush           *brush);
 
+gdouble          gxps_brush_pattern_get_opacity  (cairo_pattern_t *pattern);
+cairo_pattern_t *gxps_brush_pattern_fold_opacity (cairo_pattern_t *pattern,
+                                                  gdouble          opacity);
+cairo_pattern_t *gxps_brush_pattern_realize      (cairo_pattern_t   *pattern,
+                                                  GXPSRenderContext *ctx);
+
 G_END_DECLS
 
 #endif /* __GXPS_BRUSH_H__ */
@@ -26,6 +26,7 @@
 #include "gxps-color.h"
 #include "gxps-error.h"
 #include "gxps-debug.h"
+#include "gxps-trace.h"
 
 #define ICC_PROFILE_CACHE_KEY "gxps-icc-profile-cache"
 
@@ -143,10 +144,11 @@ get_s_rgb_profile (void)
 }
 
 static gboolean
-gxps_color_new_for_icc_profile (cmsHPROFILE profile,
-                                gdouble    *values,
-                                guint       n_values,
-                                GXPSColor  *color)
+gxps_color_new_for_icc_profile (cmsHPROFILE  profile,
+                                const gchar *icc_profile_uri,
+                                gdouble     *values,
+                                guint        n_values,
+                                GXPSColor   *color)
 {
         cmsHTRANSFORM transform;
         gdouble       cmyk[4];
@@ -166,11 +168,13 @@ gxps_color_new_for_icc_profile (cmsHPROFILE profile,
         cmyk[2] = CLAMP (values[2], 0., 1.) * 100.;
         cmyk[3] = CLAMP (values[3], 0., 1.) * 100.;
 
+        GXPS_TRACE_BEGIN ("color_transform", icc_profile_uri);
         transform = cmsCreateTransform (profile,
                                         TYPE_CMYK_DBL,
                                         get_s_rgb_profile (),
                                         TYPE_RGB_DBL,
                                         INTENT_PERCEPTUAL, 0);
+        GXPS_TRACE_END ("color_transform");
         cmsDoTransform (transform, cmyk, rgb, 1);
         cmsDeleteTransform (transform);
 
@@ -225,10 +229,13 @@ gxps_color_new_for_icc (GXPSArchive *zip,
         icc_cache = g_object_get_data (G_OBJECT (zip), ICC_PROFILE_CACHE_KEY);
         if (icc_cache) {
                 profile = g_hash_table_lookup (icc_cache, icc_profile_uri);
-                if (profile)
-                        return gxps_color_new_for_icc_profile (profile, values, n_values, color);
+                if (profile) {
+                        GXPS_STATS_ADD (zip, ICC_CACHE_HITS, 1);
+                        return gxps_color_new_for_icc_profile (profile, icc_profile_uri, values, n_values, color);
+                }
         }
 
+        GXPS_STATS_ADD (zip, ICC_CACHE_MISSES, 1);
         profile = gxps_color_create_icc_profile (zip, icc_profile_uri);
         if (!profile)
                 return FALSE;
@@ -245,7 +252,7 @@ gxps_color_new_for_icc (GXPSArchive *zip,
 
         g_hash_table_insert (icc_cache, g_strdup (icc_profile_uri), profile);
 
-        return gxps_color_new_for_icc_profile (profile, values, n_values, color);
+        return gxps_color_new_for_icc_profile (profile, icc_profile_uri, values, n_values, color);
 #else
         return FALSE;
 #endif
@@ -50,8 +50,10 @@ struct _GXPSDocumentStructurePrivate {
 	GXPSArchive *zip;
 	gchar       *source;
 
-	/* Outline */
+	/* Outline, parsed on first use */
 	GList       *outline;
+	gboolean     outline_parsed;
+	gint         has_outline;
 };
 
 typedef struct _OutlineNode OutlineNode;
@@ -96,6 +98,7 @@ static void
 gxps_document_structure_init (GXPSDocumentStructure *structure)
 {
 	structure->priv = gxps_document_structure_get_instance_private (structure);
+	structure->priv->has_outline = -1;
 }
 
 static void
@@ -309,6 +312,17 @@ gxps_document_structure_parse_outline (GXPSDocumentStructure *structure,
 	return ctx.outline;
 }
 
+static void
+gxps_document_structure_ensure_outline (GXPSDocumentStructure *structure)
+{
+	if (structure->priv->outline_parsed)
+		return;
+
+	structure->priv->outline = gxps_document_structure_parse_outline (structure, NULL);
+	structure->priv->outline_parsed = TRUE;
+	structure->priv->has_outline = structure->priv->outline != NULL;
+}
+
 /* Try to know ASAP whether document has an outline */
 static void
 check_outline_start_element (GMarkupParseContext  *context,
@@ -320,11 +334,15 @@ check_outline_start_element (GMarkupParseContext  *context,
 {
 	gboolean *has_outline = (gboolean *)user_data;
 
-	if (*has_outline == TRUE)
-		return;
-
-	if (strcmp (element_name, "DocumentStructure.Outline") == 0)
+	if (strcmp (element_name, "OutlineEntry") == 0) {
 		*has_outline = TRUE;
+
+		/* Stop parsing, the rest of the part is not needed */
+		g_set_error_literal (error,
+				     G_MARKUP_ERROR,
+				     G_MARKUP_ERROR_INVALID_CONTENT,
+				     "Outline found");
+	}
 }
 
 static const GMarkupParser check_outline_parser = {
@@ -339,7 +357,9 @@ static const GMarkupParser check_outline_parser = {
  * gxps_document_structure_has_outline:
  * @structure: a #GXPSDocumentStructure
  *
- * Whether @structure has an outline or not.
+ * Whether @structure has an outline or not. If the outline hasn't been
+ * parsed yet, only the beginning of the document structure is read,
+ * until the first outline entry is found.
  *
  * Returns: %TRUE if @structure has an outline, %FALSE otherwise.
  */
@@ -350,6 +370,9 @@ gxps_document_structure_has_outline (GXPSDocumentStructure *structure)
 	GMarkupParseContext *context;
 	gboolean             retval = FALSE;
 
+	if (structure->priv->has_outline != -1)
+		return structure->priv->has_outline;
+
 	stream = gxps_archive_open (structure->priv->zip,
 				    structure->priv->source);
 	if (!stream)
@@ -360,6 +383,8 @@ gxps_document_structure_has_outline (GXPSDocumentStructure *structure)
 	g_object_unref (stream);
 	g_markup_parse_context_free (context);
 
+	structure->priv->has_outline = retval;
+
 	return retval;
 }
 
@@ -413,8 +438,7 @@ gxps_document_structure_outline_iter_init (GXPSOutlineIter       *iter,
 	g_return_val_if_fail (GXPS_IS_DOCUMENT_STRUCTURE (structure), FALSE);
 
 	oi->structure = structure;
-	if (!structure->priv->outline)
-		structure->priv->outline = gxps_document_structure_parse_outline (structure, NULL);
+	gxps_document_structure_ensure_outline (structure);
 	oi->current = structure->priv->outline;
 
 	return oi->current != NULL;
@@ -25,8 +25,10 @@
 #include "gxps-document.h"
 #include "gxps-archive.h"
 #include "gxps-links.h"
+#include "gxps-page-private.h"
 #include "gxps-private.h"
 #include "gxps-error.h"
+#include "gxps-trace.h"
 
 /**
  * SECTION:gxps-document
@@ -42,9 +44,22 @@
 enum {
 	PROP_0,
 	PROP_ARCHIVE,
-	PROP_SOURCE
+	PROP_SOURCE,
+	PROP_PROGRESSIVE
 };
 
+enum {
+	N_PAGES_CHANGED,
+	LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL];
+
+/* Number of chunks of the FixedDocument parsed in every iteration of
+ * the main loop when loading progressively.
+ */
+#define LOADER_CHUNKS_PER_ITERATION 16
+
 typedef struct _Page {
 	gchar *source;
 	gint   width;
@@ -58,13 +73,50 @@ struct _GXPSDocumentPrivate {
 	gboolean     has_rels;
 	gchar       *structure;
 
+	/* Shared by all gxps_document_get_structure() callers */
+	GXPSDocumentStructure *structure_object;
+
 	gboolean     initialized;
 	GError      *init_error;
 
 	Page       **pages;
 	guint        n_pages;
+	guint        pages_size;
+
+	/* Progressive loading of the page table */
+	gboolean                    progressive;
+	gboolean                    loaded;
+	GError                     *load_error;
+	struct _FixedDocParserData *loader_data;
+	GMarkupParseContext        *loader;
+	GInputStream               *loader_stream;
+	gssize                      loader_size;
+	gsize                       loader_bytes_read;
+	GSource                    *loader_source;
+	GMainContext               *loader_context;
+
+	/* Anchor name to AnchorIndexEntry, built on first use and
+	 * extended with the pages loaded later. The lock also protects
+	 * the page table, which is reallocated while it's being loaded:
+	 * other threads must hold it to read pages and n_pages, see
+	 * gxps_document_lookup_page(). Page structs are never modified
+	 * nor freed once they are in the table.
+	 */
+	GMutex       anchors_lock;
+	GHashTable  *anchors;
+	guint        anchors_n_pages;
+
+	/* Recently used pages, the most recent first */
+	GMutex       page_cache_lock;
+	GQueue       page_cache;
+	guint        page_cache_size;
 };
 
+typedef struct {
+	guint     n_page;
+	GXPSPage *page;
+} CachedPage;
+
 static void initable_iface_init (GInitableIface *initable_iface);
 
 G_DEFINE_TYPE_WITH_CODE (GXPSDocument, gxps_document, G_TYPE_OBJECT,
@@ -89,14 +141,85 @@ page_free (Page *page)
 	g_slice_free (Page, page);
 }
 
+/* Anchor index. Names are owned by the pages, the areas are only known
+ * once the page of the anchor has been parsed.
+ */
+typedef struct {
+	guint             n_page;
+	gboolean          has_area;
+	cairo_rectangle_t area;
+} AnchorIndexEntry;
+
+static AnchorIndexEntry *
+anchor_index_entry_new (guint n_page)
+{
+	AnchorIndexEntry *entry;
+
+	entry = g_slice_new0 (AnchorIndexEntry);
+	entry->n_page = n_page;
+
+	return entry;
+}
+
+static void
+anchor_index_entry_free (AnchorIndexEntry *entry)
+{
+	g_slice_free (AnchorIndexEntry, entry);
+}
+
 /* FixedDoc parser */
 typedef struct _FixedDocParserData {
 	GXPSDocument *doc;
 	Page         *page;
-	guint         n_pages;
-	GList        *pages;
 } FixedDocParserData;
 
+static void
+gxps_document_append_page (GXPSDocument *doc,
+			   Page         *page)
+{
+	g_mutex_lock (&doc->priv->anchors_lock);
+	if (doc->priv->n_pages == doc->priv->pages_size) {
+		doc->priv->pages_size = MAX (16, doc->priv->pages_size * 2);
+		doc->priv->pages = g_renew (Page *, doc->priv->pages, doc->priv->pages_size);
+	}
+	doc->priv->pages[doc->priv->n_pages++] = page;
+	g_mutex_unlock (&doc->priv->anchors_lock);
+}
+
+/* Returns the page at @n_page, or %NULL if it hasn't been loaded */
+static Page *
+gxps_document_lookup_page (GXPSDocument *doc,
+			   guint         n_page)
+{
+	Page *page = NULL;
+
+	g_mutex_lock (&doc->priv->anchors_lock);
+	if (n_page < doc->priv->n_pages)
+		page = doc->priv->pages[n_page];
+	g_mutex_unlock (&doc->priv->anchors_lock);
+
+	return page;
+}
+
+/* Copies the pages loaded so far, so that they can be used without
+ * holding the lock while more pages are appended to the table.
+ */
+static Page **
+gxps_document_dup_pages (GXPSDocument *doc,
+			 guint        *n_pages)
+{
+	Page **pages;
+
+	g_mutex_lock (&doc->priv->anchors_lock);
+	*n_pages = doc->priv->n_pages;
+	pages = g_new (Page *, doc->priv->n_pages);
+	if (doc->priv->n_pages > 0)
+		memcpy (pages, doc->priv->pages, sizeof (Page *) * doc->priv->n_pages);
+	g_mutex_unlock (&doc->priv->anchors_lock);
+
+	return pages;
+}
+
 static void
 fixed_doc_start_element (GMarkupParseContext  *context,
 			 const gchar          *element_name,
@@ -168,8 +291,7 @@ fixed_doc_end_element (GMarkupParseContext  *context,
 	FixedDocParserData *data = (FixedDocParserData *)user_data;
 
 	if (strcmp (element_name, "PageContent") == 0) {
-		data->n_pages++;
-		data->pages = g_list_prepend (data->pages, data->page);
+		gxps_document_append_page (data->doc, data->page);
 		data->page = NULL;
 	} else if (strcmp (element_name, "PageContent.LinkTargets") == 0) {
 		if (!data->page) {
@@ -178,16 +300,7 @@ fixed_doc_end_element (GMarkupParseContext  *context,
 		}
 		data->page->links = g_list_reverse (data->page->links);
 	} else if (strcmp (element_name, "FixedDocument") == 0) {
-		GList *l;
-
-		data->doc->priv->n_pages = data->n_pages;
-                if (data->doc->priv->n_pages > 0) {
-                        data->doc->priv->pages = g_new (Page *, data->n_pages);
-
-                        for (l = data->pages; l; l = g_list_next (l))
-                                data->doc->priv->pages[--data->n_pages] = (Page *)l->data;
-                }
-                g_list_free (data->pages);
+		/* Nothing to do */
 	} else if (strcmp (element_name, "LinkTarget") == 0) {
 		/* Do Nothing */
 	} else {
@@ -207,12 +320,10 @@ static const GMarkupParser fixed_doc_parser = {
 };
 
 static gboolean
-gxps_document_parse_fixed_doc (GXPSDocument *doc,
-			       GError      **error)
+gxps_document_loader_start (GXPSDocument *doc,
+			    GError      **error)
 {
-	GInputStream        *stream;
-	GMarkupParseContext *ctx;
-	FixedDocParserData  *parser_data;
+	GInputStream *stream;
 
 	stream = gxps_archive_open (doc->priv->zip,
 				    doc->priv->source);
@@ -225,17 +336,147 @@ gxps_document_parse_fixed_doc (GXPSDocument *doc,
 		return FALSE;
 	}
 
-	parser_data = g_new0 (FixedDocParserData, 1);
-	parser_data->doc = doc;
-
-	ctx = g_markup_parse_context_new (&fixed_doc_parser, 0, parser_data, NULL);
-	gxps_parse_stream (ctx, stream, error);
+	doc->priv->loader_data = g_new0 (FixedDocParserData, 1);
+	doc->priv->loader_data->doc = doc;
+	doc->priv->loader = g_markup_parse_context_new (&fixed_doc_parser, 0,
+							doc->priv->loader_data, NULL);
+	doc->priv->loader_size = gxps_archive_input_stream_get_size (stream);
+	doc->priv->loader_stream = gxps_parse_stream_open (stream);
 	g_object_unref (stream);
 
-	g_free (parser_data);
-	g_markup_parse_context_free (ctx);
+	return TRUE;
+}
+
+/* Returns the number of bytes parsed, 0 when the whole FixedDocument
+ * has been parsed, or -1 in case of error.
+ */
+static gssize
+gxps_document_loader_step (GXPSDocument *doc,
+			   GError      **error)
+{
+	gssize bytes_read;
+
+	bytes_read = gxps_parse_stream_step (doc->priv->loader,
+					     doc->priv->loader_stream,
+					     error);
+	if (bytes_read > 0)
+		doc->priv->loader_bytes_read += bytes_read;
 
-	return (*error != NULL) ? FALSE : TRUE;
+	return bytes_read;
+}
+
+static void
+gxps_document_loader_finish (GXPSDocument *doc)
+{
+	if (doc->priv->loader_source) {
+		g_source_destroy (doc->priv->loader_source);
+		doc->priv->loader_source = NULL;
+	}
+	g_clear_pointer (&doc->priv->loader_context, g_main_context_unref);
+
+	if (doc->priv->loader_data) {
+		if (doc->priv->loader_data->page)
+			page_free (doc->priv->loader_data->page);
+		g_clear_pointer (&doc->priv->loader_data, g_free);
+	}
+	g_clear_pointer (&doc->priv->loader, g_markup_parse_context_free);
+	g_clear_object (&doc->priv->loader_stream);
+
+	doc->priv->loaded = TRUE;
+}
+
+/* The total number of pages extrapolated from the size of the part of
+ * the FixedDocument parsed so far. It's only approximate, because the
+ * size of the part is the one before converting it to UTF-8.
+ */
+static guint
+gxps_document_estimate_n_pages (GXPSDocument *doc)
+{
+	guint64 n_pages;
+
+	if (doc->priv->loader_size <= 0 || doc->priv->loader_bytes_read == 0)
+		return doc->priv->n_pages;
+
+	n_pages = (guint64)doc->priv->n_pages * doc->priv->loader_size / doc->priv->loader_bytes_read;
+
+	return MAX ((guint)MIN (n_pages, G_MAXUINT), doc->priv->n_pages);
+}
+
+static gboolean
+gxps_document_load_pages_idle (gpointer user_data)
+{
+	GXPSDocument *doc = GXPS_DOCUMENT (user_data);
+	GError       *error = NULL;
+	gssize        bytes_read = 1;
+	gint64        start;
+	guint         i;
+
+	GXPS_TRACE_BEGIN ("document_load", doc->priv->source);
+	start = gxps_archive_stats_begin (doc->priv->zip);
+	for (i = 0; i < LOADER_CHUNKS_PER_ITERATION && bytes_read > 0; i++)
+		bytes_read = gxps_document_loader_step (doc, &error);
+	gxps_archive_stats_end (doc->priv->zip, GXPS_STATS_PHASE_DOCUMENT, start);
+	GXPS_TRACE_END ("document_load");
+
+	g_object_ref (doc);
+
+	if (bytes_read > 0) {
+		g_signal_emit (doc, signals[N_PAGES_CHANGED], 0,
+			       gxps_document_estimate_n_pages (doc), FALSE);
+		g_object_unref (doc);
+
+		return G_SOURCE_CONTINUE;
+	}
+
+	/* The pages loaded before the error are still usable */
+	if (error)
+		g_propagate_error (&doc->priv->load_error, error);
+
+	/* The source is removed when returning */
+	doc->priv->loader_source = NULL;
+	gxps_document_loader_finish (doc);
+
+	g_signal_emit (doc, signals[N_PAGES_CHANGED], 0, doc->priv->n_pages, TRUE);
+	g_object_unref (doc);
+
+	return G_SOURCE_REMOVE;
+}
+
+static gboolean
+gxps_document_parse_fixed_doc (GXPSDocument *doc,
+			       GError      **error)
+{
+	gssize bytes_read;
+
+	if (!gxps_document_loader_start (doc, error))
+		return FALSE;
+
+	GXPS_TRACE_BEGIN ("gxps_parse_stream", doc->priv->source);
+	do {
+		bytes_read = gxps_document_loader_step (doc, error);
+		/* Only the first page is needed to start when loading progressively */
+	} while (bytes_read > 0 && !(doc->priv->progressive && doc->priv->n_pages > 0));
+	GXPS_TRACE_END ("gxps_parse_stream");
+
+	if (bytes_read > 0) {
+		/* Parse the rest in the main loop of this thread. The
+		 * context is kept alive until the loading finishes.
+		 */
+		doc->priv->loader_context = g_main_context_ref_thread_default ();
+		doc->priv->loader_source = g_idle_source_new ();
+		g_source_set_callback (doc->priv->loader_source,
+				       gxps_document_load_pages_idle,
+				       doc, NULL);
+		g_source_attach (doc->priv->loader_source,
+				 doc->priv->loader_context);
+		g_source_unref (doc->priv->loader_source);
+
+		return TRUE;
+	}
+
+	gxps_document_loader_finish (doc);
+
+	return bytes_read == 0;
 }
 
 static void
@@ -314,6 +555,41 @@ gxps_document_parse_rels (GXPSDocument *doc,
 	return retval;
 }
 
+static void
+cached_page_free (CachedPage *cached)
+{
+	if (G_UNLIKELY (!cached))
+		return;
+
+	g_object_unref (cached->page);
+	g_slice_free (CachedPage, cached);
+}
+
+/* Must be called with the page cache lock held */
+static void
+gxps_document_trim_page_cache (GXPSDocument *doc,
+			       guint         size)
+{
+	while (g_queue_get_length (&doc->priv->page_cache) > size)
+		cached_page_free (g_queue_pop_tail (&doc->priv->page_cache));
+}
+
+static void
+gxps_document_dispose (GObject *object)
+{
+	GXPSDocument *doc = GXPS_DOCUMENT (object);
+
+	/* Stop loading pages */
+	if (!doc->priv->loaded)
+		gxps_document_loader_finish (doc);
+
+	g_mutex_lock (&doc->priv->page_cache_lock);
+	gxps_document_trim_page_cache (doc, 0);
+	g_mutex_unlock (&doc->priv->page_cache_lock);
+
+	G_OBJECT_CLASS (gxps_document_parent_class)->dispose (object);
+}
+
 static void
 gxps_document_finalize (GObject *object)
 {
@@ -322,9 +598,13 @@ gxps_document_finalize (GObject *object)
 	g_clear_object (&doc->priv->zip);
 	g_clear_pointer (&doc->priv->source, g_free);
 	g_clear_pointer (&doc->priv->structure, g_free);
+	g_clear_object (&doc->priv->structure_object);
+	g_clear_pointer (&doc->priv->anchors, g_hash_table_destroy);
+	g_mutex_clear (&doc->priv->anchors_lock);
+	g_mutex_clear (&doc->priv->page_cache_lock);
 
 	if (doc->priv->pages) {
-		gint i;
+		guint i;
 
 		for (i = 0; i < doc->priv->n_pages; i++)
 			page_free (doc->priv->pages[i]);
@@ -333,6 +613,7 @@ gxps_document_finalize (GObject *object)
 	}
 
 	g_clear_error (&doc->priv->init_error);
+	g_clear_error (&doc->priv->load_error);
 
 	G_OBJECT_CLASS (gxps_document_parent_class)->finalize (object);
 }
@@ -343,6 +624,9 @@ gxps_document_init (GXPSDocument *doc)
 	doc->priv = gxps_document_get_instance_private (doc);
 
 	doc->priv->has_rels = TRUE;
+	g_mutex_init (&doc->priv->anchors_lock);
+	g_mutex_init (&doc->priv->page_cache_lock);
+	g_queue_init (&doc->priv->page_cache);
 }
 
 static void
@@ -360,6 +644,9 @@ gxps_document_set_property (GObject      *object,
 	case PROP_SOURCE:
 		doc->priv->source = g_value_dup_string (value);
 		break;
+	case PROP_PROGRESSIVE:
+		doc->priv->progressive = g_value_get_boolean (value);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -372,6 +659,7 @@ gxps_document_class_init (GXPSDocumentClass *klass)
 	GObjectClass *object_class = G_OBJECT_CLASS (klass);
 
 	object_class->set_property = gxps_document_set_property;
+	object_class->dispose = gxps_document_dispose;
 	object_class->finalize = gxps_document_finalize;
 
 	g_object_class_install_property (object_class,
@@ -390,6 +678,41 @@ gxps_document_class_init (GXPSDocumentClass *klass)
 							      NULL,
 							      G_PARAM_WRITABLE |
 							      G_PARAM_CONSTRUCT_ONLY));
+	g_object_class_install_property (object_class,
+					 PROP_PROGRESSIVE,
+					 g_param_spec_boolean ("progressive",
+							       "Progressive",
+							       "Whether to load the pages in the main loop",
+							       FALSE,
+							       G_PARAM_WRITABLE |
+							       G_PARAM_CONSTRUCT_ONLY));
+
+	/**
+	 * GXPSDocument::n-pages-changed:
+	 * @doc: the #GXPSDocument
+	 * @n_pages: the estimated number of pages of @doc, or the final
+	 *     one when @loaded is %TRUE
+	 * @loaded: whether all the pages of @doc have been loaded
+	 *
+	 * Emitted while the pages of a document returned by
+	 * gxps_file_get_document_progressive() are loaded, every time
+	 * new pages are available, and once more when the loading
+	 * finishes. gxps_document_get_n_pages() returns the number of
+	 * pages already loaded. If the loading stopped because of an
+	 * error, gxps_document_get_load_error() returns it once @loaded
+	 * is %TRUE.
+	 *
+	 * Since: 0.3.3
+	 */
+	signals[N_PAGES_CHANGED] =
+		g_signal_new ("n-pages-changed",
+			      G_TYPE_FROM_CLASS (klass),
+			      G_SIGNAL_RUN_LAST,
+			      0,
+			      NULL, NULL, NULL,
+			      G_TYPE_NONE, 2,
+			      G_TYPE_UINT,
+			      G_TYPE_BOOLEAN);
 }
 
 static gboolean
@@ -398,6 +721,8 @@ gxps_document_initable_init (GInitable     *initable,
 			     GError       **error)
 {
 	GXPSDocument *doc = GXPS_DOCUMENT (initable);
+	gint64        start;
+	gboolean      parsed;
 
 	if (doc->priv->initialized) {
 		if (doc->priv->init_error) {
@@ -411,7 +736,11 @@ gxps_document_initable_init (GInitable     *initable,
 
 	doc->priv->initialized = TRUE;
 
-	if (!gxps_document_parse_fixed_doc (doc, &doc->priv->init_error)) {
+	start = gxps_archive_stats_begin (doc->priv->zip);
+	parsed = gxps_document_parse_fixed_doc (doc, &doc->priv->init_error);
+	gxps_archive_stats_end (doc->priv->zip, GXPS_STATS_PHASE_DOCUMENT, start);
+
+	if (!parsed) {
 		g_propagate_error (error, g_error_copy (doc->priv->init_error));
 		return FALSE;
 	}
@@ -437,20 +766,86 @@ _gxps_document_new (GXPSArchive *zip,
 			       NULL);
 }
 
+GXPSDocument *
+_gxps_document_new_progressive (GXPSArchive *zip,
+				const gchar *source,
+				GError     **error)
+{
+	return g_initable_new (GXPS_TYPE_DOCUMENT,
+			       NULL, error,
+			       "archive", zip,
+			       "source", source,
+			       "progressive", TRUE,
+			       NULL);
+}
+
 /**
  * gxps_document_get_n_pages:
  * @doc: a #GXPSDocument
  *
- * Gets the number of pages in @doc.
+ * Gets the number of pages in @doc. For documents returned by
+ * gxps_file_get_document_progressive() this is the number of pages
+ * loaded so far, see gxps_document_is_loaded().
  *
  * Returns: the number of pages.
  */
 guint
 gxps_document_get_n_pages (GXPSDocument *doc)
 {
+	guint n_pages;
+
 	g_return_val_if_fail (GXPS_IS_DOCUMENT (doc), 0);
 
-	return doc->priv->n_pages;
+	g_mutex_lock (&doc->priv->anchors_lock);
+	n_pages = doc->priv->n_pages;
+	g_mutex_unlock (&doc->priv->anchors_lock);
+
+	return n_pages;
+}
+
+/**
+ * gxps_document_is_loaded:
+ * @doc: a #GXPSDocument
+ *
+ * Whether all the pages of @doc have been loaded. This is always the
+ * case except for documents returned by
+ * gxps_file_get_document_progressive() until
+ * #GXPSDocument::n-pages-changed is emitted with loaded set to %TRUE.
+ *
+ * Returns: %TRUE if all the pages of @doc are available, %FALSE otherwise.
+ *
+ * Since: 0.3.3
+ */
+gboolean
+gxps_document_is_loaded (GXPSDocument *doc)
+{
+	g_return_val_if_fail (GXPS_IS_DOCUMENT (doc), FALSE);
+
+	return doc->priv->loaded;
+}
+
+/**
+ * gxps_document_get_load_error:
+ * @doc: a #GXPSDocument
+ *
+ * Gets the error that stopped loading the pages of a document returned
+ * by gxps_file_get_document_progressive(). The pages loaded before the
+ * error are still available, but the document might have more pages
+ * than gxps_document_get_n_pages(). Errors found before the first page
+ * is loaded are returned by gxps_file_get_document_progressive() instead.
+ *
+ * Returns: (transfer none) (nullable): the #GError, or %NULL if the
+ *     document is not loaded yet or all its pages were loaded
+ *     successfully. The error is owned by @doc.
+ *
+ * Since: 0.3.3
+ */
+const GError *
+gxps_document_get_load_error (GXPSDocument *doc)
+{
+	g_return_val_if_fail (GXPS_IS_DOCUMENT (doc), NULL);
+
+	return doc->priv->load_error;
 }
 
 /**
@@ -460,7 +855,9 @@ gxps_document_get_n_pages (GXPSDocument *doc)
  * @error: #GError for error reporting, or %NULL to ignore
  *
  * Creates a new #GXPSPage representing the page at
- * index @n_doc in @doc document.
+ * index @n_doc in @doc document. If the page cache is enabled with
+ * gxps_document_set_page_cache_size() and the page is in the cache,
+ * a new reference to the cached #GXPSPage is returned instead.
  *
  * Returns: (transfer full): a new #GXPSPage or %NULL on error.
  *     Free the returned object with g_object_unref().
@@ -470,15 +867,123 @@ gxps_document_get_page (GXPSDocument *doc,
 			guint         n_page,
 			GError      **error)
 {
+	Page        *page_data;
 	const gchar *source;
+	GXPSPage    *page;
+	GList       *l;
 
 	g_return_val_if_fail (GXPS_IS_DOCUMENT (doc), NULL);
-	g_return_val_if_fail (n_page < doc->priv->n_pages, NULL);
 
-	source = doc->priv->pages[n_page]->source;
+	page_data = gxps_document_lookup_page (doc, n_page);
+	g_return_val_if_fail (page_data != NULL, NULL);
+
+	source = page_data->source;
 	g_assert (source != NULL);
 
-	return _gxps_page_new (doc->priv->zip, source, error);
+	g_mutex_lock (&doc->priv->page_cache_lock);
+	if (doc->priv->page_cache_size == 0) {
+		g_mutex_unlock (&doc->priv->page_cache_lock);
+
+		return _gxps_page_new (doc->priv->zip, source, error);
+	}
+
+	/* The cache is small, a list is good enough */
+	for (l = doc->priv->page_cache.head; l; l = l->next) {
+		CachedPage *cached = (CachedPage *)l->data;
+
+		if (cached->n_page == n_page) {
+			g_queue_unlink (&doc->priv->page_cache, l);
+			g_queue_push_head_link (&doc->priv->page_cache, l);
+			page = g_object_ref (cached->page);
+			g_mutex_unlock (&doc->priv->page_cache_lock);
+
+			return page;
+		}
+	}
+	g_mutex_unlock (&doc->priv->page_cache_lock);
+
+	page = _gxps_page_new (doc->priv->zip, source, error);
+	if (!page)
+		return NULL;
+
+	g_mutex_lock (&doc->priv->page_cache_lock);
+	if (doc->priv->page_cache_size > 0) {
+		CachedPage *cached;
+
+		/* Another thread might have loaded the same page meanwhile */
+		for (l = doc->priv->page_cache.head; l; l = l->next) {
+			cached = (CachedPage *)l->data;
+			if (cached->n_page == n_page) {
+				g_object_unref (page);
+				page = g_object_ref (cached->page);
+				g_mutex_unlock (&doc->priv->page_cache_lock);
+
+				return page;
+			}
+		}
+
+		cached = g_slice_new (CachedPage);
+		cached->n_page = n_page;
+		cached->page = g_object_ref (page);
+		g_queue_push_head (&doc->priv->page_cache, cached);
+		gxps_document_trim_page_cache (doc, doc->priv->page_cache_size);
+	}
+	g_mutex_unlock (&doc->priv->page_cache_lock);
+
+	return page;
+}
+
+/**
+ * gxps_document_set_page_cache_size:
+ * @doc: a #GXPSDocument
+ * @n_pages: the maximum number of pages to keep in the cache
+ *
+ * Sets the number of recently used pages kept alive by @doc, so that
+ * gxps_document_get_page() returns the same #GXPSPage for them without
+ * parsing the page again, keeping the images, links and anchors already
+ * loaded for it. When the cache is full the least recently used page is
+ * dropped. The cache is disabled by default, and setting @n_pages to 0
+ * disables it again and drops all the cached pages. Cached pages are
+ * shared by all the callers, so they shouldn't be used from several
+ * threads at the same time.
+ *
+ * Since: 0.3.3
+ */
+void
+gxps_document_set_page_cache_size (GXPSDocument *doc,
+				   guint         n_pages)
+{
+	g_return_if_fail (GXPS_IS_DOCUMENT (doc));
+
+	g_mutex_lock (&doc->priv->page_cache_lock);
+	doc->priv->page_cache_size = n_pages;
+	gxps_document_trim_page_cache (doc, n_pages);
+	g_mutex_unlock (&doc->priv->page_cache_lock);
+}
+
+/**
+ * gxps_document_get_page_cache_size:
+ * @doc: a #GXPSDocument
+ *
+ * Gets the maximum number of pages kept in the page cache of @doc,
+ * see gxps_document_set_page_cache_size().
+ *
+ * Returns: the size of the page cache, 0 if it is disabled.
+ *
+ * Since: 0.3.3
+ */
+guint
+gxps_document_get_page_cache_size (GXPSDocument *doc)
+{
+	guint size;
+
+	g_return_val_if_fail (GXPS_IS_DOCUMENT (doc), 0);
+
+	g_mutex_lock (&doc->priv->page_cache_lock);
+	size = doc->priv->page_cache_size;
+	g_mutex_unlock (&doc->priv->page_cache_lock);
+
+	return size;
 }
 
 /**
@@ -509,9 +1014,10 @@ gxps_document_get_page_size (GXPSDocument *doc,
 	Page *page;
 
 	g_return_val_if_fail (GXPS_IS_DOCUMENT (doc), FALSE);
-	g_return_val_if_fail (n_page < doc->priv->n_pages, FALSE);
 
-	page = doc->priv->pages[n_page];
+	page = gxps_document_lookup_page (doc, n_page);
+	g_return_val_if_fail (page != NULL, FALSE);
+
 	if (page->width == 0 || page->height == 0)
 		return FALSE;
 
@@ -523,13 +1029,187 @@ gxps_document_get_page_size (GXPSDocument *doc,
 	return TRUE;
 }
 
+/* Page sizes */
+typedef struct {
+	GXPSDocument *doc;
+	Page        **pages;
+	gdouble      *widths;
+	gdouble      *heights;
+
+	GMutex        lock;
+	GError       *error;
+} PageSizesContext;
+
+/* Runs in the thread pool, the page index is stored as n_page + 1 */
+static void
+read_page_size (gpointer data,
+		gpointer user_data)
+{
+	PageSizesContext *ctx = (PageSizesContext *)user_data;
+	guint             n_page = GPOINTER_TO_UINT (data) - 1;
+	GXPSPage         *page;
+	GError           *error = NULL;
+
+	/* Creating the page only reads its root FixedPage element */
+	page = _gxps_page_new (ctx->doc->priv->zip,
+			       ctx->pages[n_page]->source,
+			       &error);
+	if (!page) {
+		g_mutex_lock (&ctx->lock);
+		if (!ctx->error)
+			ctx->error = error;
+		else
+			g_error_free (error);
+		g_mutex_unlock (&ctx->lock);
+
+		return;
+	}
+
+	gxps_page_get_size (page, &ctx->widths[n_page], &ctx->heights[n_page]);
+	g_object_unref (page);
+}
+
+/**
+ * gxps_document_get_page_sizes:
+ * @doc: a #GXPSDocument
+ * @n_pages: the number of elements of @widths and @heights
+ * @widths: (out caller-allocates) (array length=n_pages): return location
+ *     for the widths of the pages
+ * @heights: (out caller-allocates) (array length=n_pages): return location
+ *     for the heights of the pages
+ * @error: #GError for error reporting, or %NULL to ignore
+ *
+ * Gets the size of the first @n_pages pages of @doc at once. The advisory
+ * sizes of the document are used when they are available, like in
+ * gxps_document_get_page_size(). For the other pages only the root
+ * element of the page is read, in a pool of threads, which is much
+ * faster than creating every #GXPSPage in order.
+ *
+ * The number of pages of a document that is still being loaded can grow
+ * after gxps_document_get_n_pages() is called, only @n_pages elements are
+ * written. If @doc has less than @n_pages pages, the sizes of the
+ * remaining elements are set to 0.
+ *
+ * Returns: %TRUE if the size of all the pages was found, %FALSE in
+ *     case of error.
+ *
+ * Since: 0.3.3
+ */
+gboolean
+gxps_document_get_page_sizes (GXPSDocument *doc,
+			      guint         n_pages,
+			      gdouble      *widths,
+			      gdouble      *heights,
+			      GError      **error)
+{
+	PageSizesContext ctx;
+	GThreadPool     *pool;
+	Page           **pages;
+	guint            n_doc_pages;
+	guint            n_missing = 0;
+	guint            i;
+
+	g_return_val_if_fail (GXPS_IS_DOCUMENT (doc), FALSE);
+	g_return_val_if_fail (n_pages == 0 || widths != NULL, FALSE);
+	g_return_val_if_fail (n_pages == 0 || heights != NULL, FALSE);
+
+	pages = gxps_document_dup_pages (doc, &n_doc_pages);
+	for (i = n_doc_pages; i < n_pages; i++)
+		widths[i] = heights[i] = 0;
+	n_pages = MIN (n_pages, n_doc_pages);
+
+	for (i = 0; i < n_pages; i++) {
+		Page *page = pages[i];
+
+		if (page->width > 0 && page->height > 0) {
+			widths[i] = page->width;
+			heights[i] = page->height;
+		} else {
+			widths[i] = heights[i] = 0;
+			n_missing++;
+		}
+	}
+
+	if (n_missing == 0) {
+		g_free (pages);
+		return TRUE;
+	}
+
+	ctx.doc = doc;
+	ctx.pages = pages;
+	ctx.widths = widths;
+	ctx.heights = heights;
+	ctx.error = NULL;
+	g_mutex_init (&ctx.lock);
+
+	pool = g_thread_pool_new (read_page_size, &ctx,
+				  MIN ((guint)g_get_num_processors (), n_missing),
+				  FALSE, error);
+	if (!pool) {
+		g_mutex_clear (&ctx.lock);
+		g_free (pages);
+		return FALSE;
+	}
+
+	for (i = 0; i < n_pages; i++) {
+		if (widths[i] == 0)
+			g_thread_pool_push (pool, GUINT_TO_POINTER (i + 1), NULL);
+	}
+
+	/* Wait for all the pages */
+	g_thread_pool_free (pool, FALSE, TRUE);
+	g_mutex_clear (&ctx.lock);
+	g_free (pages);
+
+	if (ctx.error) {
+		g_propagate_error (error, ctx.error);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Must be called with the anchors lock held */
+static void
+gxps_document_build_anchor_index (GXPSDocument *doc)
+{
+	guint i;
+
+	if (doc->priv->anchors && doc->priv->anchors_n_pages == doc->priv->n_pages)
+		return;
+
+	if (!doc->priv->anchors) {
+		doc->priv->anchors = g_hash_table_new_full (g_str_hash,
+							    g_str_equal,
+							    NULL,
+							    (GDestroyNotify)anchor_index_entry_free);
+	}
+
+	/* The first page with the anchor wins, like when looking
+	 * for it page by page. Pages loaded after the index was
+	 * built are added to it.
+	 */
+	for (i = doc->priv->anchors_n_pages; i < doc->priv->n_pages; i++) {
+		GList *l;
+
+		for (l = doc->priv->pages[i]->links; l; l = g_list_next (l)) {
+			if (!g_hash_table_contains (doc->priv->anchors, l->data))
+				g_hash_table_insert (doc->priv->anchors, l->data, anchor_index_entry_new (i));
+		}
+	}
+
+	doc->priv->anchors_n_pages = doc->priv->n_pages;
+}
+
 /**
  * gxps_document_get_page_for_anchor:
  * @doc: a #GXPSDocument
  * @anchor: the name of an anchor
  *
  * Gets the index of the page in @doc where the given
- * anchor is.
+ * anchor is. The anchors of all pages are indexed the
+ * first time this is called, see also
+ * gxps_document_build_anchor_index_async().
  *
  * Returns: the page index of the given anchor.
  */
@@ -537,25 +1217,212 @@ gint
 gxps_document_get_page_for_anchor (GXPSDocument *doc,
 				   const gchar  *anchor)
 {
-	guint i;
+	AnchorIndexEntry *entry;
+	gint              n_page;
 
 	g_return_val_if_fail (GXPS_IS_DOCUMENT (doc), -1);
 	g_return_val_if_fail (anchor != NULL, -1);
 
-	for (i = 0; i < doc->priv->n_pages; i++) {
-		if (g_list_find_custom (doc->priv->pages[i]->links, anchor, (GCompareFunc)strcmp))
-			return i;
+	g_mutex_lock (&doc->priv->anchors_lock);
+	gxps_document_build_anchor_index (doc);
+	entry = g_hash_table_lookup (doc->priv->anchors, anchor);
+	n_page = entry ? (gint)entry->n_page : -1;
+	g_mutex_unlock (&doc->priv->anchors_lock);
+
+	return n_page;
+}
+
+/**
+ * gxps_document_get_anchor_destination:
+ * @doc: a #GXPSDocument
+ * @anchor: the name of an anchor
+ * @n_page: (out) (allow-none): return location for the page index of @anchor
+ * @area: (out) (allow-none): return location for page area of @anchor
+ * @error: #GError for error reporting, or %NULL to ignore
+ *
+ * Gets the page and the rectangle of the page corresponding to the
+ * destination of the given anchor. This is equivalent to calling
+ * gxps_document_get_page_for_anchor() and then
+ * gxps_page_get_anchor_destination(), but the areas of the anchors
+ * are kept in @doc, so the page is only parsed the first time one of
+ * its anchors is requested. If @anchor is not found in @doc, %FALSE
+ * will be returned and @error will contain %GXPS_PAGE_ERROR_INVALID_ANCHOR
+ *
+ * Returns: %TRUE if the destination for the anchor was found in @doc,
+ *     %FALSE otherwise.
+ *
+ * Since: 0.3.3
+ */
+gboolean
+gxps_document_get_anchor_destination (GXPSDocument      *doc,
+				      const gchar       *anchor,
+				      guint             *n_page,
+				      cairo_rectangle_t *area,
+				      GError           **error)
+{
+	AnchorIndexEntry *entry;
+	GXPSPage         *page;
+	GHashTable       *page_anchors;
+	cairo_rectangle_t anchor_area;
+	guint             page_index;
+	gboolean          found;
+	GError           *err = NULL;
+
+	g_return_val_if_fail (GXPS_IS_DOCUMENT (doc), FALSE);
+	g_return_val_if_fail (anchor != NULL, FALSE);
+
+	g_mutex_lock (&doc->priv->anchors_lock);
+	gxps_document_build_anchor_index (doc);
+	entry = g_hash_table_lookup (doc->priv->anchors, anchor);
+	if (!entry) {
+		g_mutex_unlock (&doc->priv->anchors_lock);
+		g_set_error (error,
+			     GXPS_PAGE_ERROR,
+			     GXPS_PAGE_ERROR_INVALID_ANCHOR,
+			     "Invalid anchor '%s' for document", anchor);
+		return FALSE;
 	}
 
-	return -1;
+	page_index = entry->n_page;
+	if (entry->has_area) {
+		anchor_area = entry->area;
+		g_mutex_unlock (&doc->priv->anchors_lock);
+
+		if (n_page)
+			*n_page = page_index;
+		if (area)
+			*area = anchor_area;
+
+		return TRUE;
+	}
+	g_mutex_unlock (&doc->priv->anchors_lock);
+
+	page = gxps_document_get_page (doc, page_index, error);
+	if (!page)
+		return FALSE;
+
+	found = gxps_page_get_anchor_destination (page, anchor, &anchor_area, &err);
+	if (!found) {
+		if (err) {
+			g_propagate_error (error, err);
+		} else {
+			g_set_error (error,
+				     GXPS_PAGE_ERROR,
+				     GXPS_PAGE_ERROR_INVALID_ANCHOR,
+				     "Invalid anchor '%s' for page", anchor);
+		}
+		g_object_unref (page);
+
+		return FALSE;
+	}
+
+	/* Keep the areas of all the anchors of the page */
+	page_anchors = _gxps_page_get_anchors (page);
+	if (page_anchors) {
+		GHashTableIter iter;
+		gpointer       key, value;
+
+		g_mutex_lock (&doc->priv->anchors_lock);
+		g_hash_table_iter_init (&iter, page_anchors);
+		while (g_hash_table_iter_next (&iter, &key, &value)) {
+			entry = g_hash_table_lookup (doc->priv->anchors, key);
+			if (entry && entry->n_page == page_index && !entry->has_area) {
+				entry->area = *(cairo_rectangle_t *)value;
+				entry->has_area = TRUE;
+			}
+		}
+		g_mutex_unlock (&doc->priv->anchors_lock);
+	}
+	g_object_unref (page);
+
+	if (n_page)
+		*n_page = page_index;
+	if (area)
+		*area = anchor_area;
+
+	return TRUE;
+}
+
+static void
+build_anchor_index_thread (GTask        *task,
+			   gpointer      source_object,
+			   gpointer      task_data,
+			   GCancellable *cancellable)
+{
+	GXPSDocument *doc = GXPS_DOCUMENT (source_object);
+
+	if (g_task_return_error_if_cancelled (task))
+		return;
+
+	g_mutex_lock (&doc->priv->anchors_lock);
+	gxps_document_build_anchor_index (doc);
+	g_mutex_unlock (&doc->priv->anchors_lock);
+
+	g_task_return_boolean (task, TRUE);
+}
+
+/**
+ * gxps_document_build_anchor_index_async:
+ * @doc: a #GXPSDocument
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @callback: a #GAsyncReadyCallback to call when the index is built
+ * @user_data: the data to pass to @callback
+ *
+ * Builds the index of the anchors of @doc in a thread, so that the
+ * first call to gxps_document_get_page_for_anchor() or
+ * gxps_document_get_anchor_destination() doesn't have to do it. The
+ * index is otherwise built on first use. The areas of the anchors are
+ * not part of the index until their pages are parsed.
+ *
+ * Since: 0.3.3
+ */
+void
+gxps_document_build_anchor_index_async (GXPSDocument        *doc,
+					GCancellable        *cancellable,
+					GAsyncReadyCallback  callback,
+					gpointer             user_data)
+{
+	GTask *task;
+
+	g_return_if_fail (GXPS_IS_DOCUMENT (doc));
+
+	task = g_task_new (doc, cancellable, callback, user_data);
+	g_task_run_in_thread (task, build_anchor_index_thread);
+	g_object_unref (task);
+}
+
+/**
+ * gxps_document_build_anchor_index_finish:
+ * @doc: a #GXPSDocument
+ * @result: the #GAsyncResult passed to the callback
+ * @error: #GError for error reporting, or %NULL to ignore
+ *
+ * Finishes an operation started with
+ * gxps_document_build_anchor_index_async().
+ *
+ * Returns: %TRUE if the index was built, %FALSE if the operation
+ *     was cancelled.
+ *
+ * Since: 0.3.3
+ */
+gboolean
+gxps_document_build_anchor_index_finish (GXPSDocument *doc,
+					 GAsyncResult *result,
+					 GError      **error)
+{
+	g_return_val_if_fail (GXPS_IS_DOCUMENT (doc), FALSE);
+	g_return_val_if_fail (g_task_is_valid (result, doc), FALSE);
+
+	return g_task_propagate_boolean (G_TASK (result), error);
 }
 
 /**
  * gxps_document_get_structure:
  * @doc: a a #GXPSDocument
  *
- * Creates a new #GXPSDocumentStructure representing the document
- * structure of @doc.
+ * Gets the #GXPSDocumentStructure representing the document
+ * structure of @doc. The structure is shared by all the callers,
+ * so its outline is only parsed once.
  *
  * Returns: (transfer full): a new #GXPSDocumentStructure or %NULL if document doesn't have a structure.
  *     Free the returned object with g_object_unref().
@@ -573,10 +1440,188 @@ gxps_document_get_structure (GXPSDocument *doc)
 	if (!doc->priv->structure)
 		return NULL;
 
+	if (doc->priv->structure_object)
+		return g_object_ref (doc->priv->structure_object);
+
 	if (!gxps_archive_has_entry (doc->priv->zip, doc->priv->structure))
 		return NULL;
 
-	return _gxps_document_structure_new (doc->priv->zip,
-					     doc->priv->structure);
+	doc->priv->structure_object = _gxps_document_structure_new (doc->priv->zip,
+								    doc->priv->structure);
+
+	return g_object_ref (doc->priv->structure_object);
+}
+
+
+/* Text extraction */
+typedef struct {
+	GXPSPage *page;
+	GError   *error;
+	gboolean  done;
+} ExtractTextPage;
+
+typedef struct {
+	GXPSDocument    *doc;
+	GCancellable    *cancellable;
+	Page           **sources;
+	ExtractTextPage *pages;
+
+	GMutex           lock;
+	GCond            cond;
+} ExtractTextContext;
+
+/* Runs in the thread pool, the page index is stored as n_page + 1 */
+static void
+extract_text_page (gpointer data,
+		   gpointer user_data)
+{
+	ExtractTextContext *ctx = (ExtractTextContext *)user_data;
+	guint               n_page = GPOINTER_TO_UINT (data) - 1;
+	GXPSPage           *page = NULL;
+	GError             *error = NULL;
+
+	if (!g_cancellable_is_cancelled (ctx->cancellable)) {
+		/* Pages are only used once, so they don't go to the page cache */
+		page = _gxps_page_new (ctx->doc->priv->zip,
+				       ctx->sources[n_page]->source,
+				       &error);
+		if (page && !gxps_page_get_text_runs (page, &error))
+			g_clear_object (&page);
+	}
+
+	g_mutex_lock (&ctx->lock);
+	ctx->pages[n_page].page = page;
+	ctx->pages[n_page].error = error;
+	ctx->pages[n_page].done = TRUE;
+	g_cond_broadcast (&ctx->cond);
+	g_mutex_unlock (&ctx->lock);
 }
 
+/**
+ * GXPSTextFunc:
+ * @n_page: the index of the page in the document
+ * @n_run: the index of the text run in the page
+ * @text: the text of the run in UTF-8
+ * @extents: the area of the run in page coordinates
+ * @user_data: user data passed to gxps_document_extract_text()
+ *
+ * The type of the function called by gxps_document_extract_text()
+ * for every text run of a document.
+ *
+ * Since: 0.3.3
+ */
+
+/**
+ * gxps_document_extract_text:
+ * @doc: a #GXPSDocument
+ * @func: (scope call): a #GXPSTextFunc to call for every text run
+ * @user_data: the data to pass to @func
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @error: #GError for error reporting, or %NULL to ignore
+ *
+ * Extracts the text of all the pages of @doc, calling @func for every
+ * run of text, like the ones returned by gxps_page_get_text(). Pages
+ * are parsed in a pool of threads, but @func is always called in the
+ * thread calling this function, in page order and in document order
+ * inside every page. Pages are not rendered, and fonts are loaded only
+ * once for the whole file, so this is suitable to index large
+ * documents. Extraction stops at the first page that fails to be parsed.
+ *
+ * Returns: %TRUE if the text of all the pages was extracted, %FALSE
+ *     in case of error or if the operation was cancelled.
+ *
+ * Since: 0.3.3
+ */
+gboolean
+gxps_document_extract_text (GXPSDocument *doc,
+			    GXPSTextFunc  func,
+			    gpointer      user_data,
+			    GCancellable *cancellable,
+			    GError      **error)
+{
+	ExtractTextContext ctx;
+	GThreadPool       *pool;
+	guint              n_pages;
+	guint              n_threads;
+	guint              window;
+	guint              n_page, i;
+	gboolean           retval = TRUE;
+
+	g_return_val_if_fail (GXPS_IS_DOCUMENT (doc), FALSE);
+	g_return_val_if_fail (func != NULL, FALSE);
+
+	ctx.sources = gxps_document_dup_pages (doc, &n_pages);
+	if (n_pages == 0) {
+		g_free (ctx.sources);
+		return TRUE;
+	}
+
+	ctx.doc = doc;
+	ctx.cancellable = cancellable;
+	ctx.pages = g_new0 (ExtractTextPage, n_pages);
+	g_mutex_init (&ctx.lock);
+	g_cond_init (&ctx.cond);
+
+	n_threads = MIN ((guint)g_get_num_processors (), n_pages);
+	pool = g_thread_pool_new (extract_text_page, &ctx, n_threads, FALSE, error);
+	if (!pool) {
+		g_mutex_clear (&ctx.lock);
+		g_cond_clear (&ctx.cond);
+		g_free (ctx.pages);
+		g_free (ctx.sources);
+
+		return FALSE;
+	}
+
+	/* Only a few pages ahead of the one being delivered are queued,
+	 * so that the memory used doesn't depend on the number of pages.
+	 */
+	window = MIN (n_threads * 2, n_pages);
+	for (i = 0; i < window; i++)
+		g_thread_pool_push (pool, GUINT_TO_POINTER (i + 1), NULL);
+
+	for (n_page = 0; n_page < n_pages && retval; n_page++) {
+		ExtractTextPage *page = &ctx.pages[n_page];
+		GArray          *runs;
+
+		g_mutex_lock (&ctx.lock);
+		while (!page->done)
+			g_cond_wait (&ctx.cond, &ctx.lock);
+		g_mutex_unlock (&ctx.lock);
+
+		if (n_page + window < n_pages)
+			g_thread_pool_push (pool, GUINT_TO_POINTER (n_page + window + 1), NULL);
+
+		if (g_cancellable_set_error_if_cancelled (cancellable, error)) {
+			retval = FALSE;
+		} else if (page->error) {
+			g_propagate_error (error, page->error);
+			page->error = NULL;
+			retval = FALSE;
+		} else {
+			/* Already parsed by the worker, so this can't fail */
+			runs = gxps_page_get_text_runs (page->page, NULL);
+			for (i = 0; i < runs->len; i++) {
+				GXPSTextRun *run = &g_array_index (runs, GXPSTextRun, i);
+
+				func (n_page, i, run->text, &run->extents, user_data);
+			}
+		}
+
+		g_clear_object (&page->page);
+	}
+
+	/* Drop the queued pages and wait for the ones being parsed */
+	g_thread_pool_free (pool, TRUE, TRUE);
+
+	for (i = n_page; i < n_pages; i++) {
+		g_clear_object (&ctx.pages[i].page);
+		g_clear_error (&ctx.pages[i].error);
+	}
+	g_mutex_clear (&ctx.lock);
+	g_cond_clear (&ctx.cond);
+	g_free (ctx.pages);
+	g_free (ctx.sources);
+
+	return retval;
+}
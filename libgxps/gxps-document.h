@@ -45,6 +45,12 @@ typedef struct _GXPSDocument        GXPSDocument;
 typedef struct _GXPSDocumentClass   GXPSDocumentClass;
 typedef struct _GXPSDocumentPrivate GXPSDocumentPrivate;
 
+typedef void (* GXPSTextFunc) (guint                    n_page,
+			       guint                    n_run,
+			       const gchar             *text,
+			       const cairo_rectangle_t *extents,
+			       gpointer                 user_data);
+
 /**
  * GXPSDocument:
  *
@@ -68,19 +74,58 @@ GType                  gxps_document_get_type            (void) G_GNUC_CONST;
 GXPS_AVAILABLE_IN_ALL
 guint                  gxps_document_get_n_pages         (GXPSDocument *doc);
 GXPS_AVAILABLE_IN_ALL
+gboolean               gxps_document_is_loaded           (GXPSDocument *doc);
+GXPS_AVAILABLE_IN_ALL
+const GError          *gxps_document_get_load_error      (GXPSDocument *doc);
+GXPS_AVAILABLE_IN_ALL
 GXPSPage              *gxps_document_get_page            (GXPSDocument *doc,
 							  guint         n_page,
 							  GError      **error);
 GXPS_AVAILABLE_IN_ALL
+void                   gxps_document_set_page_cache_size (GXPSDocument *doc,
+							  guint         n_pages);
+GXPS_AVAILABLE_IN_ALL
+guint                  gxps_document_get_page_cache_size (GXPSDocument *doc);
+GXPS_AVAILABLE_IN_ALL
 gboolean               gxps_document_get_page_size       (GXPSDocument *doc,
 							  guint         n_page,
 							  gdouble      *width,
 							  gdouble      *height);
 GXPS_AVAILABLE_IN_ALL
+gboolean               gxps_document_get_page_sizes      (GXPSDocument *doc,
+							  guint         n_pages,
+							  gdouble      *widths,
+							  gdouble      *heights,
+							  GError      **error);
+GXPS_AVAILABLE_IN_ALL
 gint                   gxps_document_get_page_for_anchor (GXPSDocument *doc,
 							  const gchar  *anchor);
 GXPS_AVAILABLE_IN_ALL
+gboolean               gxps_document_get_anchor_destination
+							 (GXPSDocument      *doc,
+							  const gchar       *anchor,
+							  guint             *n_page,
+							  cairo_rectangle_t *area,
+							  GError           **error);
+GXPS_AVAILABLE_IN_ALL
+void                   gxps_document_build_anchor_index_async
+							 (GXPSDocument        *doc,
+							  GCancellable        *cancellable,
+							  GAsyncReadyCallback  callback,
+							  gpointer             user_data);
+GXPS_AVAILABLE_IN_ALL
+gboolean               gxps_document_build_anchor_index_finish
+							 (GXPSDocument *doc,
+							  GAsyncResult *result,
+							  GError      **error);
+GXPS_AVAILABLE_IN_ALL
 GXPSDocumentStructure *gxps_document_get_structure       (GXPSDocument *doc);
+GXPS_AVAILABLE_IN_ALL
+gboolean               gxps_document_extract_text        (GXPSDocument *doc,
+							  GXPSTextFunc  func,
+							  gpointer      user_data,
+							  GCancellable *cancellable,
+							  GError      **error);
 
 G_END_DECLS
 
@@ -20,9 +20,11 @@
 #include <config.h>
 
 #include <string.h>
+#include <math.h>
 
 #include "gxps-file.h"
 #include "gxps-archive.h"
+#include "gxps-page-private.h"
 #include "gxps-private.h"
 #include "gxps-error.h"
 #include "gxps-debug.h"
@@ -55,6 +57,8 @@ struct _GXPSFilePrivate {
 	gchar       *fixed_repr;
 	gchar       *thumbnail;
 	gchar       *core_props;
+
+	gint64       open_time;
 };
 
 static void initable_iface_init (GInitableIface *initable_iface);
@@ -290,6 +294,7 @@ gxps_file_initable_init (GInitable     *initable,
 			 GError       **error)
 {
 	GXPSFile *xps = GXPS_FILE (initable);
+	gint64    start;
 
 	if (xps->priv->initialized) {
 		if (xps->priv->init_error) {
@@ -302,6 +307,11 @@ gxps_file_initable_init (GInitable     *initable,
 
 	xps->priv->initialized = TRUE;
 
+	/* Stats can't be enabled before the file is opened, but the
+	 * open time is cheap enough to be always measured.
+	 */
+	start = g_get_monotonic_time ();
+
 	xps->priv->docs = g_ptr_array_new_with_free_func (g_free);
 
 	xps->priv->zip = gxps_archive_new (xps->priv->file, &xps->priv->init_error);
@@ -338,6 +348,8 @@ gxps_file_initable_init (GInitable     *initable,
 		return FALSE;
 	}
 
+	xps->priv->open_time = g_get_monotonic_time () - start;
+
 	return TRUE;
 }
 
@@ -412,6 +424,44 @@ gxps_file_get_document (GXPSFile *xps,
 	return _gxps_document_new (xps->priv->zip, source, error);
 }
 
+/**
+ * gxps_file_get_document_progressive:
+ * @xps: a #GXPSFile
+ * @n_doc: the index of the document to get
+ * @error: #GError for error reporting, or %NULL to ignore
+ *
+ * Creates a new #GXPSDocument representing the document at index
+ * @n_doc in @xps file, like gxps_file_get_document(), but returning
+ * as soon as the first page of the document is available. The rest of
+ * the pages are loaded in the thread-default main context of the
+ * calling thread, and #GXPSDocument::n-pages-changed is emitted as
+ * they become available. This is useful to show the first page of
+ * documents with a large number of pages without delay. The document
+ * should only be used from the calling thread until it is loaded.
+ * Errors found after the first page are returned by
+ * gxps_document_get_load_error().
+ *
+ * Returns: (transfer full): a new #GXPSDocument or %NULL on error.
+ *     Free the returned object with g_object_unref().
+ *
+ * Since: 0.3.3
+ */
+GXPSDocument *
+gxps_file_get_document_progressive (GXPSFile *xps,
+				    guint     n_doc,
+				    GError  **error)
+{
+	const gchar  *source;
+
+	g_return_val_if_fail (GXPS_IS_FILE (xps), NULL);
+	g_return_val_if_fail (n_doc < xps->priv->docs->len, NULL);
+
+	source = g_ptr_array_index (xps->priv->docs, n_doc);
+	g_assert (source != NULL);
+
+	return _gxps_document_new_progressive (xps->priv->zip, source, error);
+}
+
 /**
  * gxps_file_get_document_for_link_target:
  * @xps: a #GXPSFile
@@ -472,3 +522,214 @@ gxps_file_get_core_properties (GXPSFile *xps,
                                           xps->priv->core_props,
                                           error);
 }
+
+/* Returns a new reference to @surface if it already fits in
+ * @max_size pixels or a scaled down copy otherwise.
+ */
+static cairo_surface_t *
+gxps_file_scale_thumbnail (cairo_surface_t *surface,
+			   guint            max_size)
+{
+	cairo_surface_t *thumbnail;
+	cairo_t         *cr;
+	gint             width, height;
+	gdouble          scale;
+
+	width = cairo_image_surface_get_width (surface);
+	height = cairo_image_surface_get_height (surface);
+	if (max_size == 0 || ((guint)width <= max_size && (guint)height <= max_size))
+		return cairo_surface_reference (surface);
+
+	scale = (gdouble)max_size / MAX (width, height);
+	thumbnail = cairo_image_surface_create (cairo_image_surface_get_format (surface),
+						MAX (1, (gint)(width * scale + 0.5)),
+						MAX (1, (gint)(height * scale + 0.5)));
+	cr = cairo_create (thumbnail);
+	cairo_scale (cr, scale, scale);
+	cairo_set_source_surface (cr, surface, 0, 0);
+	cairo_pattern_set_filter (cairo_get_source (cr), CAIRO_FILTER_GOOD);
+	cairo_paint (cr);
+	cairo_destroy (cr);
+
+	return thumbnail;
+}
+
+static cairo_surface_t *
+gxps_file_render_thumbnail (GXPSFile *xps,
+			    guint     max_size,
+			    GError  **error)
+{
+	GXPSDocument    *doc;
+	GXPSPage        *page;
+	cairo_surface_t *surface;
+	cairo_t         *cr;
+	gdouble          width, height;
+	gdouble          scale = 1.0;
+	gboolean         success;
+
+	doc = gxps_file_get_document (xps, 0, error);
+	if (!doc)
+		return NULL;
+
+	if (gxps_document_get_n_pages (doc) == 0) {
+		g_set_error_literal (error,
+				     GXPS_FILE_ERROR,
+				     GXPS_FILE_ERROR_INVALID,
+				     "Invalid XPS File: no pages found");
+		g_object_unref (doc);
+		return NULL;
+	}
+
+	page = gxps_document_get_page (doc, 0, error);
+	g_object_unref (doc);
+	if (!page)
+		return NULL;
+
+	gxps_page_get_size (page, &width, &height);
+	if (max_size > 0 && MAX (width, height) > max_size)
+		scale = max_size / MAX (width, height);
+
+	surface = cairo_image_surface_create (CAIRO_FORMAT_RGB24,
+					      MAX (1, (gint)ceil (width * scale)),
+					      MAX (1, (gint)ceil (height * scale)));
+	if (cairo_surface_status (surface)) {
+		g_set_error (error,
+			     GXPS_ERROR,
+			     GXPS_ERROR_IMAGE,
+			     "Error creating thumbnail: %s",
+			     cairo_status_to_string (cairo_surface_status (surface)));
+		cairo_surface_destroy (surface);
+		g_object_unref (page);
+		return NULL;
+	}
+
+	cr = cairo_create (surface);
+	cairo_set_source_rgb (cr, 1.0, 1.0, 1.0);
+	cairo_paint (cr);
+	cairo_scale (cr, scale, scale);
+	success = gxps_page_render_draft (page, cr, error);
+	cairo_destroy (cr);
+	g_object_unref (page);
+
+	if (!success) {
+		cairo_surface_destroy (surface);
+		return NULL;
+	}
+
+	return surface;
+}
+
+/**
+ * gxps_file_get_thumbnail:
+ * @xps: a #GXPSFile
+ * @max_size: the maximum width and height of the thumbnail in pixels,
+ *     or 0 for no limit
+ * @error: #GError for error reporting, or %NULL to ignore
+ *
+ * Gets a thumbnail of @xps that is at most @max_size pixels wide and
+ * high. The thumbnail image stored in the package is used when there's
+ * one, otherwise the first page of the first document is rendered in
+ * draft mode: images are decoded at the thumbnail resolution and text
+ * too small to be readable is not drawn.
+ *
+ * Returns: (transfer full): a new cairo image surface or %NULL on error.
+ *    Free the returned surface with cairo_surface_destroy().
+ *
+ * Since: 0.3.3
+ */
+cairo_surface_t *
+gxps_file_get_thumbnail (GXPSFile *xps,
+			 guint     max_size,
+			 GError  **error)
+{
+	g_return_val_if_fail (GXPS_IS_FILE (xps), NULL);
+
+	if (xps->priv->thumbnail) {
+		GXPSImage *image;
+
+		image = gxps_images_get_image (xps->priv->zip, xps->priv->thumbnail, 0,
+					       CAIRO_SURFACE_TYPE_IMAGE, NULL);
+		if (image) {
+			cairo_surface_t *thumbnail;
+
+			thumbnail = gxps_file_scale_thumbnail (image->surface, max_size);
+			gxps_image_free (image);
+
+			return thumbnail;
+		}
+
+		GXPS_DEBUG (g_message ("Failed to load package thumbnail %s",
+				       xps->priv->thumbnail));
+	}
+
+	return gxps_file_render_thumbnail (xps, max_size, error);
+}
+
+/**
+ * gxps_file_set_stats_enabled:
+ * @xps: a #GXPSFile
+ * @enabled: whether to collect stats
+ *
+ * Enables or disables collecting performance counters for @xps and its
+ * documents and pages. Stats are disabled by default, since collecting
+ * them has a small cost. Disabling them discards the counters collected
+ * so far.
+ *
+ * Since: 0.3.3
+ */
+void
+gxps_file_set_stats_enabled (GXPSFile *xps,
+			     gboolean  enabled)
+{
+	g_return_if_fail (GXPS_IS_FILE (xps));
+
+	gxps_archive_set_stats_enabled (xps->priv->zip, enabled);
+}
+
+/**
+ * gxps_file_get_stats:
+ * @xps: a #GXPSFile
+ *
+ * Gets the performance counters of @xps, the sum of all the work
+ * done for the file and its documents and pages since stats were
+ * enabled with gxps_file_set_stats_enabled() or reset with
+ * gxps_file_reset_stats(). The time of %GXPS_STATS_PHASE_OPEN is
+ * always the time spent in gxps_file_new().
+ *
+ * Returns: (transfer full) (nullable): a new #GXPSStats if stats are
+ *     enabled, %NULL otherwise. Free the returned value with gxps_stats_free().
+ *
+ * Since: 0.3.3
+ */
+GXPSStats *
+gxps_file_get_stats (GXPSFile *xps)
+{
+	GXPSStats *stats;
+
+	g_return_val_if_fail (GXPS_IS_FILE (xps), NULL);
+
+	stats = gxps_archive_get_stats (xps->priv->zip);
+	if (!stats)
+		return NULL;
+
+	stats->phase_time[GXPS_STATS_PHASE_OPEN] = xps->priv->open_time;
+
+	return stats;
+}
+
+/**
+ * gxps_file_reset_stats:
+ * @xps: a #GXPSFile
+ *
+ * Sets all the performance counters of @xps to zero. The counters
+ * of the pages are not reset.
+ *
+ * Since: 0.3.3
+ */
+void
+gxps_file_reset_stats (GXPSFile *xps)
+{
+	g_return_if_fail (GXPS_IS_FILE (xps));
+
+	gxps_archive_reset_stats (xps->priv->zip);
+}
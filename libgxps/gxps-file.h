@@ -30,6 +30,7 @@
 #include "gxps-document.h"
 #include "gxps-links.h"
 #include "gxps-core-properties.h"
+#include "gxps-stats.h"
 
 G_BEGIN_DECLS
 
@@ -95,11 +96,26 @@ GXPSDocument       *gxps_file_get_document                 (GXPSFile       *xps,
                                                             guint           n_doc,
                                                             GError        **error);
 GXPS_AVAILABLE_IN_ALL
+GXPSDocument       *gxps_file_get_document_progressive     (GXPSFile       *xps,
+                                                            guint           n_doc,
+                                                            GError        **error);
+GXPS_AVAILABLE_IN_ALL
 gint                gxps_file_get_document_for_link_target (GXPSFile       *xps,
                                                             GXPSLinkTarget *target);
 GXPS_AVAILABLE_IN_ALL
 GXPSCoreProperties *gxps_file_get_core_properties          (GXPSFile       *xps,
                                                             GError        **error);
+GXPS_AVAILABLE_IN_ALL
+cairo_surface_t    *gxps_file_get_thumbnail                (GXPSFile       *xps,
+                                                            guint           max_size,
+                                                            GError        **error);
+GXPS_AVAILABLE_IN_ALL
+void                gxps_file_set_stats_enabled            (GXPSFile       *xps,
+                                                            gboolean        enabled);
+GXPS_AVAILABLE_IN_ALL
+GXPSStats          *gxps_file_get_stats                    (GXPSFile       *xps);
+GXPS_AVAILABLE_IN_ALL
+void                gxps_file_reset_stats                  (GXPSFile       *xps);
 
 G_END_DECLS
 
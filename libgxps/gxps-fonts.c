@@ -27,6 +27,7 @@
 
 #include "gxps-fonts.h"
 #include "gxps-error.h"
+#include "gxps-trace.h"
 
 #define FONTS_CACHE_KEY "gxps-fonts-cache"
 
@@ -34,6 +35,12 @@ static gsize ft_font_face_cache = 0;
 static FT_Library ft_lib;
 static const cairo_user_data_key_t ft_cairo_key;
 
+/* Protects the fonts cache of every archive, the global cache of
+ * FreeType faces and the FreeType library, so that pages of the same
+ * file can be processed in several threads.
+ */
+static GMutex fonts_lock;
+
 static void
 init_ft_lib (void)
 {
@@ -278,15 +285,26 @@ gxps_fonts_get_font (GXPSArchive *zip,
 {
 	GHashTable        *fonts_cache;
 	cairo_font_face_t *font_face = NULL;
+	gint64             start;
+
+	g_mutex_lock (&fonts_lock);
 
 	fonts_cache = g_object_get_data (G_OBJECT (zip), FONTS_CACHE_KEY);
 	if (fonts_cache) {
 		font_face = g_hash_table_lookup (fonts_cache, font_uri);
-		if (font_face)
+		if (font_face) {
+			g_mutex_unlock (&fonts_lock);
+			GXPS_STATS_ADD (zip, FONT_CACHE_HITS, 1);
 			return font_face;
+		}
 	}
 
+	GXPS_STATS_ADD (zip, FONT_CACHE_MISSES, 1);
+	start = gxps_archive_stats_begin (zip);
+	GXPS_TRACE_BEGIN ("font_load", font_uri);
 	font_face = gxps_fonts_new_font_face (zip, font_uri, error);
+	GXPS_TRACE_END ("font_load");
+	gxps_archive_stats_end (zip, GXPS_STATS_PHASE_FONT_LOAD, start);
 	if (font_face) {
 		if (!fonts_cache) {
 			fonts_cache = g_hash_table_new_full (g_str_hash,
@@ -303,5 +321,7 @@ gxps_fonts_get_font (GXPSArchive *zip,
 				     cairo_font_face_reference (font_face));
 	}
 
+	g_mutex_unlock (&fonts_lock);
+
 	return font_face;
 }
@@ -623,8 +623,9 @@ glyphs_end_element (GMarkupParseContext  *context,
 
                 brush = g_markup_parse_context_pop (context);
                 if (!glyphs->opacity_mask) {
-                        glyphs->opacity_mask = cairo_pattern_reference (brush->pattern);
+                        glyphs->opacity_mask = gxps_brush_pattern_realize (brush->pattern, glyphs->ctx);
                         cairo_push_group (glyphs->ctx->cr);
+                        GXPS_STATS_ADD (glyphs->ctx->page->priv->zip, PUSH_GROUPS, 1);
                 }
                 gxps_brush_free (brush);
         } else {
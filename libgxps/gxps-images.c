@@ -38,12 +38,17 @@
 #endif
 
 #include "gxps-images.h"
+#include "gxps-pixels.h"
 #include "gxps-error.h"
 #include "gxps-debug.h"
+#include "gxps-trace.h"
 
 #define METERS_PER_INCH 0.0254
 #define CENTIMETERS_PER_INCH 2.54
 
+/* Largest factor an image is subsampled by when decoded */
+#define MAX_SUBSAMPLE 32
+
 #ifdef G_OS_WIN32
 #define COBJMACROS
 #include <wincodec.h>
@@ -51,6 +56,94 @@
 #include <combaseapi.h>
 #endif
 
+/* Returns the factor by which an image with the given native resolution
+ * can be decimated while still providing at least @target_res pixels per
+ * inch. A @target_res of 0 means the full resolution is needed.
+ */
+static guint
+gxps_images_get_subsample (gdouble res_x,
+			   gdouble res_y,
+			   gdouble target_res)
+{
+	gdouble factor;
+
+	if (target_res <= 0)
+		return 1;
+
+	factor = MIN (res_x, res_y) / target_res;
+	if (factor < 2)
+		return 1;
+
+	return (guint) MIN (factor, MAX_SUBSAMPLE);
+}
+
+/* Vector surfaces can embed the original JPEG and PNG data instead of
+ * re-encoding the decoded pixels. Images are decoded at full resolution
+ * for them, so the whole part is read once and decoded from memory,
+ * keeping the bytes to attach them to the surface.
+ */
+static GBytes *
+gxps_images_read_encoded_data (GXPSArchive *zip,
+			       const gchar *image_uri)
+{
+	guchar *data;
+	gsize   length;
+
+	if (!gxps_archive_read_entry (zip, image_uri, &data, &length, NULL))
+		return NULL;
+
+	return g_bytes_new_take (data, length);
+}
+
+#if defined (HAVE_LIBPNG) || defined (HAVE_LIBJPEG)
+static GInputStream *
+gxps_images_open (GXPSArchive *zip,
+		  const gchar *image_uri,
+		  GBytes      *bytes)
+{
+	if (bytes)
+		return g_memory_input_stream_new_from_bytes (bytes);
+
+	return gxps_archive_open (zip, image_uri);
+}
+
+/* Attaches the encoded data the image was decoded from, together with
+ * an identifier of the image part, so that the same image used in
+ * several pages is only embedded once.
+ */
+static void
+gxps_images_set_mime_data (GXPSImage   *image,
+			   const gchar *mime_type,
+			   GBytes      *bytes,
+			   GXPSArchive *zip,
+			   const gchar *image_uri)
+{
+#ifdef CAIRO_MIME_TYPE_UNIQUE_ID
+	gchar *file_uri;
+	gchar *unique_id;
+#endif
+
+	if (!bytes || image->subsample != 1)
+		return;
+
+	cairo_surface_set_mime_data (image->surface, mime_type,
+				     g_bytes_get_data (bytes, NULL),
+				     g_bytes_get_size (bytes),
+				     (cairo_destroy_func_t) g_bytes_unref,
+				     g_bytes_ref (bytes));
+
+#ifdef CAIRO_MIME_TYPE_UNIQUE_ID
+	file_uri = g_file_get_uri (gxps_archive_get_file (zip));
+	unique_id = g_strconcat (file_uri, "#", image_uri, NULL);
+	g_free (file_uri);
+
+	cairo_surface_set_mime_data (image->surface, CAIRO_MIME_TYPE_UNIQUE_ID,
+				     (guchar *) unique_id, strlen (unique_id),
+				     (cairo_destroy_func_t) g_free, unique_id);
+#endif
+}
+#endif /* HAVE_LIBPNG || HAVE_LIBJPEG */
+
 /* PNG */
 #ifdef HAVE_LIBPNG
 
@@ -84,64 +177,20 @@ png_warning_callback (png_structp png,
 {
 }
 
-/* From cairo's cairo-png.c <http://cairographics.org> */
-static inline int
-multiply_alpha (int alpha, int color)
-{
-	int temp = (alpha * color) + 0x80;
-
-	return ((temp + (temp >> 8)) >> 8);
-}
-
-/* Premultiplies data and converts RGBA bytes => native endian
- * From cairo's cairo-png.c <http://cairographics.org> */
+/* Premultiplies data and converts RGBA bytes => native endian */
 static void
 premultiply_data (png_structp   png,
                   png_row_infop row_info,
                   png_bytep     data)
 {
-	unsigned int i;
-
-	for (i = 0; i < row_info->rowbytes; i += 4) {
-		uint8_t *base  = &data[i];
-		uint8_t  alpha = base[3];
-		uint32_t p;
-
-		if (alpha == 0) {
-			p = 0;
-		} else {
-			uint8_t red   = base[0];
-			uint8_t green = base[1];
-			uint8_t blue  = base[2];
-
-			if (alpha != 0xff) {
-				red   = multiply_alpha (alpha, red);
-				green = multiply_alpha (alpha, green);
-				blue  = multiply_alpha (alpha, blue);
-			}
-			p = (alpha << 24) | (red << 16) | (green << 8) | (blue << 0);
-		}
-		memcpy (base, &p, sizeof (uint32_t));
-	}
+	gxps_pixels_premultiply_rgba ((guint32 *)data, data, row_info->rowbytes / 4);
 }
 
-/* Converts RGBx bytes to native endian xRGB
- * From cairo's cairo-png.c <http://cairographics.org> */
+/* Converts RGBx bytes to native endian xRGB */
 static void
 convert_bytes_to_data (png_structp png, png_row_infop row_info, png_bytep data)
 {
-	unsigned int i;
-
-	for (i = 0; i < row_info->rowbytes; i += 4) {
-		uint8_t *base  = &data[i];
-		uint8_t  red   = base[0];
-		uint8_t  green = base[1];
-		uint8_t  blue  = base[2];
-		uint32_t pixel;
-
-		pixel = (0xff << 24) | (red << 16) | (green << 8) | (blue << 0);
-		memcpy (base, &pixel, sizeof (uint32_t));
-	}
+	gxps_pixels_rgbx_to_xrgb ((guint32 *)data, data, row_info->rowbytes / 4);
 }
 
 static void
@@ -171,6 +220,9 @@ fill_png_error (GError      **error,
 static GXPSImage *
 gxps_images_create_from_png (GXPSArchive *zip,
 			     const gchar *image_uri,
+			     gdouble      target_res,
+			     GBytes      *bytes,
+			     gboolean     header_only,
 			     GError     **error)
 {
 #ifdef HAVE_LIBPNG
@@ -181,13 +233,16 @@ gxps_images_create_from_png (GXPSArchive *zip,
 	png_info      *info;
 	png_byte      *data = NULL;
 	png_byte     **row_pointers = NULL;
+	png_byte      *row = NULL;
 	png_uint_32    png_width, png_height;
+	png_uint_32    width, height;
 	int            depth, color_type, interlace, stride;
 	unsigned int   i;
+	guint          subsample;
 	cairo_format_t format;
 	cairo_status_t status;
 
-	stream = gxps_archive_open (zip, image_uri);
+	stream = gxps_images_open (zip, image_uri, bytes);
 	if (!stream) {
 		g_set_error (error,
 			     GXPS_ERROR,
@@ -224,6 +279,7 @@ gxps_images_create_from_png (GXPSArchive *zip,
 		png_destroy_read_struct (&png, &info, NULL);
 		gxps_image_free (image);
 		g_free (row_pointers);
+		g_free (row);
 		g_free (data);
 		return NULL;
 	}
@@ -292,14 +348,6 @@ gxps_images_create_from_png (GXPSArchive *zip,
 		break;
 	}
 
-	stride = cairo_format_stride_for_width (format, png_width);
-	if (stride < 0 || png_height >= INT_MAX / stride) {
-		fill_png_error (error, image_uri, NULL);
-		g_object_unref (stream);
-		png_destroy_read_struct (&png, &info, NULL);
-		return NULL;
-	}
-
 	image = g_slice_new0 (GXPSImage);
 	image->res_x = png_get_x_pixels_per_meter (png, info) * METERS_PER_INCH;
 	if (image->res_x == 0)
@@ -308,20 +356,75 @@ gxps_images_create_from_png (GXPSArchive *zip,
 	if (image->res_y == 0)
 		image->res_y = 96;
 
-	data = g_malloc (png_height * stride);
-	row_pointers = g_new (png_byte *, png_height);
+	/* Interlaced images need all the passes to be read
+	 * before any row is complete, always decode them fully.
+	 */
+	subsample = 1;
+	if (interlace == PNG_INTERLACE_NONE)
+		subsample = gxps_images_get_subsample (image->res_x, image->res_y, target_res);
+
+	width = (png_width + subsample - 1) / subsample;
+	height = (png_height + subsample - 1) / subsample;
+	image->res_x = image->res_x * width / png_width;
+	image->res_y = image->res_y * height / png_height;
+	image->subsample = subsample;
+	image->width = width;
+	image->height = height;
+
+	if (header_only) {
+		png_destroy_read_struct (&png, &info, NULL);
+		g_object_unref (stream);
+
+		return image;
+	}
+
+	stride = cairo_format_stride_for_width (format, width);
+	if (stride < 0 || height >= INT_MAX / stride) {
+		fill_png_error (error, image_uri, NULL);
+		g_object_unref (stream);
+		png_destroy_read_struct (&png, &info, NULL);
+		gxps_image_free (image);
+		return NULL;
+	}
 
-	for (i = 0; i < png_height; i++)
-		row_pointers[i] = &data[i * stride];
+	data = g_malloc (height * stride);
+
+	if (subsample == 1) {
+		row_pointers = g_new (png_byte *, png_height);
+
+		for (i = 0; i < png_height; i++)
+			row_pointers[i] = &data[i * stride];
+
+		png_read_image (png, row_pointers);
+	} else {
+		/* Decode row by row keeping only every subsample-th
+		 * pixel of every subsample-th row.
+		 */
+		row = g_malloc (png_get_rowbytes (png, info));
+
+		for (i = 0; i < png_height; i++) {
+			guint32 *src, *dst;
+			guint    x;
+
+			png_read_row (png, row, NULL);
+			if (i % subsample)
+				continue;
+
+			src = (guint32 *)row;
+			dst = (guint32 *)&data[(i / subsample) * stride];
+			for (x = 0; x < width; x++)
+				dst[x] = src[x * subsample];
+		}
+	}
 
-	png_read_image (png, row_pointers);
 	png_read_end (png, info);
 	png_destroy_read_struct (&png, &info, NULL);
 	g_object_unref (stream);
 	g_free (row_pointers);
+	g_free (row);
 
 	image->surface = cairo_image_surface_create_for_data (data, format,
-							      png_width, png_height,
+							      width, height,
 							      stride);
 	if (cairo_surface_status (image->surface)) {
 		fill_png_error (error, image_uri, NULL);
@@ -341,6 +444,8 @@ gxps_images_create_from_png (GXPSArchive *zip,
 		return NULL;
 	}
 
+	gxps_images_set_mime_data (image, CAIRO_MIME_TYPE_PNG, bytes, zip, image_uri);
+
 	return image;
 #else
     return NULL;
@@ -540,6 +645,9 @@ _jpeg_read_exif_resolution (jpeg_saved_marker_ptr marker,
 static GXPSImage *
 gxps_images_create_from_jpeg (GXPSArchive *zip,
 			      const gchar *image_uri,
+			      gdouble      target_res,
+			      GBytes      *bytes,
+			      gboolean     header_only,
 			      GError     **error)
 {
 #ifdef HAVE_LIBJPEG
@@ -554,8 +662,11 @@ gxps_images_create_from_jpeg (GXPSArchive *zip,
 	gint                          jpeg_stride;
 	gint                          i;
         int                           res_x, res_y;
+	gdouble                       native_res_x, native_res_y;
+	guint                         subsample;
+	gboolean                      embed;
 
-	stream = gxps_archive_open (zip, image_uri);
+	stream = gxps_images_open (zip, image_uri, bytes);
 	if (!stream) {
 		g_set_error (error,
 			     GXPS_ERROR,
@@ -598,15 +709,51 @@ gxps_images_create_from_jpeg (GXPSArchive *zip,
 
 	jpeg_read_header (&cinfo, TRUE);
 
+	native_res_x = 96;
+	native_res_y = 96;
+        if (_jpeg_read_exif_resolution (cinfo.marker_list, &res_x, &res_y)) {
+                if (res_x > 0)
+                        native_res_x = res_x;
+                if (res_y > 0)
+                        native_res_y = res_y;
+        } else if (cinfo.density_unit == 1) { /* dots/inch */
+		native_res_x = cinfo.X_density;
+		native_res_y = cinfo.Y_density;
+	} else if (cinfo.density_unit == 2) { /* dots/cm */
+		native_res_x = cinfo.X_density * CENTIMETERS_PER_INCH;
+		native_res_y = cinfo.Y_density * CENTIMETERS_PER_INCH;
+	}
+
+	/* Let the IDCT scale the image down, libjpeg
+	 * supports 1/2, 1/4 and 1/8 of the full size.
+	 */
+	subsample = gxps_images_get_subsample (native_res_x, native_res_y, target_res);
+	cinfo.scale_num = 1;
+	cinfo.scale_denom = subsample >= 8 ? 8 : subsample >= 4 ? 4 : subsample >= 2 ? 2 : 1;
+
 	cinfo.do_fancy_upsampling = FALSE;
+	jpeg_calc_output_dimensions (&cinfo);
+
+	image = g_slice_new0 (GXPSImage);
+	image->res_x = native_res_x * cinfo.output_width / cinfo.image_width;
+	image->res_y = native_res_y * cinfo.output_height / cinfo.image_height;
+	image->subsample = cinfo.scale_denom;
+	image->width = cinfo.output_width;
+	image->height = cinfo.output_height;
+
+	/* Progressive images are fully read by jpeg_start_decompress() */
+	if (header_only) {
+		jpeg_destroy_decompress (&cinfo);
+		g_object_unref (stream);
+
+		return image;
+	}
+
 	jpeg_start_decompress (&cinfo);
 
-	image = g_slice_new (GXPSImage);
 	image->surface = cairo_image_surface_create (CAIRO_FORMAT_RGB24,
 						     cinfo.output_width,
 						     cinfo.output_height);
-	image->res_x = 96;
-	image->res_y = 96;
 	if (cairo_surface_status (image->surface)) {
 		g_set_error (error,
 			     GXPS_ERROR,
@@ -627,62 +774,41 @@ gxps_images_create_from_jpeg (GXPSArchive *zip,
 	lines = cinfo.mem->alloc_sarray((j_common_ptr) &cinfo, JPOOL_IMAGE, jpeg_stride, 4);
 
 	while (cinfo.output_scanline < cinfo.output_height) {
-		gint n_lines, x;
+		gint n_lines;
 
 		n_lines = jpeg_read_scanlines (&cinfo, lines, cinfo.rec_outbuf_height);
 		for (i = 0; i < n_lines; i++) {
 			JSAMPLE *line = lines[i];
-			guchar  *p = data;
-
-			for (x = 0; x < cinfo.output_width; x++) {
-				switch (cinfo.out_color_space) {
-				case JCS_RGB:
-					p[0] = line[2];
-					p[1] = line[1];
-					p[2] = line[0];
-					p[3] = 0xff;
-					break;
-                                case JCS_GRAYSCALE:
-                                        p[0] = line[0];
-                                        p[1] = line[0];
-                                        p[2] = line[0];
-                                        p[3] = 0xff;
-                                        break;
-                                case JCS_CMYK:
-                                        p[0] = line[2] * line[3] / 255;
-                                        p[1] = line[1] * line[3] / 255;
-                                        p[2] = line[0] * line[3] / 255;
-                                        p[3] = 0xff;
-                                        break;
-				default:
-					GXPS_DEBUG (g_message ("Unsupported jpeg color space %s",
-                                                               _jpeg_color_space_name (cinfo.out_color_space)));
-
-					gxps_image_free (image);
-					jpeg_destroy_decompress (&cinfo);
-					g_object_unref (stream);
-					return NULL;
-				}
-				line += cinfo.out_color_components;
-				p += 4;
+			guint32 *p = (guint32 *)data;
+
+			switch (cinfo.out_color_space) {
+			case JCS_RGB:
+				gxps_pixels_rgb_to_xrgb (p, line, cinfo.output_width);
+				break;
+			case JCS_GRAYSCALE:
+				gxps_pixels_gray_to_xrgb (p, line, cinfo.output_width);
+				break;
+			case JCS_CMYK:
+				gxps_pixels_cmyk_to_xrgb (p, line, cinfo.output_width);
+				break;
+			default:
+				GXPS_DEBUG (g_message ("Unsupported jpeg color space %s",
+						       _jpeg_color_space_name (cinfo.out_color_space)));
+
+				gxps_image_free (image);
+				jpeg_destroy_decompress (&cinfo);
+				g_object_unref (stream);
+				return NULL;
 			}
 
 			data += stride;
 		}
 	}
 
-        if (_jpeg_read_exif_resolution (cinfo.marker_list, &res_x, &res_y)) {
-                if (res_x > 0)
-                        image->res_x = res_x;
-                if (res_y > 0)
-                        image->res_y = res_y;
-        } else if (cinfo.density_unit == 1) { /* dots/inch */
-		image->res_x = cinfo.X_density;
-		image->res_y = cinfo.Y_density;
-	} else if (cinfo.density_unit == 2) { /* dots/cm */
-		image->res_x = cinfo.X_density * CENTIMETERS_PER_INCH;
-		image->res_y = cinfo.Y_density * CENTIMETERS_PER_INCH;
-	}
+	/* Adobe CMYK JPEGs are usually stored inverted, which PDF
+	 * viewers don't know about, so only embed RGB and gray ones.
+	 */
+	embed = cinfo.out_color_space != JCS_CMYK;
 
 	jpeg_finish_decompress (&cinfo);
 	jpeg_destroy_decompress (&cinfo);
@@ -702,6 +828,9 @@ gxps_images_create_from_jpeg (GXPSArchive *zip,
 		return NULL;
 	}
 
+	if (embed)
+		gxps_images_set_mime_data (image, CAIRO_MIME_TYPE_JPEG, bytes, zip, image_uri);
+
 	return image;
 #else
 	return NULL;
@@ -710,15 +839,22 @@ gxps_images_create_from_jpeg (GXPSArchive *zip,
 
 /* Tiff */
 #ifdef HAVE_LIBTIFF
+#define TIFF_READ_SIZE 65536
+
 static TIFFErrorHandler orig_error_handler = NULL;
 static TIFFErrorHandler orig_warning_handler = NULL;
 static gchar *_tiff_error = NULL;
 
+/* The archive streams can only be read forward, so the entry is
+ * inflated once into buffer as libtiff reads it, and seeking backwards
+ * reads from the buffer instead of reopening the entry.
+ */
 typedef struct {
-	guchar *buffer;
-	gsize   buffer_len;
-	guint   pos;
-} TiffBuffer;
+	GInputStream *stream;
+	GByteArray   *buffer;
+	toff_t        pos;
+	toff_t        size;
+} TiffStream;
 
 static void
 fill_tiff_error (GError     **error,
@@ -767,20 +903,102 @@ _tiff_pop_handlers (void)
 	TIFFSetWarningHandler (orig_warning_handler);
 }
 
+/* Reads from the entry until at least @end bytes are buffered.
+ * Returns %FALSE if the entry ends before.
+ */
+static gboolean
+tiff_stream_fill (TiffStream *tstream,
+		  toff_t      end)
+{
+	while (tstream->buffer->len < end) {
+		guint  len = tstream->buffer->len;
+		gsize  count = MAX (end - len, TIFF_READ_SIZE);
+		gssize bytes_read;
+
+		/* Don't grow the buffer past the size of the entry */
+		if (tstream->size > len)
+			count = MIN (count, tstream->size - len);
+
+		g_byte_array_set_size (tstream->buffer, len + count);
+		bytes_read = g_input_stream_read (tstream->stream,
+						  tstream->buffer->data + len,
+						  count, NULL, NULL);
+		g_byte_array_set_size (tstream->buffer, len + MAX (bytes_read, 0));
+		if (bytes_read <= 0)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+tiff_stream_init (TiffStream  *tstream,
+		  GXPSArchive *zip,
+		  const gchar *image_uri)
+{
+	gssize size;
+
+	tstream->stream = gxps_archive_open (zip, image_uri);
+	tstream->buffer = NULL;
+	tstream->pos = 0;
+	tstream->size = 0;
+	if (!tstream->stream)
+		return FALSE;
+
+	/* The uncompressed size of the zip entry, when it's known */
+	size = gxps_archive_input_stream_get_size (tstream->stream);
+	if (size >= 0 && (gsize)size > G_MAXUINT - TIFF_READ_SIZE)
+		return FALSE;
+
+	if (size >= 0) {
+		tstream->buffer = g_byte_array_sized_new (size);
+		tstream->size = size;
+
+		return TRUE;
+	}
+
+	/* Otherwise the whole entry is read now, it will be needed anyway */
+	tstream->buffer = g_byte_array_new ();
+	while (tiff_stream_fill (tstream, (toff_t)tstream->buffer->len + 1)) {
+		if (tstream->buffer->len > G_MAXUINT - TIFF_READ_SIZE)
+			return FALSE;
+	}
+	tstream->size = tstream->buffer->len;
+
+	return TRUE;
+}
+
+static void
+tiff_stream_clear (TiffStream *tstream)
+{
+	g_clear_object (&tstream->stream);
+	if (tstream->buffer) {
+		g_byte_array_unref (tstream->buffer);
+		tstream->buffer = NULL;
+	}
+}
+
 static tsize_t
 _tiff_read (thandle_t handle,
 	    tdata_t   buf,
 	    tsize_t   size)
 {
-	TiffBuffer *buffer = (TiffBuffer *)handle;
+	TiffStream *tstream = (TiffStream *)handle;
+	gsize       bytes_read;
+
+	if (size <= 0 || tstream->pos >= tstream->size)
+		return 0;
 
-	if (buffer->pos + size > buffer->buffer_len)
+	/* A short read is reported to libtiff, which handles it */
+	tiff_stream_fill (tstream, MIN (tstream->pos + size, tstream->size));
+	if (tstream->pos >= tstream->buffer->len)
 		return 0;
 
-	memcpy (buf, buffer->buffer + buffer->pos, size);
-	buffer->pos += size;
+	bytes_read = MIN ((gsize)size, tstream->buffer->len - tstream->pos);
+	memcpy (buf, tstream->buffer->data + tstream->pos, bytes_read);
+	tstream->pos += bytes_read;
 
-	return size;
+	return bytes_read;
 }
 
 static tsize_t
@@ -796,29 +1014,30 @@ _tiff_seek (thandle_t handle,
 	    toff_t    offset,
 	    int       whence)
 {
-	TiffBuffer *buffer = (TiffBuffer *)handle;
+	TiffStream *tstream = (TiffStream *)handle;
+	toff_t      pos;
 
 	switch (whence) {
 	case SEEK_SET:
-		if (offset > buffer->buffer_len)
-			return -1;
-		buffer->pos = offset;
+		pos = offset;
 		break;
 	case SEEK_CUR:
-		if (offset + buffer->pos >= buffer->buffer_len)
-			return -1;
-		buffer->pos += offset;
+		pos = tstream->pos + offset;
 		break;
 	case SEEK_END:
-		if (offset + buffer->buffer_len > buffer->buffer_len)
-			return -1;
-		buffer->pos = buffer->buffer_len + offset;
+		pos = tstream->size + offset;
 		break;
 	default:
 		return -1;
 	}
 
-	return buffer->pos;
+	if (pos > tstream->size)
+		return -1;
+
+	/* The data is read from the entry when libtiff reads it */
+	tstream->pos = pos;
+
+	return tstream->pos;
 }
 
 static int
@@ -830,9 +1049,9 @@ _tiff_close (thandle_t context)
 static toff_t
 _tiff_size (thandle_t handle)
 {
-	TiffBuffer *buffer = (TiffBuffer *)handle;
+	TiffStream *tstream = (TiffStream *)handle;
 
-	return buffer->buffer_len;
+	return tstream->size;
 }
 
 static int
@@ -840,11 +1059,6 @@ _tiff_map_file (thandle_t handle,
 		tdata_t  *buf,
 		toff_t   *size)
 {
-	TiffBuffer *buffer = (TiffBuffer *)handle;
-
-	*buf = buffer->buffer;
-	*size = buffer->buffer_len;
-
 	return 0;
 }
 
@@ -854,36 +1068,66 @@ _tiff_unmap_file (thandle_t handle,
 		  toff_t    offset)
 {
 }
+
+/* Converts the ABGR pixels returned by libtiff to native endian ARGB */
+static void
+convert_tiff_row (guint32 *dst,
+		  guint32 *src,
+		  gint     width,
+		  guint    subsample)
+{
+	gint x;
+
+	if (subsample > 1) {
+		for (x = 0; x < width; x++)
+			dst[x] = src[x * subsample];
+		src = dst;
+	}
+
+	gxps_pixels_abgr_to_argb (dst, src, width);
+}
 #endif /* #ifdef HAVE_LIBTIFF */
 
 static GXPSImage *
 gxps_images_create_from_tiff (GXPSArchive *zip,
 			      const gchar *image_uri,
+			      gdouble      target_res,
+			      gboolean     header_only,
 			      GError     **error)
 {
 #ifdef HAVE_LIBTIFF
-	TIFF       *tiff;
-	TiffBuffer  buffer;
-	GXPSImage  *image;
-	gint        width, height;
-	guint16     res_unit;
-	float       res_x, res_y;
-	gint        stride;
-	guchar     *data;
-	guchar     *p;
-
-        if (!gxps_archive_read_entry (zip, image_uri,
-                                      &buffer.buffer,
-                                      &buffer.buffer_len,
-                                      error)) {
-                return NULL;
-        }
-
-	buffer.pos = 0;
+	TIFF         *tiff;
+	TiffStream    tstream;
+	TIFFRGBAImage img;
+	char          emsg[1024];
+	GXPSImage    *image;
+	gint          width, height;
+	gint          out_width, out_height;
+	guint16       res_unit;
+	float         res_x, res_y;
+	guint16       orientation;
+	gboolean      bottom_up;
+	guint32       rows_per_chunk;
+	guint32      *chunk = NULL;
+	guint         subsample;
+	gint          stride;
+	gint          y;
+	guchar       *data;
+
+	if (!tiff_stream_init (&tstream, zip, image_uri)) {
+		g_set_error (error,
+			     GXPS_ERROR,
+			     GXPS_ERROR_SOURCE_NOT_FOUND,
+			     "Image source %s not found in archive",
+			     image_uri);
+		tiff_stream_clear (&tstream);
+		return NULL;
+	}
 
 	_tiff_push_handlers ();
 
-	tiff = TIFFClientOpen ("libgxps-tiff", "r", &buffer,
+	/* Memory mapping is not possible on archive streams */
+	tiff = TIFFClientOpen ("libgxps-tiff", "rm", &tstream,
 			       _tiff_read,
 			       _tiff_write,
 			       _tiff_seek,
@@ -897,7 +1141,7 @@ gxps_images_create_from_tiff (GXPSArchive *zip,
 		if (tiff)
 			TIFFClose (tiff);
 		_tiff_pop_handlers ();
-		g_free (buffer.buffer);
+		tiff_stream_clear (&tstream);
 		return NULL;
 	}
 
@@ -905,7 +1149,7 @@ gxps_images_create_from_tiff (GXPSArchive *zip,
 		fill_tiff_error (error, image_uri);
 		TIFFClose (tiff);
 		_tiff_pop_handlers ();
-		g_free (buffer.buffer);
+		tiff_stream_clear (&tstream);
 		return NULL;
 	}
 
@@ -913,7 +1157,7 @@ gxps_images_create_from_tiff (GXPSArchive *zip,
 		fill_tiff_error (error, image_uri);
 		TIFFClose (tiff);
 		_tiff_pop_handlers ();
-		g_free (buffer.buffer);
+		tiff_stream_clear (&tstream);
 		return NULL;
 	}
 
@@ -921,13 +1165,11 @@ gxps_images_create_from_tiff (GXPSArchive *zip,
 		fill_tiff_error (error, image_uri);
 		TIFFClose (tiff);
 		_tiff_pop_handlers ();
-		g_free (buffer.buffer);
+		tiff_stream_clear (&tstream);
 		return NULL;
 	}
 
-	image = g_slice_new (GXPSImage);
-	image->surface = cairo_image_surface_create (CAIRO_FORMAT_RGB24,
-						     width, height);
+	image = g_slice_new0 (GXPSImage);
 	image->res_x = 96;
 	image->res_y = 96;
 
@@ -948,6 +1190,25 @@ gxps_images_create_from_tiff (GXPSArchive *zip,
 		}
 	}
 
+	subsample = gxps_images_get_subsample (image->res_x, image->res_y, target_res);
+	out_width = (width + subsample - 1) / subsample;
+	out_height = (height + subsample - 1) / subsample;
+	image->res_x = image->res_x * out_width / width;
+	image->res_y = image->res_y * out_height / height;
+	image->subsample = subsample;
+	image->width = out_width;
+	image->height = out_height;
+
+	if (header_only) {
+		TIFFClose (tiff);
+		_tiff_pop_handlers ();
+		tiff_stream_clear (&tstream);
+
+		return image;
+	}
+
+	image->surface = cairo_image_surface_create (CAIRO_FORMAT_RGB24,
+						     out_width, out_height);
 	if (cairo_surface_status (image->surface)) {
 		g_set_error (error,
 			     GXPS_ERROR,
@@ -958,40 +1219,103 @@ gxps_images_create_from_tiff (GXPSArchive *zip,
 		gxps_image_free (image);
 		TIFFClose (tiff);
 		_tiff_pop_handlers ();
-		g_free (buffer.buffer);
+		tiff_stream_clear (&tstream);
 		return NULL;
 	}
 
-	data = cairo_image_surface_get_data (image->surface);
-	if (!TIFFReadRGBAImageOriented (tiff, width, height,
-					(uint32 *)data,
-					ORIENTATION_TOPLEFT, 1) || _tiff_error) {
+	if (!TIFFRGBAImageOK (tiff, emsg) ||
+	    !TIFFRGBAImageBegin (&img, tiff, 1, emsg) || _tiff_error) {
+		if (!_tiff_error)
+			_tiff_error = g_strdup (emsg);
 		fill_tiff_error (error, image_uri);
 		gxps_image_free (image);
 		TIFFClose (tiff);
 		_tiff_pop_handlers ();
-		g_free (buffer.buffer);
+		tiff_stream_clear (&tstream);
 		return NULL;
 	}
+	img.req_orientation = ORIENTATION_TOPLEFT;
 
-	TIFFClose (tiff);
-	_tiff_pop_handlers ();
-	g_free (buffer.buffer);
+	/* libtiff flips the rows of every chunk of a bottom-origin image,
+	 * but the chunks themselves are stored bottom first.
+	 */
+	if (!TIFFGetFieldDefaulted (tiff, TIFFTAG_ORIENTATION, &orientation))
+		orientation = ORIENTATION_TOPLEFT;
+	bottom_up = orientation == ORIENTATION_BOTLEFT ||
+		orientation == ORIENTATION_BOTRIGHT ||
+		orientation == ORIENTATION_LEFTBOT ||
+		orientation == ORIENTATION_RIGHTBOT;
+
+	/* Decode a strip, or a row of tiles, at a time */
+	if (TIFFIsTiled (tiff)) {
+		if (!TIFFGetField (tiff, TIFFTAG_TILELENGTH, &rows_per_chunk))
+			rows_per_chunk = height;
+	} else {
+		if (!TIFFGetFieldDefaulted (tiff, TIFFTAG_ROWSPERSTRIP, &rows_per_chunk))
+			rows_per_chunk = height;
+	}
+	rows_per_chunk = CLAMP (rows_per_chunk, 1, (guint32)height);
 
+	data = cairo_image_surface_get_data (image->surface);
 	stride = cairo_image_surface_get_stride (image->surface);
-	p = data;
-	while (p < data + (height * stride)) {
-		guint32 *pixel = (guint32 *)p;
-		guint8   r = TIFFGetR (*pixel);
-		guint8   g = TIFFGetG (*pixel);
-		guint8   b = TIFFGetB (*pixel);
-		guint8   a = TIFFGetA (*pixel);
 
-		*pixel = (a << 24) | (r << 16) | (g << 8) | b;
+	/* At full resolution the rows of a RGB24 surface are exactly
+	 * width pixels long, so libtiff decodes straight into the surface.
+	 * Otherwise a single chunk is decoded and decimated into it.
+	 */
+	if (subsample > 1) {
+		chunk = g_try_malloc ((gsize)width * rows_per_chunk * sizeof (guint32));
+		if (!chunk) {
+			g_set_error (error,
+				     GXPS_ERROR,
+				     GXPS_ERROR_IMAGE,
+				     "Error loading TIFF image %s: out of memory",
+				     image_uri);
+			TIFFRGBAImageEnd (&img);
+			gxps_image_free (image);
+			TIFFClose (tiff);
+			_tiff_pop_handlers ();
+			tiff_stream_clear (&tstream);
+			return NULL;
+		}
+	}
+
+	/* y is the first row of the chunk in the file */
+	for (y = 0; y < height; y += rows_per_chunk) {
+		gint     n_rows = MIN ((gint)rows_per_chunk, height - y);
+		gint     dst_y = bottom_up ? height - y - n_rows : y;
+		guint32 *raster = chunk ? chunk : (guint32 *)(data + dst_y * stride);
+		gint     row;
+
+		img.row_offset = y;
+		img.col_offset = 0;
+		if (!TIFFRGBAImageGet (&img, raster, width, n_rows) || _tiff_error) {
+			fill_tiff_error (error, image_uri);
+			g_free (chunk);
+			TIFFRGBAImageEnd (&img);
+			gxps_image_free (image);
+			TIFFClose (tiff);
+			_tiff_pop_handlers ();
+			tiff_stream_clear (&tstream);
+			return NULL;
+		}
+
+		for (row = 0; row < n_rows; row++) {
+			if ((dst_y + row) % subsample)
+				continue;
 
-		p += 4;
+			convert_tiff_row ((guint32 *)(data + ((dst_y + row) / subsample) * stride),
+					  raster + (gsize)row * width,
+					  out_width, subsample);
+		}
 	}
 
+	g_free (chunk);
+	TIFFRGBAImageEnd (&img);
+	TIFFClose (tiff);
+	_tiff_pop_handlers ();
+	tiff_stream_clear (&tstream);
+
 	cairo_surface_mark_dirty (image->surface);
 
 	return image;
@@ -1030,6 +1354,9 @@ image_create_from_byte_array (BYTE    *bytes,
 	image = g_slice_new0 (GXPSImage);
 	image->res_x = 96;
 	image->res_y = 96;
+	image->subsample = 1;
+	image->width = width;
+	image->height = height;
 
 	image->surface = cairo_image_surface_create_for_data (data, CAIRO_FORMAT_ARGB32, width, height, stride);
 	if (cairo_surface_status (image->surface) != CAIRO_STATUS_SUCCESS) {
@@ -1296,13 +1623,22 @@ gxps_images_guess_content_type (GXPSArchive *zip,
 	return mime_type;
 }
 
-GXPSImage *
-gxps_images_get_image (GXPSArchive *zip,
-		       const gchar *image_uri,
-		       GError     **error)
+static GXPSImage *
+gxps_images_load (GXPSArchive          *zip,
+		  const gchar          *image_uri,
+		  gdouble               target_res,
+		  cairo_surface_type_t  target_type,
+		  gboolean              header_only,
+		  GError              **error)
 {
 	GXPSImage *image = NULL;
+	GBytes *bytes = NULL;
 	gchar *image_uri_lower;
+	/* Images decoded at full resolution are for vector backends, which
+	 * embed the original JPEG data, but only the SVG one uses PNG data.
+	 */
+	gboolean keep_jpeg = !header_only && target_res <= 0;
+	gboolean keep_png = keep_jpeg && target_type == CAIRO_SURFACE_TYPE_SVG;
 
 	/* First try with extensions,
 	 * as it's recommended by the spec
@@ -1310,13 +1646,21 @@ gxps_images_get_image (GXPSArchive *zip,
 	 */
 	image_uri_lower = g_utf8_strdown (image_uri, -1);
 	if (g_str_has_suffix (image_uri_lower, ".png")) {
-		image = gxps_images_create_from_png (zip, image_uri, error);
+		if (keep_png)
+			bytes = gxps_images_read_encoded_data (zip, image_uri);
+		image = gxps_images_create_from_png (zip, image_uri, target_res, bytes, header_only, error);
 	} else if (g_str_has_suffix (image_uri_lower, ".jpg")) {
-		image = gxps_images_create_from_jpeg (zip, image_uri, error);
+		if (keep_jpeg)
+			bytes = gxps_images_read_encoded_data (zip, image_uri);
+		image = gxps_images_create_from_jpeg (zip, image_uri, target_res, bytes, header_only, error);
 	} else if (g_str_has_suffix (image_uri_lower, ".tif")) {
-		image = gxps_images_create_from_tiff (zip, image_uri, error);
+		image = gxps_images_create_from_tiff (zip, image_uri, target_res, header_only, error);
 	} else if (g_str_has_suffix (image_uri_lower, "wdp")) {
 #ifdef G_OS_WIN32
+		if (header_only) {
+			g_free (image_uri_lower);
+			return NULL;
+		}
 		image = gxps_images_create_from_wdp (zip, image_uri, error);
 #else
 		GXPS_DEBUG (g_message ("Unsupported image format windows media photo"));
@@ -1334,20 +1678,59 @@ gxps_images_get_image (GXPSArchive *zip,
 
 		mime_type = gxps_images_guess_content_type (zip, image_uri);
 		if (g_strcmp0 (mime_type, "image/png") == 0) {
-			image = gxps_images_create_from_png (zip, image_uri, error);
+			if (keep_png && !bytes)
+				bytes = gxps_images_read_encoded_data (zip, image_uri);
+			image = gxps_images_create_from_png (zip, image_uri, target_res, bytes, header_only, error);
 		} else if (g_strcmp0 (mime_type, "image/jpeg") == 0) {
-			image = gxps_images_create_from_jpeg (zip, image_uri, error);
+			if (keep_jpeg && !bytes)
+				bytes = gxps_images_read_encoded_data (zip, image_uri);
+			image = gxps_images_create_from_jpeg (zip, image_uri, target_res, bytes, header_only, error);
 		} else if (g_strcmp0 (mime_type, "image/tiff") == 0) {
-			image = gxps_images_create_from_tiff (zip, image_uri, error);
+			image = gxps_images_create_from_tiff (zip, image_uri, target_res, header_only, error);
 		} else {
 			GXPS_DEBUG (g_message ("Unsupported image format: %s", mime_type));
 		}
 		g_free (mime_type);
 	}
 
+	if (bytes)
+		g_bytes_unref (bytes);
+
 	return image;
 }
 
+/* The encoded data of the image is kept in the surface when
+ * @target_type can embed it.
+ */
+GXPSImage *
+gxps_images_get_image (GXPSArchive          *zip,
+		       const gchar          *image_uri,
+		       gdouble               target_res,
+		       cairo_surface_type_t  target_type,
+		       GError              **error)
+{
+	GXPSImage *image;
+
+	GXPS_TRACE_BEGIN ("image_decode", image_uri);
+	image = gxps_images_load (zip, image_uri, target_res, target_type, FALSE, error);
+	GXPS_TRACE_END ("image_decode");
+
+	return image;
+}
+
+/* Returns the size and resolution the image would have if it were
+ * decoded for @target_res, reading only its header. The returned
+ * image has no surface.
+ */
+GXPSImage *
+gxps_images_get_image_info (GXPSArchive *zip,
+			    const gchar *image_uri,
+			    gdouble      target_res,
+			    GError     **error)
+{
+	return gxps_images_load (zip, image_uri, target_res, CAIRO_SURFACE_TYPE_IMAGE, TRUE, error);
+}
+
 void
 gxps_image_free (GXPSImage *image)
 {
@@ -31,12 +31,21 @@ struct _GXPSImage {
 	cairo_surface_t *surface;
 	double           res_x;
 	double           res_y;
+	guint            subsample;
+	guint            width;
+	guint            height;
 };
 
-GXPSImage *gxps_images_get_image (GXPSArchive  *zip,
-                                  const gchar  *image_uri,
-                                  GError      **error);
-void       gxps_image_free       (GXPSImage    *image);
+GXPSImage *gxps_images_get_image      (GXPSArchive          *zip,
+                                       const gchar          *image_uri,
+                                       gdouble               target_res,
+                                       cairo_surface_type_t  target_type,
+                                       GError              **error);
+GXPSImage *gxps_images_get_image_info (GXPSArchive          *zip,
+                                       const gchar          *image_uri,
+                                       gdouble               target_res,
+                                       GError              **error);
+void       gxps_image_free            (GXPSImage            *image);
 
 G_END_DECLS
 
@@ -137,3 +137,67 @@ gxps_matrix_parser_push (GMarkupParseContext *context,
 }
 
 
+
+/* Matrix stack: the transformations of the elements being parsed when
+ * only the geometry is needed, instead of saving and restoring a cairo
+ * context. The current matrix is the last one.
+ */
+struct _GXPSMatrixStack {
+        GArray *matrices;
+};
+
+GXPSMatrixStack *
+gxps_matrix_stack_new (const cairo_matrix_t *matrix)
+{
+        GXPSMatrixStack *stack;
+
+        stack = g_slice_new (GXPSMatrixStack);
+        stack->matrices = g_array_sized_new (FALSE, FALSE, sizeof (cairo_matrix_t), 8);
+        g_array_append_val (stack->matrices, *matrix);
+
+        return stack;
+}
+
+void
+gxps_matrix_stack_free (GXPSMatrixStack *stack)
+{
+        if (G_UNLIKELY (!stack))
+                return;
+
+        g_array_free (stack->matrices, TRUE);
+        g_slice_free (GXPSMatrixStack, stack);
+}
+
+const cairo_matrix_t *
+gxps_matrix_stack_get_matrix (GXPSMatrixStack *stack)
+{
+        return &g_array_index (stack->matrices, cairo_matrix_t, stack->matrices->len - 1);
+}
+
+void
+gxps_matrix_stack_save (GXPSMatrixStack *stack)
+{
+        cairo_matrix_t matrix;
+
+        matrix = *gxps_matrix_stack_get_matrix (stack);
+        g_array_append_val (stack->matrices, matrix);
+}
+
+void
+gxps_matrix_stack_restore (GXPSMatrixStack *stack)
+{
+        g_return_if_fail (stack->matrices->len > 1);
+
+        g_array_set_size (stack->matrices, stack->matrices->len - 1);
+}
+
+/* Same as cairo_transform() */
+void
+gxps_matrix_stack_transform (GXPSMatrixStack      *stack,
+                             const cairo_matrix_t *matrix)
+{
+        cairo_matrix_t *current;
+
+        current = &g_array_index (stack->matrices, cairo_matrix_t, stack->matrices->len - 1);
+        cairo_matrix_multiply (current, matrix, current);
+}
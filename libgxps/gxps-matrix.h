@@ -39,6 +39,16 @@ gboolean    gxps_matrix_parse       (const gchar         *data,
 void        gxps_matrix_parser_push (GMarkupParseContext *context,
                                      GXPSMatrix          *matrix);
 
+typedef struct _GXPSMatrixStack GXPSMatrixStack;
+
+GXPSMatrixStack      *gxps_matrix_stack_new        (const cairo_matrix_t *matrix);
+void                  gxps_matrix_stack_free       (GXPSMatrixStack      *stack);
+const cairo_matrix_t *gxps_matrix_stack_get_matrix (GXPSMatrixStack      *stack);
+void                  gxps_matrix_stack_save       (GXPSMatrixStack      *stack);
+void                  gxps_matrix_stack_restore    (GXPSMatrixStack      *stack);
+void                  gxps_matrix_stack_transform  (GXPSMatrixStack      *stack,
+                                                    const cairo_matrix_t *matrix);
+
 G_END_DECLS
 
 #endif /* __GXPS_MATRIX_H__ */
@@ -30,8 +30,9 @@
 
 G_BEGIN_DECLS
 
-typedef struct _GXPSRenderContext GXPSRenderContext;
-typedef struct _GXPSBrushVisual   GXPSBrushVisual;
+typedef struct _GXPSRenderContext   GXPSRenderContext;
+typedef struct _GXPSBrushVisual     GXPSBrushVisual;
+typedef struct _GXPSLinksCollector  GXPSLinksCollector;
 
 struct _GXPSPagePrivate {
         GXPSArchive *zip;
@@ -48,22 +49,62 @@ struct _GXPSPagePrivate {
         /* Images */
         GHashTable  *image_cache;
 
+        /* Links */
+        gboolean     collect_links;
+        gboolean     has_links;
+        GList       *links;
+
         /* Anchors */
         gboolean     has_anchors;
         GHashTable  *anchors;
+
+        /* Stats */
+        GXPSStats   *stats;
+
+        /* Complexity */
+        GXPSPageComplexity *complexity;
+
+        /* Text */
+        GArray      *text_runs;
 };
 
+/* Text of a Glyphs element, with the area in page coordinates of
+ * every character of text
+ */
+typedef struct {
+        gchar             *text;
+        cairo_rectangle_t  extents;
+        cairo_rectangle_t *areas;
+        guint              n_areas;
+} GXPSTextRun;
+
 struct _GXPSRenderContext {
-        GXPSPage        *page;
-        cairo_t         *cr;
-        GXPSBrushVisual *visual;
+        GXPSPage           *page;
+        cairo_t            *cr;
+        GXPSBrushVisual    *visual;
+        /* Trade quality for speed, used for thumbnails */
+        gboolean            draft;
+        /* Links and anchors found while rendering, or NULL */
+        GXPSLinksCollector *links;
+        /* Top level element being traced, or NULL */
+        const gchar        *trace_span;
 };
 
 GXPSImage *gxps_page_get_image          (GXPSPage            *page,
                                          const gchar         *image_uri,
+                                         gdouble              target_res,
+                                         cairo_surface_type_t target_type,
                                          GError             **error);
+GXPSImage *gxps_page_lookup_image       (GXPSPage            *page,
+                                         const gchar         *image_uri,
+                                         gdouble              target_res);
 void       gxps_page_render_parser_push (GMarkupParseContext *context,
                                          GXPSRenderContext   *ctx);
+gboolean   gxps_page_render_draft       (GXPSPage            *page,
+                                         cairo_t             *cr,
+                                         GError             **error);
+GArray    *gxps_page_get_text_runs      (GXPSPage            *page,
+                                         GError             **error);
 
 G_END_DECLS
 
@@ -21,6 +21,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 
 #include "gxps-page-private.h"
 #include "gxps-matrix.h"
@@ -34,6 +35,7 @@
 #include "gxps-private.h"
 #include "gxps-error.h"
 #include "gxps-debug.h"
+#include "gxps-trace.h"
 
 /**
  * SECTION:gxps-page
@@ -53,6 +55,9 @@ enum {
 	PROP_SOURCE
 };
 
+/* Em size in device pixels below which draft rendering skips glyphs */
+#define DRAFT_MIN_GLYPH_SIZE 2.0
+
 static void render_start_element (GMarkupParseContext  *context,
 				  const gchar          *element_name,
 				  const gchar         **names,
@@ -63,12 +68,24 @@ static void render_end_element   (GMarkupParseContext  *context,
 				  const gchar          *element_name,
 				  gpointer              user_data,
 				  GError              **error);
+static void render_traced_start_element (GMarkupParseContext  *context,
+					 const gchar          *element_name,
+					 const gchar         **names,
+					 const gchar         **values,
+					 gpointer              user_data,
+					 GError              **error);
+static void render_traced_end_element   (GMarkupParseContext  *context,
+					 const gchar          *element_name,
+					 gpointer              user_data,
+					 GError              **error);
 static void initable_iface_init  (GInitableIface       *initable_iface);
 
 G_DEFINE_TYPE_WITH_CODE (GXPSPage, gxps_page, G_TYPE_OBJECT,
 		         G_ADD_PRIVATE (GXPSPage)
 			 G_IMPLEMENT_INTERFACE (G_TYPE_INITABLE, initable_iface_init))
 
+G_DEFINE_BOXED_TYPE (GXPSImageMapping, gxps_image_mapping, gxps_image_mapping_copy, gxps_image_mapping_free)
+
 GQuark
 gxps_page_error_quark (void)
 {
@@ -76,21 +93,49 @@ gxps_page_error_quark (void)
 }
 
 /* Images */
+
+/* Images are cached together with the resolution they were decoded at.
+ * A cached image is reused when it was decoded at least at @target_res,
+ * otherwise it's decoded again at the new resolution and replaced.
+ */
+GXPSImage *
+gxps_page_lookup_image (GXPSPage    *page,
+			const gchar *image_uri,
+			gdouble      target_res)
+{
+	GXPSImage *image;
+
+	if (!page->priv->image_cache)
+		return NULL;
+
+	image = g_hash_table_lookup (page->priv->image_cache, image_uri);
+	if (image && (image->subsample <= 1 || target_res <= 0 ||
+		      MIN (image->res_x, image->res_y) >= target_res))
+		return image;
+
+	return NULL;
+}
+
 GXPSImage *
-gxps_page_get_image (GXPSPage    *page,
-		     const gchar *image_uri,
-		     GError     **error)
+gxps_page_get_image (GXPSPage             *page,
+		     const gchar          *image_uri,
+		     gdouble               target_res,
+		     cairo_surface_type_t  target_type,
+		     GError              **error)
 {
 	GXPSImage *image;
+	gint64     start;
 
-	if (page->priv->image_cache) {
-		image = g_hash_table_lookup (page->priv->image_cache,
-					     image_uri);
-		if (image)
-			return image;
+	image = gxps_page_lookup_image (page, image_uri, target_res);
+	if (image) {
+		GXPS_STATS_ADD (page->priv->zip, IMAGE_CACHE_HITS, 1);
+		return image;
 	}
 
-	image = gxps_images_get_image (page->priv->zip, image_uri, error);
+	GXPS_STATS_ADD (page->priv->zip, IMAGE_CACHE_MISSES, 1);
+	start = gxps_archive_stats_begin (page->priv->zip);
+	image = gxps_images_get_image (page->priv->zip, image_uri, target_res, target_type, error);
+	gxps_archive_stats_end (page->priv->zip, GXPS_STATS_PHASE_IMAGE_DECODE, start);
 	if (!image)
 		return NULL;
 
@@ -101,13 +146,188 @@ gxps_page_get_image (GXPSPage    *page,
 								 (GDestroyNotify)gxps_image_free);
 	}
 
-	g_hash_table_insert (page->priv->image_cache,
-			     g_strdup (image_uri),
-			     image);
+	g_hash_table_replace (page->priv->image_cache,
+			      g_strdup (image_uri),
+			      image);
 	return image;
 }
 
+/* Stats */
+
+/* Makes the page stats the current ones, so that the work done in this
+ * thread is also accounted to the page. Returns the previous stats to be
+ * restored with gxps_archive_stats_pop_page().
+ */
+static GXPSStats *
+gxps_page_push_stats (GXPSPage *page)
+{
+	if (gxps_archive_get_stats_enabled (page->priv->zip) && !page->priv->stats)
+		page->priv->stats = g_slice_new0 (GXPSStats);
+
+	return gxps_archive_stats_push_page (page->priv->stats);
+}
+
+static void
+anchor_area_free (cairo_rectangle_t *area)
+{
+	g_slice_free (cairo_rectangle_t, area);
+}
+
+/* Area in page space of the path @data transformed by @matrix.
+ *
+ * When @cr is not %NULL the path is built on it and measured with
+ * cairo_path_extents() instead, the way links were computed before
+ * gxps_path_get_bounds() existed. That's only done for gxps-bench,
+ * see _gxps_page_get_links_with_cairo().
+ */
+static void
+gxps_page_get_path_area (cairo_t              *cr,
+			 const gchar          *data,
+			 const cairo_matrix_t *matrix,
+			 cairo_rectangle_t    *area,
+			 GError              **error)
+{
+	GXPSPathBounds bounds;
+
+	gxps_path_bounds_init (&bounds);
+
+	if (cr) {
+		gdouble x1, y1, x2, y2;
+
+		cairo_save (cr);
+		cairo_set_matrix (cr, matrix);
+		if (gxps_path_parse (data, cr, error)) {
+			/* In device space, so that every point is transformed */
+			cairo_identity_matrix (cr);
+			cairo_path_extents (cr, &x1, &y1, &x2, &y2);
+			bounds.x1 = x1;
+			bounds.y1 = y1;
+			bounds.x2 = x2;
+			bounds.y2 = y2;
+		}
+		cairo_new_path (cr);
+		cairo_restore (cr);
+	} else {
+		gxps_path_get_bounds (data, matrix, &bounds, error);
+	}
+
+	gxps_path_bounds_get_rectangle (&bounds, area);
+}
+
+/* Links and anchors collected while rendering */
+struct _GXPSLinksCollector {
+	/* From the user space of the target to the page space */
+	cairo_matrix_t matrix;
+	GList         *links;
+	GHashTable    *anchors;
+	/* Whether all the links and anchors of the page were found */
+	gboolean       complete;
+};
+
+static GXPSLinksCollector *
+gxps_links_collector_new (cairo_t *cr)
+{
+	GXPSLinksCollector *collector;
+
+	collector = g_slice_new (GXPSLinksCollector);
+	cairo_get_matrix (cr, &collector->matrix);
+	if (cairo_matrix_invert (&collector->matrix) != CAIRO_STATUS_SUCCESS)
+		cairo_matrix_init_identity (&collector->matrix);
+	collector->links = NULL;
+	collector->complete = TRUE;
+	collector->anchors = g_hash_table_new_full (g_str_hash,
+						    g_str_equal,
+						    (GDestroyNotify)g_free,
+						    (GDestroyNotify)anchor_area_free);
+
+	return collector;
+}
+
+static void
+gxps_links_collector_free (GXPSLinksCollector *collector)
+{
+	if (G_UNLIKELY (!collector))
+		return;
+
+	g_list_free_full (collector->links, (GDestroyNotify)gxps_link_free);
+	g_clear_pointer (&collector->anchors, g_hash_table_destroy);
+
+	g_slice_free (GXPSLinksCollector, collector);
+}
+
+/* Adds the link and anchor of @path. The area is computed from its data
+ * with the transformation from its user space to the page space, exactly
+ * like gxps_page_get_links() and gxps_page_get_anchor_destination() do,
+ * so the cached areas don't depend on which one filled the cache. Like
+ * there, paths without a Data attribute get an empty area.
+ */
+static void
+gxps_links_collector_add_path (GXPSRenderContext *ctx,
+			       GXPSPath          *path)
+{
+	GXPSLinksCollector *collector = ctx->links;
+	cairo_matrix_t      matrix;
+	cairo_rectangle_t   area = { 0, 0, 0, 0 };
+
+	/* Inside a visual brush the user space is the one of the brush
+	 * group, so the area can't be the one the parsers compute. The
+	 * page is parsed for its links and anchors when they're needed.
+	 */
+	if (ctx->visual) {
+		collector->complete = FALSE;
+		return;
+	}
+
+	if (path->data) {
+		cairo_get_matrix (ctx->cr, &matrix);
+		cairo_matrix_multiply (&matrix, &matrix, &collector->matrix);
+		gxps_page_get_path_area (NULL, path->data, &matrix, &area, NULL);
+	}
+
+	if (path->link_uri) {
+		GXPSLink *link;
+
+		link = _gxps_link_new (ctx->page->priv->zip, &area, path->link_uri);
+		collector->links = g_list_prepend (collector->links, link);
+	}
+
+	if (path->name) {
+		g_hash_table_insert (collector->anchors, path->name,
+				     g_slice_dup (cairo_rectangle_t, &area));
+		path->name = NULL;
+	}
+}
+
+/* Caches the links and anchors of the page that were not known yet */
+static void
+gxps_page_set_collected_links (GXPSPage           *page,
+			       GXPSLinksCollector *collector)
+{
+	if (!collector->complete)
+		return;
+
+	if (!page->priv->has_links) {
+		page->priv->links = collector->links;
+		page->priv->has_links = TRUE;
+		collector->links = NULL;
+	}
+
+	if (page->priv->has_anchors && !page->priv->anchors) {
+		if (g_hash_table_size (collector->anchors) > 0) {
+			page->priv->anchors = collector->anchors;
+			collector->anchors = NULL;
+		} else {
+			page->priv->has_anchors = FALSE;
+		}
+	}
+}
+
 /* FixedPage parser */
+typedef struct {
+	GXPSPage *page;
+	gboolean  root_parsed;
+} GXPSFixedPageContext;
+
 static void
 fixed_page_start_element (GMarkupParseContext  *context,
 			  const gchar          *element_name,
@@ -116,8 +336,9 @@ fixed_page_start_element (GMarkupParseContext  *context,
 			  gpointer              user_data,
 			  GError              **error)
 {
-	GXPSPage *page = GXPS_PAGE (user_data);
-	gint      i;
+	GXPSFixedPageContext *ctx = (GXPSFixedPageContext *)user_data;
+	GXPSPage             *page = ctx->page;
+	gint                  i;
 
 	if (strcmp (element_name, "FixedPage") == 0) {
 		for (i = 0; names[i] != NULL; i++) {
@@ -150,6 +371,13 @@ fixed_page_start_element (GMarkupParseContext  *context,
 			}
 		}
 	}
+
+	/* Stop parsing, only the root element is needed */
+	ctx->root_parsed = TRUE;
+	g_set_error_literal (error,
+			     G_MARKUP_ERROR,
+			     G_MARKUP_ERROR_INVALID_CONTENT,
+			     "FixedPage parsed");
 }
 
 static const GMarkupParser fixed_page_parser = {
@@ -163,8 +391,10 @@ static gboolean
 gxps_page_parse_fixed_page (GXPSPage *page,
 			    GError  **error)
 {
-	GInputStream        *stream;
-	GMarkupParseContext *ctx;
+	GInputStream         *stream;
+	GMarkupParseContext  *context;
+	GXPSFixedPageContext  ctx;
+	GError               *err = NULL;
 
 	stream = gxps_archive_open (page->priv->zip,
 				    page->priv->source);
@@ -178,18 +408,29 @@ gxps_page_parse_fixed_page (GXPSPage *page,
 		return FALSE;
 	}
 
-	ctx = g_markup_parse_context_new (&fixed_page_parser, 0, page, NULL);
-	gxps_parse_stream (ctx, stream, error);
+	ctx.page = page;
+	ctx.root_parsed = FALSE;
+
+	context = g_markup_parse_context_new (&fixed_page_parser, 0, &ctx, NULL);
+	gxps_parse_stream (context, stream, &err);
 	g_object_unref (stream);
-	g_markup_parse_context_free (ctx);
+	g_markup_parse_context_free (context);
 
-	return (*error != NULL) ? FALSE : TRUE;
+	if (ctx.root_parsed)
+		g_clear_error (&err);
+
+	if (err) {
+		g_propagate_error (error, err);
+		return FALSE;
+	}
+
+	return TRUE;
 }
 
 /* Page Render Parser */
 static GMarkupParser render_parser = {
-	render_start_element,
-	render_end_element,
+	render_traced_start_element,
+	render_traced_end_element,
 	NULL,
 	NULL
 };
@@ -276,6 +517,7 @@ typedef struct {
 	gdouble            opacity;
 	cairo_pattern_t   *opacity_mask;
 	gboolean           pop_resource_dict;
+	gboolean           has_group;
 } GXPSCanvas;
 
 static GXPSCanvas *
@@ -303,6 +545,38 @@ gxps_canvas_free (GXPSCanvas *canvas)
 	g_slice_free (GXPSCanvas, canvas);
 }
 
+/* Pops the group pushed for an opacity mask and masks it, folding
+ * @opacity into the mask instead of compositing the result through
+ * another group when the mask is a solid color or a gradient.
+ */
+static void
+gxps_page_paint_opacity_mask (GXPSRenderContext *ctx,
+			      cairo_pattern_t   *opacity_mask,
+			      gdouble            opacity)
+{
+	cairo_t         *cr = ctx->cr;
+	cairo_pattern_t *mask;
+
+	cairo_pop_group_to_source (cr);
+	if (opacity == 1.0) {
+		cairo_mask (cr, opacity_mask);
+		return;
+	}
+
+	mask = gxps_brush_pattern_fold_opacity (opacity_mask, opacity);
+	if (mask) {
+		cairo_mask (cr, mask);
+		cairo_pattern_destroy (mask);
+		return;
+	}
+
+	cairo_push_group (cr);
+	GXPS_STATS_ADD (ctx->page->priv->zip, PUSH_GROUPS, 1);
+	cairo_mask (cr, opacity_mask);
+	cairo_pop_group_to_source (cr);
+	cairo_paint_with_alpha (cr, opacity);
+}
+
 static void
 canvas_start_element (GMarkupParseContext  *context,
 		      const gchar          *element_name,
@@ -340,6 +614,19 @@ canvas_start_element (GMarkupParseContext  *context,
 		gxps_resources_parser_push (context, resources,
 		                            canvas->ctx->page->priv->source);
 	} else {
+		/* Only allocate the opacity group once the canvas turns out
+		 * to have content. An opacity mask already renders the
+		 * content into a group, the opacity is folded into the mask.
+		 */
+		if (canvas->opacity != 1.0 && !canvas->has_group && !canvas->opacity_mask &&
+		    (strcmp (element_name, "Path") == 0 ||
+		     strcmp (element_name, "Glyphs") == 0 ||
+		     strcmp (element_name, "Canvas") == 0)) {
+			cairo_push_group (canvas->ctx->cr);
+			GXPS_STATS_ADD (canvas->ctx->page->priv->zip, PUSH_GROUPS, 1);
+			canvas->has_group = TRUE;
+		}
+
 		render_start_element (context,
 				      element_name,
 				      names,
@@ -372,8 +659,9 @@ canvas_end_element (GMarkupParseContext  *context,
 
 		brush = g_markup_parse_context_pop (context);
 		if (!canvas->opacity_mask) {
-			canvas->opacity_mask = cairo_pattern_reference (brush->pattern);
+			canvas->opacity_mask = gxps_brush_pattern_realize (brush->pattern, canvas->ctx);
 			cairo_push_group (canvas->ctx->cr);
+			GXPS_STATS_ADD (canvas->ctx->page->priv->zip, PUSH_GROUPS, 1);
 		}
 		gxps_brush_free (brush);
 	} else if (strcmp (element_name, "Canvas.Resources") == 0) {
@@ -506,6 +794,8 @@ render_start_element (GMarkupParseContext  *context,
 		GXPSPath *path;
 		gint      i;
 
+		gxps_archive_stats_add_element (ctx->page->priv->zip, GXPS_STATS_ELEMENT_PATH);
+
 		GXPS_DEBUG (g_message ("save"));
 		cairo_save (ctx->cr);
 
@@ -616,11 +906,15 @@ render_start_element (GMarkupParseContext  *context,
                                         return;
                                 }
 				GXPS_DEBUG (g_message ("set_opacity (%f)", path->opacity));
+			} else if (strcmp (names[i], "FixedPage.NavigateUri") == 0) {
+				if (ctx->links)
+					path->link_uri = gxps_resolve_relative_path (ctx->page->priv->source, values[i]);
+			} else if (strcmp (names[i], "Name") == 0) {
+				if (ctx->links)
+					path->name = g_strdup (values[i]);
 			}
 		}
 
-		if (path->opacity != 1.0)
-			cairo_push_group (ctx->cr);
 		gxps_path_parser_push (context, path);
 	} else if (strcmp (element_name, "Glyphs") == 0) {
 		GXPSGlyphs  *glyphs;
@@ -637,6 +931,8 @@ render_start_element (GMarkupParseContext  *context,
 		gdouble      opacity = 1.0;
 		gint         i;
 
+		gxps_archive_stats_add_element (ctx->page->priv->zip, GXPS_STATS_ELEMENT_GLYPHS);
+
 		GXPS_DEBUG (g_message ("save"));
 		cairo_save (ctx->cr);
 
@@ -774,13 +1070,13 @@ render_start_element (GMarkupParseContext  *context,
                         gxps_brush_solid_color_parse (fill_color, ctx->page->priv->zip, 1., &glyphs->fill_pattern);
 		}
 
-		if (glyphs->opacity != 1.0)
-			cairo_push_group (glyphs->ctx->cr);
 		gxps_glyphs_parser_push (context, glyphs);
 	} else if (strcmp (element_name, "Canvas") == 0) {
 		GXPSCanvas *canvas;
 		gint i;
 
+		gxps_archive_stats_add_element (ctx->page->priv->zip, GXPS_STATS_ELEMENT_CANVAS);
+
 		GXPS_DEBUG (g_message ("save"));
 		cairo_save (ctx->cr);
 
@@ -826,8 +1122,6 @@ render_start_element (GMarkupParseContext  *context,
 				cairo_clip (ctx->cr);
 			}
 		}
-		if (canvas->opacity != 1.0)
-			cairo_push_group (canvas->ctx->cr);
 		g_markup_parse_context_push (context, &canvas_parser, canvas);
 	} else if (strcmp (element_name, "FixedPage.Resources") == 0) {
 		GXPSResources *resources;
@@ -842,6 +1136,32 @@ render_start_element (GMarkupParseContext  *context,
 	}
 }
 
+/* Whether nothing of the path, whose bounds in user space are @bounds,
+ * would be drawn because it's completely outside of the clip.
+ */
+static gboolean
+gxps_page_path_is_clipped_out (cairo_t              *cr,
+			       GXPSPath             *path,
+			       const GXPSPathBounds *bounds)
+{
+	gdouble clip_x1, clip_y1, clip_x2, clip_y2;
+	gdouble pad = 0;
+
+	if (bounds->is_empty)
+		return FALSE;
+
+	/* Joins can't stick out further than the miter limit, and
+	 * square caps than the diagonal of half the line width.
+	 */
+	if (path->stroke_pattern)
+		pad = path->line_width / 2 * MAX (path->miter_limit, G_SQRT2);
+
+	cairo_clip_extents (cr, &clip_x1, &clip_y1, &clip_x2, &clip_y2);
+
+	return bounds->x2 + pad < clip_x1 || bounds->x1 - pad > clip_x2 ||
+		bounds->y2 + pad < clip_y1 || bounds->y1 - pad > clip_y2;
+}
+
 static void
 render_end_element (GMarkupParseContext  *context,
 		    const gchar          *element_name,
@@ -851,14 +1171,19 @@ render_end_element (GMarkupParseContext  *context,
 	GXPSRenderContext *ctx = (GXPSRenderContext *)user_data;
 
 	if (strcmp (element_name, "Path") == 0) {
-		GXPSPath *path;
+		GXPSPath      *path;
+		GXPSPathBounds bounds;
+		gdouble        fill_opacity = 1.0;
 
 		path = g_markup_parse_context_pop (context);
 
 		if (!path->data) {
+			if (path->link_uri || path->name)
+				gxps_links_collector_add_path (ctx, path);
+
 			GXPS_DEBUG (g_message ("restore"));
 			/* Something may have been drawn in a PathGeometry */
-			if (path->opacity != 1.0) {
+			if (path->has_group) {
 				cairo_pop_group_to_source (ctx->cr);
 				cairo_paint_with_alpha (ctx->cr, path->opacity);
 			}
@@ -871,8 +1196,6 @@ render_end_element (GMarkupParseContext  *context,
 
 		if (path->clip_data) {
 			if (!gxps_path_parse (path->clip_data, ctx->cr, error)) {
-				if (path->opacity != 1.0)
-					cairo_pattern_destroy (cairo_pop_group (ctx->cr));
 				gxps_path_free (path);
 				return;
 			}
@@ -880,10 +1203,53 @@ render_end_element (GMarkupParseContext  *context,
 			cairo_clip (ctx->cr);
 		}
 
-		if (!gxps_path_parse (path->data, ctx->cr, error)) {
-			if (path->opacity != 1.0)
+		/* A single fill or stroke can't overlap with itself, so the
+		 * opacity is applied to the source directly. Only a path that
+		 * is both filled and stroked needs an intermediate group.
+		 */
+		if (path->opacity != 1.0 && !path->opacity_mask) {
+			if (path->fill_pattern && path->stroke_pattern) {
+				path->has_group = TRUE;
+			} else if (path->fill_pattern) {
+				fill_opacity = path->opacity;
+			} else if (path->stroke_pattern) {
+				cairo_pattern_t *pattern;
+
+				pattern = gxps_brush_pattern_fold_opacity (path->stroke_pattern, path->opacity);
+				if (pattern) {
+					cairo_pattern_destroy (path->stroke_pattern);
+					path->stroke_pattern = pattern;
+				} else {
+					path->has_group = TRUE;
+				}
+			}
+
+			if (path->has_group) {
+				cairo_push_group (ctx->cr);
+				GXPS_STATS_ADD (ctx->page->priv->zip, PUSH_GROUPS, 1);
+			}
+		}
+
+		gxps_path_bounds_init (&bounds);
+		if (!gxps_path_parse_with_bounds (path->data, ctx->cr, &bounds, error)) {
+			if (path->has_group)
+				cairo_pattern_destroy (cairo_pop_group (ctx->cr));
+			gxps_path_free (path);
+			return;
+		}
+
+		if (path->link_uri || path->name)
+			gxps_links_collector_add_path (ctx, path);
+
+		if (gxps_page_path_is_clipped_out (ctx->cr, path, &bounds)) {
+			GXPS_DEBUG (g_message ("path is outside of the clip"));
+			cairo_new_path (ctx->cr);
+			if (path->has_group)
 				cairo_pattern_destroy (cairo_pop_group (ctx->cr));
 			gxps_path_free (path);
+
+			GXPS_DEBUG (g_message ("restore"));
+			cairo_restore (ctx->cr);
 			return;
 		}
 
@@ -911,6 +1277,7 @@ render_end_element (GMarkupParseContext  *context,
 			cairo_rectangle (ctx->cr, x1, y1, x2 - x1, y2 - y1);
 			cairo_clip (ctx->cr);
 			cairo_push_group (ctx->cr);
+			GXPS_STATS_ADD (ctx->page->priv->zip, PUSH_GROUPS, 1);
 			cairo_append_path (ctx->cr, cairo_path);
 			cairo_path_destroy (cairo_path);
 		}
@@ -918,11 +1285,8 @@ render_end_element (GMarkupParseContext  *context,
 		if (path->fill_pattern) {
 			GXPS_DEBUG (g_message ("fill"));
 
-			cairo_set_source (ctx->cr, path->fill_pattern);
-			if (path->stroke_pattern)
-				cairo_fill_preserve (ctx->cr);
-			else
-				cairo_fill (ctx->cr);
+			gxps_path_fill (ctx->cr, path->fill_pattern, fill_opacity,
+					path->stroke_pattern != NULL);
 		}
 
 		if (path->stroke_pattern) {
@@ -931,12 +1295,10 @@ render_end_element (GMarkupParseContext  *context,
 			cairo_stroke (ctx->cr);
 		}
 
-		if (path->opacity_mask) {
-			cairo_pop_group_to_source (ctx->cr);
-			cairo_mask (ctx->cr, path->opacity_mask);
-		}
+		if (path->opacity_mask)
+			gxps_page_paint_opacity_mask (ctx, path->opacity_mask, path->opacity);
 
-		if (path->opacity != 1.0) {
+		if (path->has_group) {
 			cairo_pop_group_to_source (ctx->cr);
 			cairo_paint_with_alpha (ctx->cr, path->opacity);
 		}
@@ -957,15 +1319,33 @@ render_end_element (GMarkupParseContext  *context,
 		cairo_scaled_font_t  *scaled_font;
                 gboolean              use_show_text_glyphs;
                 gboolean              success;
+		gdouble               opacity;
+		gboolean              has_group = FALSE;
 
 		glyphs = g_markup_parse_context_pop (context);
 
+		if (ctx->draft) {
+			gdouble dx = glyphs->em_size, dy = 0;
+			gdouble ex = 0, ey = glyphs->em_size;
+
+			cairo_user_to_device_distance (ctx->cr, &dx, &dy);
+			cairo_user_to_device_distance (ctx->cr, &ex, &ey);
+			if (MAX (hypot (dx, dy), hypot (ex, ey)) < DRAFT_MIN_GLYPH_SIZE) {
+				GXPS_DEBUG (g_message ("skip tiny glyphs (%s)", glyphs->text));
+				if (glyphs->opacity_mask)
+					cairo_pattern_destroy (cairo_pop_group (ctx->cr));
+				gxps_glyphs_free (glyphs);
+
+				GXPS_DEBUG (g_message ("restore"));
+				cairo_restore (ctx->cr);
+				return;
+			}
+		}
+
 		font_face = gxps_fonts_get_font (ctx->page->priv->zip, glyphs->font_uri, error);
 		if (!font_face) {
 			if (glyphs->opacity_mask)
 				cairo_pattern_destroy (cairo_pop_group (ctx->cr));
-			if (glyphs->opacity != 1.0)
-				cairo_pattern_destroy (cairo_pop_group (ctx->cr));
 			gxps_glyphs_free (glyphs);
 
 			GXPS_DEBUG (g_message ("restore"));
@@ -977,8 +1357,6 @@ render_end_element (GMarkupParseContext  *context,
 			if (!gxps_path_parse (glyphs->clip_data, ctx->cr, error)) {
 				if (glyphs->opacity_mask)
 					cairo_pattern_destroy (cairo_pop_group (ctx->cr));
-				if (glyphs->opacity != 1.0)
-					cairo_pattern_destroy (cairo_pop_group (ctx->cr));
 				gxps_glyphs_free (glyphs);
 				GXPS_DEBUG (g_message ("restore"));
 				cairo_restore (ctx->cr);
@@ -1025,8 +1403,6 @@ render_end_element (GMarkupParseContext  *context,
 		if (!success) {
 			if (glyphs->opacity_mask)
 				cairo_pattern_destroy (cairo_pop_group (ctx->cr));
-			if (glyphs->opacity != 1.0)
-				cairo_pattern_destroy (cairo_pop_group (ctx->cr));
 			gxps_glyphs_free (glyphs);
 			cairo_scaled_font_destroy (scaled_font);
 			GXPS_DEBUG (g_message ("restore"));
@@ -1037,6 +1413,24 @@ render_end_element (GMarkupParseContext  *context,
 		if (glyphs->fill_pattern)
 			cairo_set_source (ctx->cr, glyphs->fill_pattern);
 
+		/* Showing the glyphs is a single paint operation, so fold the
+		 * opacity into the source unless it's a surface pattern.
+		 */
+		opacity = glyphs->opacity * gxps_brush_pattern_get_opacity (glyphs->fill_pattern);
+		if (opacity != 1.0 && !glyphs->opacity_mask) {
+			cairo_pattern_t *pattern;
+
+			pattern = gxps_brush_pattern_fold_opacity (cairo_get_source (ctx->cr), opacity);
+			if (pattern) {
+				cairo_set_source (ctx->cr, pattern);
+				cairo_pattern_destroy (pattern);
+			} else {
+				cairo_push_group (ctx->cr);
+				GXPS_STATS_ADD (ctx->page->priv->zip, PUSH_GROUPS, 1);
+				has_group = TRUE;
+			}
+		}
+
 		GXPS_DEBUG (g_message ("show_text (%s)", glyphs->text));
 
 		cairo_set_scaled_font (ctx->cr, scaled_font);
@@ -1050,13 +1444,11 @@ render_end_element (GMarkupParseContext  *context,
                         cairo_show_glyphs (ctx->cr, glyph_list, num_glyphs);
                 }
 
-		if (glyphs->opacity_mask) {
-			cairo_pop_group_to_source (ctx->cr);
-			cairo_mask (ctx->cr, glyphs->opacity_mask);
-		}
-		if (glyphs->opacity != 1.0) {
+		if (glyphs->opacity_mask)
+			gxps_page_paint_opacity_mask (ctx, glyphs->opacity_mask, opacity);
+		if (has_group) {
 			cairo_pop_group_to_source (ctx->cr);
-			cairo_paint_with_alpha (ctx->cr, glyphs->opacity);
+			cairo_paint_with_alpha (ctx->cr, opacity);
 		}
 		g_free (glyph_list);
 		gxps_glyphs_free (glyphs);
@@ -1070,10 +1462,10 @@ render_end_element (GMarkupParseContext  *context,
 		canvas = g_markup_parse_context_pop (context);
 
 		if (canvas->opacity_mask) {
-			cairo_pop_group_to_source (ctx->cr);
-			cairo_mask (ctx->cr, canvas->opacity_mask);
+			gxps_page_paint_opacity_mask (ctx, canvas->opacity_mask,
+						      canvas->has_group ? 1.0 : canvas->opacity);
 		}
-		if (canvas->opacity != 1.0) {
+		if (canvas->has_group) {
 			cairo_pop_group_to_source (ctx->cr);
 			cairo_paint_with_alpha (ctx->cr, canvas->opacity);
 		}
@@ -1095,16 +1487,93 @@ render_end_element (GMarkupParseContext  *context,
 	}
 }
 
+/* Returns the name of the span for the top level elements of the page,
+ * or %NULL if the element is not traced.
+ */
+static const gchar *
+render_get_trace_name (GMarkupParseContext *context,
+		       const gchar         *element_name)
+{
+	const gchar *name;
+
+	if (G_LIKELY (!gxps_trace_enabled ()))
+		return NULL;
+
+	if (strcmp (element_name, "Canvas") == 0)
+		name = "Canvas";
+	else if (strcmp (element_name, "Path") == 0)
+		name = "Path";
+	else if (strcmp (element_name, "Glyphs") == 0)
+		name = "Glyphs";
+	else
+		return NULL;
+
+	/* The element and the FixedPage */
+	if (g_slist_length ((GSList *)g_markup_parse_context_get_element_stack (context)) != 2)
+		return NULL;
+
+	return name;
+}
+
+static void
+render_traced_start_element (GMarkupParseContext  *context,
+			     const gchar          *element_name,
+			     const gchar         **names,
+			     const gchar         **values,
+			     gpointer              user_data,
+			     GError              **error)
+{
+	GXPSRenderContext *ctx = (GXPSRenderContext *)user_data;
+	const gchar       *trace_name;
+
+	trace_name = render_get_trace_name (context, element_name);
+	if (trace_name) {
+		gxps_trace_begin (trace_name, ctx->page->priv->source);
+		ctx->trace_span = trace_name;
+	}
+
+	render_start_element (context, element_name, names, values, user_data, error);
+
+	/* The end of an element that failed to start is never parsed */
+	if (trace_name && *error) {
+		gxps_trace_end (trace_name);
+		ctx->trace_span = NULL;
+	}
+}
+
+static void
+render_traced_end_element (GMarkupParseContext  *context,
+			   const gchar          *element_name,
+			   gpointer              user_data,
+			   GError              **error)
+{
+	GXPSRenderContext *ctx = (GXPSRenderContext *)user_data;
+	const gchar       *trace_name;
+
+	trace_name = render_get_trace_name (context, element_name);
+	render_end_element (context, element_name, user_data, error);
+	if (trace_name) {
+		gxps_trace_end (trace_name);
+		ctx->trace_span = NULL;
+	}
+}
+
 static gboolean
 gxps_page_parse_for_rendering (GXPSPage *page,
 			       cairo_t  *cr,
+			       gboolean  draft,
 			       GError  **error)
 {
 	GInputStream        *stream;
 	GMarkupParseContext *context;
 	GXPSRenderContext    ctx;
+	GXPSStats           *previous_stats;
+	gint64               start;
 	GError              *err = NULL;
 
+	previous_stats = gxps_page_push_stats (page);
+	start = gxps_archive_stats_begin (page->priv->zip);
+
 	stream = gxps_archive_open (page->priv->zip,
 				    page->priv->source);
 	if (!stream) {
@@ -1113,17 +1582,37 @@ gxps_page_parse_for_rendering (GXPSPage *page,
 			     GXPS_ERROR_SOURCE_NOT_FOUND,
 			     "Page source %s not found in archive",
 			     page->priv->source);
+		gxps_archive_stats_pop_page (previous_stats);
 		return FALSE;
 	}
 
 	ctx.page = page;
 	ctx.cr = cr;
+	ctx.visual = NULL;
+	ctx.draft = draft;
+	ctx.links = NULL;
+	ctx.trace_span = NULL;
+	if (page->priv->collect_links && !draft &&
+	    (!page->priv->has_links || (page->priv->has_anchors && !page->priv->anchors)))
+		ctx.links = gxps_links_collector_new (cr);
 
 	context = g_markup_parse_context_new (&render_parser, 0, &ctx, NULL);
 	gxps_parse_stream (context, stream, &err);
 	g_object_unref (stream);
 	g_markup_parse_context_free (context);
 
+	/* An error inside a traced element stops parsing before its end */
+	if (ctx.trace_span)
+		gxps_trace_end (ctx.trace_span);
+
+	if (ctx.links) {
+		if (!err)
+			gxps_page_set_collected_links (page, ctx.links);
+		gxps_links_collector_free (ctx.links);
+	}
+
+	gxps_archive_stats_end (page->priv->zip, GXPS_STATS_PHASE_RENDER, start);
+	gxps_archive_stats_pop_page (previous_stats);
 
 	if (g_error_matches (err, GXPS_PAGE_ERROR, GXPS_PAGE_ERROR_RENDER)) {
 		g_propagate_error (error, err);
@@ -1141,12 +1630,13 @@ gxps_page_parse_for_rendering (GXPSPage *page,
 
 /* Links */
 typedef struct {
-	GXPSPage *page;
-	cairo_t  *cr;
+	GXPSPage        *page;
+	GXPSMatrixStack *matrices;
 
-	GList    *st;
-	GList    *links;
-	gboolean  do_transform;
+	GList           *st;
+	GList           *links;
+	gboolean         do_transform;
+	cairo_t         *cr;
 } GXPSLinksContext;
 
 typedef struct {
@@ -1168,7 +1658,7 @@ links_start_element (GMarkupParseContext  *context,
 		gint i;
 
 		GXPS_DEBUG (g_message ("save"));
-		cairo_save (ctx->cr);
+		gxps_matrix_stack_save (ctx->matrices);
 
 		for (i = 0; names[i] != NULL; i++) {
 			if (strcmp (names[i], "RenderTransform") == 0) {
@@ -1185,15 +1675,9 @@ links_start_element (GMarkupParseContext  *context,
 					      matrix.xx, matrix.yx,
 					      matrix.xy, matrix.yy,
 					      matrix.x0, matrix.y0));
-				cairo_transform (ctx->cr, &matrix);
+				gxps_matrix_stack_transform (ctx->matrices, &matrix);
 
 				return;
-			} else if (strcmp (names[i], "Clip") == 0) {
-				/* FIXME: do we really need clips? */
-				if (!gxps_path_parse (values[i], ctx->cr, error))
-					return;
-				GXPS_DEBUG (g_message ("clip"));
-				cairo_clip (ctx->cr);
 			}
 		}
 	} else if (strcmp (element_name, "Path") == 0) {
@@ -1203,7 +1687,7 @@ links_start_element (GMarkupParseContext  *context,
 		const gchar *link_uri = NULL;
 
 		GXPS_DEBUG (g_message ("save"));
-		cairo_save (ctx->cr);
+		gxps_matrix_stack_save (ctx->matrices);
 
 		for (i = 0; names[i] != NULL; i++) {
 			if (strcmp (names[i], "Data") == 0) {
@@ -1222,7 +1706,7 @@ links_start_element (GMarkupParseContext  *context,
 					      matrix.xx, matrix.yx,
 					      matrix.xy, matrix.yy,
 					      matrix.x0, matrix.y0));
-				cairo_transform (ctx->cr, &matrix);
+				gxps_matrix_stack_transform (ctx->matrices, &matrix);
 			} else if (strcmp (names[i], "FixedPage.NavigateUri") == 0) {
 				link_uri = values[i];
 			}
@@ -1239,7 +1723,7 @@ links_start_element (GMarkupParseContext  *context,
 		gint i;
 
 		GXPS_DEBUG (g_message ("save"));
-		cairo_save (ctx->cr);
+		gxps_matrix_stack_save (ctx->matrices);
 
 		for (i = 0; names[i] != NULL; i++) {
 			if (strcmp (names[i], "RenderTransform") == 0) {
@@ -1256,7 +1740,7 @@ links_start_element (GMarkupParseContext  *context,
 					      matrix.xx, matrix.yx,
 					      matrix.xy, matrix.yy,
 					      matrix.x0, matrix.y0));
-				cairo_transform (ctx->cr, &matrix);
+				gxps_matrix_stack_transform (ctx->matrices, &matrix);
 			} else if (strcmp (names[i], "FixedPage.NavigateUri") == 0) {
 				/* TODO */
 			}
@@ -1288,7 +1772,7 @@ links_start_element (GMarkupParseContext  *context,
 					      matrix.xx, matrix.yx,
 					      matrix.xy, matrix.yy,
 					      matrix.x0, matrix.y0));
-				cairo_transform (ctx->cr, &matrix);
+				gxps_matrix_stack_transform (ctx->matrices, &matrix);
 				return;
 			}
 		}
@@ -1305,7 +1789,7 @@ links_end_element (GMarkupParseContext  *context,
 
 	if (strcmp (element_name, "Canvas") == 0) {
 		GXPS_DEBUG (g_message ("restore"));
-		cairo_restore (ctx->cr);
+		gxps_matrix_stack_restore (ctx->matrices);
 	} else if (strcmp (element_name, "Path") == 0) {
 		GXPSPathLink *path_link;
 
@@ -1313,32 +1797,24 @@ links_end_element (GMarkupParseContext  *context,
 		ctx->st = g_list_delete_link (ctx->st, ctx->st);
 		if (path_link->uri) {
 			GXPSLink         *link;
-			gdouble           x1, y1, x2, y2;
-			cairo_rectangle_t area;
+			cairo_rectangle_t area = { 0, 0, 0, 0 };
 
 			if (path_link->data)
-				gxps_path_parse (path_link->data, ctx->cr, error);
-
-			cairo_path_extents (ctx->cr, &x1, &y1, &x2, &y2);
-			cairo_user_to_device (ctx->cr, &x1, &y1);
-			cairo_user_to_device (ctx->cr, &x2, &y2);
+				gxps_page_get_path_area (ctx->cr, path_link->data,
+							 gxps_matrix_stack_get_matrix (ctx->matrices),
+							 &area, error);
 
-			area.x = x1;
-			area.y = y1;
-			area.width = x2 - x1;
-			area.height = y2 - y1;
 			link = _gxps_link_new (ctx->page->priv->zip, &area, path_link->uri);
 			ctx->links = g_list_prepend (ctx->links, link);
 			g_free (path_link->uri);
 		}
 		g_free (path_link->data);
 		g_slice_free (GXPSPathLink, path_link);
-		cairo_new_path (ctx->cr);
 		GXPS_DEBUG (g_message ("restore"));
-		cairo_restore (ctx->cr);
+		gxps_matrix_stack_restore (ctx->matrices);
 	} else if (strcmp (element_name, "Glyphs") == 0) {
 		GXPS_DEBUG (g_message ("restore"));
-		cairo_restore (ctx->cr);
+		gxps_matrix_stack_restore (ctx->matrices);
 	} else if (strcmp (element_name, "Canvas.RenderTransform") == 0 ||
 		   strcmp (element_name, "Path.RenderTransform") == 0 ||
 		   strcmp (element_name, "Glyphs.RenderTransform") == 0 ) {
@@ -1354,6 +1830,7 @@ static const GMarkupParser links_parser = {
 	NULL
 };
 
+/* @cr is only given by _gxps_page_get_links_with_cairo() */
 static GList *
 gxps_page_parse_links (GXPSPage *page,
 		       cairo_t  *cr,
@@ -1362,6 +1839,7 @@ gxps_page_parse_links (GXPSPage *page,
 	GInputStream        *stream;
 	GXPSLinksContext     ctx;
 	GMarkupParseContext *context;
+	cairo_matrix_t       matrix;
 
 	stream = gxps_archive_open (page->priv->zip,
 				    page->priv->source);
@@ -1374,26 +1852,51 @@ gxps_page_parse_links (GXPSPage *page,
 		return FALSE;
 	}
 
-	ctx.cr = cr;
+	cairo_matrix_init_identity (&matrix);
+	ctx.matrices = gxps_matrix_stack_new (&matrix);
 	ctx.page = page;
 	ctx.st = NULL;
 	ctx.links = NULL;
+	ctx.cr = cr;
 
 	context = g_markup_parse_context_new (&links_parser, 0, &ctx, NULL);
 	gxps_parse_stream (context, stream, error);
 	g_object_unref (stream);
 	g_markup_parse_context_free (context);
+	gxps_matrix_stack_free (ctx.matrices);
 
 	return ctx.links;
 }
 
+/* The links of @page, with their areas computed by building every path
+ * on a recording surface. They're not cached. This is not exported, it's
+ * only used by gxps-bench to compare with gxps_page_get_links().
+ */
+GList *
+_gxps_page_get_links_with_cairo (GXPSPage *page,
+				 GError  **error)
+{
+	cairo_surface_t *surface;
+	cairo_t         *cr;
+	GList           *links;
+
+	surface = cairo_recording_surface_create (CAIRO_CONTENT_COLOR_ALPHA, NULL);
+	cr = cairo_create (surface);
+	cairo_surface_destroy (surface);
+
+	links = gxps_page_parse_links (page, cr, error);
+	cairo_destroy (cr);
+
+	return links;
+}
+
 typedef struct {
-	GXPSPage   *page;
-	cairo_t    *cr;
+	GXPSPage        *page;
+	GXPSMatrixStack *matrices;
 
-	GList      *st;
-	GHashTable *anchors;
-	gboolean    do_transform;
+	GList           *st;
+	GHashTable      *anchors;
+	gboolean         do_transform;
 } GXPSAnchorsContext;
 
 typedef struct {
@@ -1415,7 +1918,7 @@ anchors_start_element (GMarkupParseContext  *context,
 		gint i;
 
 		GXPS_DEBUG (g_message ("save"));
-		cairo_save (ctx->cr);
+		gxps_matrix_stack_save (ctx->matrices);
 
 		for (i = 0; names[i] != NULL; i++) {
 			if (strcmp (names[i], "RenderTransform") == 0) {
@@ -1432,7 +1935,7 @@ anchors_start_element (GMarkupParseContext  *context,
 					      matrix.xx, matrix.yx,
 					      matrix.xy, matrix.yy,
 					      matrix.x0, matrix.y0));
-				cairo_transform (ctx->cr, &matrix);
+				gxps_matrix_stack_transform (ctx->matrices, &matrix);
 
 				return;
 			}
@@ -1444,7 +1947,7 @@ anchors_start_element (GMarkupParseContext  *context,
 		const gchar *name = NULL;
 
 		GXPS_DEBUG (g_message ("save"));
-		cairo_save (ctx->cr);
+		gxps_matrix_stack_save (ctx->matrices);
 
 		for (i = 0; names[i] != NULL; i++) {
 			if (strcmp (names[i], "Data") == 0) {
@@ -1463,7 +1966,7 @@ anchors_start_element (GMarkupParseContext  *context,
 					      matrix.xx, matrix.yx,
 					      matrix.xy, matrix.yy,
 					      matrix.x0, matrix.y0));
-				cairo_transform (ctx->cr, &matrix);
+				gxps_matrix_stack_transform (ctx->matrices, &matrix);
 			} else if (strcmp (names[i], "Name") == 0) {
 				name = values[i];
 			}
@@ -1480,7 +1983,7 @@ anchors_start_element (GMarkupParseContext  *context,
 		gint i;
 
 		GXPS_DEBUG (g_message ("save"));
-		cairo_save (ctx->cr);
+		gxps_matrix_stack_save (ctx->matrices);
 
 		for (i = 0; names[i] != NULL; i++) {
 			if (strcmp (names[i], "RenderTransform") == 0) {
@@ -1497,7 +2000,7 @@ anchors_start_element (GMarkupParseContext  *context,
 					      matrix.xx, matrix.yx,
 					      matrix.xy, matrix.yy,
 					      matrix.x0, matrix.y0));
-				cairo_transform (ctx->cr, &matrix);
+				gxps_matrix_stack_transform (ctx->matrices, &matrix);
 			} else if (strcmp (names[i], "Name") == 0) {
 				/* TODO */
 			}
@@ -1529,7 +2032,7 @@ anchors_start_element (GMarkupParseContext  *context,
 					      matrix.xx, matrix.yx,
 					      matrix.xy, matrix.yy,
 					      matrix.x0, matrix.y0));
-				cairo_transform (ctx->cr, &matrix);
+				gxps_matrix_stack_transform (ctx->matrices, &matrix);
 				return;
 			}
 		}
@@ -1546,38 +2049,29 @@ anchors_end_element (GMarkupParseContext  *context,
 
 	if (strcmp (element_name, "Canvas") == 0) {
 		GXPS_DEBUG (g_message ("restore"));
-		cairo_restore (ctx->cr);
+		gxps_matrix_stack_restore (ctx->matrices);
 	} else if (strcmp (element_name, "Path") == 0) {
 		GXPSPathAnchor *path_anchor;
 
 		path_anchor = (GXPSPathAnchor *)ctx->st->data;
 		ctx->st = g_list_delete_link (ctx->st, ctx->st);
 		if (path_anchor->name) {
-			gdouble x1, y1, x2, y2;
 			cairo_rectangle_t *rect;
 
+			rect = g_slice_new0 (cairo_rectangle_t);
 			if (path_anchor->data)
-				gxps_path_parse (path_anchor->data, ctx->cr, error);
-
-			cairo_path_extents (ctx->cr, &x1, &y1, &x2, &y2);
-			cairo_user_to_device (ctx->cr, &x1, &y1);
-			cairo_user_to_device (ctx->cr, &x2, &y2);
-
-			rect = g_slice_new (cairo_rectangle_t);
-			rect->x = x1;
-			rect->y = y1;
-			rect->width = x2 - x1;
-			rect->height = y2 - y1;
+				gxps_page_get_path_area (NULL, path_anchor->data,
+							 gxps_matrix_stack_get_matrix (ctx->matrices),
+							 rect, error);
 			g_hash_table_insert (ctx->anchors, path_anchor->name, rect);
 		}
 		g_free (path_anchor->data);
 		g_slice_free (GXPSPathAnchor, path_anchor);
-		cairo_new_path (ctx->cr);
 		GXPS_DEBUG (g_message ("restore"));
-		cairo_restore (ctx->cr);
+		gxps_matrix_stack_restore (ctx->matrices);
 	} else if (strcmp (element_name, "Glyphs") == 0) {
 		GXPS_DEBUG (g_message ("restore"));
-		cairo_restore (ctx->cr);
+		gxps_matrix_stack_restore (ctx->matrices);
 	} else if (strcmp (element_name, "Canvas.RenderTransform") == 0 ||
 		   strcmp (element_name, "Path.RenderTransform") == 0 ||
 		   strcmp (element_name, "Glyphs.RenderTransform") == 0 ) {
@@ -1593,20 +2087,14 @@ static const GMarkupParser anchors_parser = {
 	NULL
 };
 
-static void
-anchor_area_free (cairo_rectangle_t *area)
-{
-	g_slice_free (cairo_rectangle_t, area);
-}
-
 static gboolean
 gxps_page_parse_anchors (GXPSPage *page,
-			 cairo_t  *cr,
 			 GError  **error)
 {
 	GInputStream        *stream;
 	GXPSAnchorsContext   ctx;
 	GMarkupParseContext *context;
+	cairo_matrix_t       matrix;
 
 	stream = gxps_archive_open (page->priv->zip,
 				    page->priv->source);
@@ -1619,7 +2107,8 @@ gxps_page_parse_anchors (GXPSPage *page,
 		return FALSE;
 	}
 
-	ctx.cr = cr;
+	cairo_matrix_init_identity (&matrix);
+	ctx.matrices = gxps_matrix_stack_new (&matrix);
 	ctx.page = page;
 	ctx.st = NULL;
 	ctx.anchors = g_hash_table_new_full (g_str_hash,
@@ -1631,6 +2120,7 @@ gxps_page_parse_anchors (GXPSPage *page,
 	gxps_parse_stream (context, stream, error);
 	g_object_unref (stream);
 	g_markup_parse_context_free (context);
+	gxps_matrix_stack_free (ctx.matrices);
 
 	if (g_hash_table_size (ctx.anchors) > 0) {
 		page->priv->has_anchors = TRUE;
@@ -1643,19 +2133,1003 @@ gxps_page_parse_anchors (GXPSPage *page,
 	return TRUE;
 }
 
+/* Complexity */
+typedef struct {
+	GXPSPage           *page;
+	GXPSPageComplexity *complexity;
+
+	/* Whether every Canvas, Path and Glyphs being parsed is a group */
+	GSList             *groups;
+	guint               group_depth;
+	GHashTable         *images;
+} GXPSComplexityContext;
+
 static void
-gxps_page_finalize (GObject *object)
+complexity_push_group (GXPSComplexityContext *ctx)
 {
-	GXPSPage *page = GXPS_PAGE (object);
+	ctx->group_depth++;
+	ctx->complexity->max_group_depth = MAX (ctx->complexity->max_group_depth,
+						ctx->group_depth);
+}
 
-	g_clear_object (&page->priv->zip);
-	g_clear_pointer (&page->priv->source, g_free);
+static void
+complexity_add_image (GXPSComplexityContext *ctx,
+		      const gchar           *image_source)
+{
+	GXPSImage *image;
+	gchar     *image_uri;
+
+	image_uri = gxps_resolve_relative_path (ctx->page->priv->source, image_source);
+	if (g_hash_table_contains (ctx->images, image_uri)) {
+		g_free (image_uri);
+		return;
+	}
+	g_hash_table_add (ctx->images, image_uri);
+	ctx->complexity->n_images++;
+
+	/* Only the image header is read */
+	image = gxps_images_get_image_info (ctx->page->priv->zip, image_uri, 0, NULL);
+	if (!image)
+		return;
+
+	ctx->complexity->image_pixels += (guint64)image->width * image->height;
+	gxps_image_free (image);
+}
+
+static guint
+complexity_count_glyphs (const gchar *unicode_string,
+			 const gchar *indices)
+{
+	guint n_chars = 0;
+	guint n_indices = 0;
+
+	if (unicode_string) {
+		/* {} escapes a string starting with { */
+		if (g_str_has_prefix (unicode_string, "{}"))
+			unicode_string += 2;
+		n_chars = g_utf8_strlen (unicode_string, -1);
+	}
+
+	if (indices && *indices) {
+		const gchar *p;
+
+		n_indices = 1;
+		for (p = indices; *p; p++) {
+			if (*p == ';')
+				n_indices++;
+		}
+	}
+
+	return MAX (n_chars, n_indices);
+}
+
+static void
+complexity_start_element (GMarkupParseContext  *context,
+			  const gchar          *element_name,
+			  const gchar         **names,
+			  const gchar         **values,
+			  gpointer              user_data,
+			  GError              **error)
+{
+	GXPSComplexityContext *ctx = (GXPSComplexityContext *)user_data;
+	GXPSPageComplexity    *complexity = ctx->complexity;
+	const gchar           *unicode_string = NULL;
+	const gchar           *indices = NULL;
+	gboolean               is_group = FALSE;
+	gint                   i;
+
+	complexity->n_elements++;
+
+	for (i = 0; names[i] != NULL; i++) {
+		if (strcmp (names[i], "Data") == 0 ||
+		    strcmp (names[i], "Clip") == 0 ||
+		    strcmp (names[i], "Figures") == 0 ||
+		    strcmp (names[i], "Points") == 0) {
+			/* Resource references are counted in the dictionary */
+			if (values[i][0] != '{')
+				complexity->path_data_bytes += strlen (values[i]);
+		} else if (strcmp (names[i], "Opacity") == 0) {
+			gdouble opacity;
+
+			if (gxps_value_get_double (values[i], &opacity) && opacity != 1.0)
+				is_group = TRUE;
+		} else if (strcmp (names[i], "OpacityMask") == 0) {
+			is_group = TRUE;
+		} else if (strcmp (names[i], "UnicodeString") == 0) {
+			unicode_string = values[i];
+		} else if (strcmp (names[i], "Indices") == 0) {
+			indices = values[i];
+		} else if (strcmp (names[i], "ImageSource") == 0) {
+			complexity_add_image (ctx, values[i]);
+		}
+	}
+
+	if (strcmp (element_name, "Canvas") == 0) {
+		complexity->n_canvases++;
+	} else if (strcmp (element_name, "Path") == 0) {
+		complexity->n_paths++;
+	} else if (strcmp (element_name, "Glyphs") == 0) {
+		complexity->n_glyph_runs++;
+		complexity->n_glyphs += complexity_count_glyphs (unicode_string, indices);
+	} else if (ctx->groups &&
+		   (strcmp (element_name, "Canvas.OpacityMask") == 0 ||
+		    strcmp (element_name, "Path.OpacityMask") == 0 ||
+		    strcmp (element_name, "Glyphs.OpacityMask") == 0)) {
+		if (!GPOINTER_TO_INT (ctx->groups->data)) {
+			ctx->groups->data = GINT_TO_POINTER (TRUE);
+			complexity_push_group (ctx);
+		}
+		return;
+	} else {
+		return;
+	}
+
+	ctx->groups = g_slist_prepend (ctx->groups, GINT_TO_POINTER (is_group));
+	if (is_group)
+		complexity_push_group (ctx);
+}
+
+static void
+complexity_end_element (GMarkupParseContext  *context,
+			const gchar          *element_name,
+			gpointer              user_data,
+			GError              **error)
+{
+	GXPSComplexityContext *ctx = (GXPSComplexityContext *)user_data;
+
+	if (strcmp (element_name, "Canvas") == 0 ||
+	    strcmp (element_name, "Path") == 0 ||
+	    strcmp (element_name, "Glyphs") == 0) {
+		if (GPOINTER_TO_INT (ctx->groups->data))
+			ctx->group_depth--;
+		ctx->groups = g_slist_delete_link (ctx->groups, ctx->groups);
+	}
+}
+
+static const GMarkupParser complexity_parser = {
+	complexity_start_element,
+	complexity_end_element,
+	NULL,
+	NULL,
+	NULL
+};
+
+static gboolean
+gxps_page_parse_complexity (GXPSPage           *page,
+			    GXPSPageComplexity *complexity,
+			    GError            **error)
+{
+	GInputStream          *stream;
+	GXPSComplexityContext  ctx;
+	GMarkupParseContext   *context;
+	GError                *err = NULL;
+
+	stream = gxps_archive_open (page->priv->zip,
+				    page->priv->source);
+	if (!stream) {
+		g_set_error (error,
+			     GXPS_ERROR,
+			     GXPS_ERROR_SOURCE_NOT_FOUND,
+			     "Page source %s not found in archive",
+			     page->priv->source);
+		return FALSE;
+	}
+
+	memset (complexity, 0, sizeof (GXPSPageComplexity));
+	ctx.page = page;
+	ctx.complexity = complexity;
+	ctx.groups = NULL;
+	ctx.group_depth = 0;
+	ctx.images = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	context = g_markup_parse_context_new (&complexity_parser, 0, &ctx, NULL);
+	gxps_parse_stream (context, stream, &err);
+	g_object_unref (stream);
+	g_markup_parse_context_free (context);
+
+	g_slist_free (ctx.groups);
+	g_hash_table_destroy (ctx.images);
+
+	if (err) {
+		g_propagate_error (error, err);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Text */
+typedef struct {
+	GXPSPage        *page;
+	GXPSMatrixStack *matrices;
+	GXPSGlyphs      *glyphs;
+	GArray          *runs;
+
+	/* Depth of the element whose contents are ignored, like paths,
+	 * brushes and resources, or 0.
+	 */
+	guint            skip_depth;
+	gboolean         do_transform;
+} GXPSTextContext;
+
+static void
+text_run_clear (GXPSTextRun *run)
+{
+	g_free (run->text);
+	g_free (run->areas);
+}
+
+/* Bounding box in page coordinates of a rectangle in user space */
+static void
+matrix_transform_box (const cairo_matrix_t *matrix,
+		      gdouble               x1,
+		      gdouble               y1,
+		      gdouble               x2,
+		      gdouble               y2,
+		      cairo_rectangle_t    *box)
+{
+	gdouble xs[4] = { x1, x2, x1, x2 };
+	gdouble ys[4] = { y1, y1, y2, y2 };
+	gdouble min_x, min_y, max_x, max_y;
+	guint   i;
+
+	for (i = 0; i < 4; i++)
+		cairo_matrix_transform_point (matrix, &xs[i], &ys[i]);
+
+	min_x = max_x = xs[0];
+	min_y = max_y = ys[0];
+	for (i = 1; i < 4; i++) {
+		min_x = MIN (min_x, xs[i]);
+		max_x = MAX (max_x, xs[i]);
+		min_y = MIN (min_y, ys[i]);
+		max_y = MAX (max_y, ys[i]);
+	}
+
+	box->x = min_x;
+	box->y = min_y;
+	box->width = max_x - min_x;
+	box->height = max_y - min_y;
+}
+
+static void
+text_box_union (cairo_rectangle_t       *box,
+		const cairo_rectangle_t *other)
+{
+	gdouble x2, y2;
+
+	x2 = MAX (box->x + box->width, other->x + other->width);
+	y2 = MAX (box->y + box->height, other->y + other->height);
+	box->x = MIN (box->x, other->x);
+	box->y = MIN (box->y, other->y);
+	box->width = x2 - box->x;
+	box->height = y2 - box->y;
+}
+
+/* Glyph positions are computed like when rendering, but the scaled
+ * font is only used for its metrics, nothing is drawn.
+ */
+static gboolean
+text_add_glyphs_run (GXPSTextContext *ctx,
+		     GXPSGlyphs      *glyphs,
+		     GError         **error)
+{
+	const cairo_matrix_t *matrix = gxps_matrix_stack_get_matrix (ctx->matrices);
+	cairo_font_face_t    *font_face;
+	cairo_font_options_t *font_options;
+	cairo_scaled_font_t  *scaled_font;
+	cairo_matrix_t        font_matrix, ctm;
+	cairo_font_extents_t  font_extents;
+	cairo_glyph_t        *glyph_list = NULL;
+	gint                  num_glyphs;
+	cairo_text_cluster_t *cluster_list = NULL;
+	gint                  num_clusters;
+	const gchar          *utf8;
+	const gchar          *p;
+	GXPSTextRun           run;
+	GArray               *areas;
+	gint                  i, j, n_glyph;
+
+	/* UnicodeString may begin with escape sequence "{}" */
+	utf8 = glyphs->text;
+	if (utf8 && g_str_has_prefix (utf8, "{}"))
+		utf8 += 2;
+	if (!utf8 || *utf8 == '\0')
+		return TRUE;
+
+	font_face = gxps_fonts_get_font (ctx->page->priv->zip, glyphs->font_uri, error);
+	if (!font_face)
+		return FALSE;
+
+	font_options = cairo_font_options_create ();
+	cairo_font_options_set_hint_metrics (font_options, CAIRO_HINT_METRICS_OFF);
+
+	cairo_matrix_init_identity (&font_matrix);
+	cairo_matrix_scale (&font_matrix, glyphs->em_size, glyphs->em_size);
+	cairo_matrix_init_identity (&ctm);
+
+	/* italics is 20 degrees slant.  0.342 = sin(20 deg) */
+	if (glyphs->italic)
+		font_matrix.xy = glyphs->em_size * -0.342;
+
+	if (glyphs->is_sideways)
+		cairo_matrix_rotate (&font_matrix, -G_PI_2);
+
+	scaled_font = cairo_scaled_font_create (font_face, &font_matrix, &ctm, font_options);
+	cairo_font_options_destroy (font_options);
+
+	if (!gxps_glyphs_to_cairo_glyphs (glyphs, scaled_font, utf8,
+					  &glyph_list, &num_glyphs,
+					  &cluster_list, &num_clusters,
+					  error)) {
+		cairo_scaled_font_destroy (scaled_font);
+		return FALSE;
+	}
+
+	cairo_scaled_font_extents (scaled_font, &font_extents);
+
+	run.text = g_strdup (utf8);
+	run.extents.x = run.extents.y = 0;
+	run.extents.width = run.extents.height = 0;
+	areas = g_array_sized_new (FALSE, FALSE, sizeof (cairo_rectangle_t), strlen (utf8));
+
+	/* All the characters of a cluster get the box of its glyphs */
+	p = utf8;
+	n_glyph = 0;
+	for (i = 0; i < num_clusters; i++) {
+		cairo_rectangle_t cluster_box = { 0, 0, 0, 0 };
+		const gchar      *cluster_end;
+
+		for (j = 0; j < cluster_list[i].num_glyphs && n_glyph < num_glyphs; j++, n_glyph++) {
+			cairo_glyph_t        *glyph = &glyph_list[n_glyph];
+			cairo_text_extents_t  extents;
+			cairo_rectangle_t     box;
+
+			cairo_scaled_font_glyph_extents (scaled_font, glyph, 1, &extents);
+			if (glyphs->is_sideways) {
+				matrix_transform_box (matrix,
+						      glyph->x + extents.x_bearing,
+						      glyph->y + extents.y_bearing,
+						      glyph->x + extents.x_bearing + extents.width,
+						      glyph->y + extents.y_bearing + extents.height,
+						      &box);
+			} else {
+				matrix_transform_box (matrix,
+						      glyph->x,
+						      glyph->y - font_extents.ascent,
+						      glyph->x + extents.x_advance,
+						      glyph->y + font_extents.descent,
+						      &box);
+			}
+
+			if (j == 0)
+				cluster_box = box;
+			else
+				text_box_union (&cluster_box, &box);
+		}
+
+		if (i == 0)
+			run.extents = cluster_box;
+		else
+			text_box_union (&run.extents, &cluster_box);
+
+		cluster_end = p + cluster_list[i].num_bytes;
+		for (; *p && p < cluster_end; p = g_utf8_next_char (p))
+			g_array_append_val (areas, cluster_box);
+	}
+
+	/* Characters without glyphs get an empty box at the end of the run */
+	for (; *p; p = g_utf8_next_char (p)) {
+		cairo_rectangle_t box;
+
+		box.x = run.extents.x + run.extents.width;
+		box.y = run.extents.y;
+		box.width = 0;
+		box.height = run.extents.height;
+		g_array_append_val (areas, box);
+	}
+
+	run.n_areas = areas->len;
+	run.areas = (cairo_rectangle_t *)g_array_free (areas, FALSE);
+	g_array_append_val (ctx->runs, run);
+
+	g_free (glyph_list);
+	g_free (cluster_list);
+	cairo_scaled_font_destroy (scaled_font);
+
+	return TRUE;
+}
+
+static gboolean
+matrix_stack_parse_transform (GMarkupParseContext  *context,
+			      GXPSPage             *page,
+			      GXPSMatrixStack      *matrices,
+			      const gchar          *element_name,
+			      const gchar          *attribute_name,
+			      const gchar          *value,
+			      GError              **error)
+{
+	cairo_matrix_t matrix;
+
+	if (!gxps_matrix_parse (value, &matrix)) {
+		gxps_parse_error (context,
+				  page->priv->source,
+				  G_MARKUP_ERROR_INVALID_CONTENT,
+				  element_name, attribute_name, value, error);
+		return FALSE;
+	}
+	gxps_matrix_stack_transform (matrices, &matrix);
+
+	return TRUE;
+}
+
+static void
+text_start_element (GMarkupParseContext  *context,
+		    const gchar          *element_name,
+		    const gchar         **names,
+		    const gchar         **values,
+		    gpointer              user_data,
+		    GError              **error)
+{
+	GXPSTextContext *ctx = (GXPSTextContext *)user_data;
+	gint             i;
+
+	if (ctx->skip_depth > 0) {
+		ctx->skip_depth++;
+		return;
+	}
+
+	if (strcmp (element_name, "Canvas") == 0) {
+		gxps_matrix_stack_save (ctx->matrices);
+
+		for (i = 0; names[i] != NULL; i++) {
+			if (strcmp (names[i], "RenderTransform") == 0) {
+				if (!matrix_stack_parse_transform (context, ctx->page, ctx->matrices,
+								   element_name, names[i], values[i], error))
+					return;
+			}
+		}
+	} else if (strcmp (element_name, "Glyphs") == 0) {
+		gchar       *font_uri = NULL;
+		gdouble      font_size = -1;
+		gdouble      x = -1, y = -1;
+		const gchar *text = NULL;
+		const gchar *indices = NULL;
+		gint         bidi_level = 0;
+		gboolean     is_sideways = FALSE;
+		gboolean     italic = FALSE;
+		gboolean     valid = TRUE;
+
+		gxps_matrix_stack_save (ctx->matrices);
+
+		for (i = 0; names[i] != NULL && valid; i++) {
+			if (strcmp (names[i], "FontRenderingEmSize") == 0) {
+				valid = gxps_value_get_double (values[i], &font_size);
+			} else if (strcmp (names[i], "FontUri") == 0) {
+				font_uri = gxps_resolve_relative_path (ctx->page->priv->source,
+								       values[i]);
+			} else if (strcmp (names[i], "OriginX") == 0) {
+				valid = gxps_value_get_double (values[i], &x);
+			} else if (strcmp (names[i], "OriginY") == 0) {
+				valid = gxps_value_get_double (values[i], &y);
+			} else if (strcmp (names[i], "UnicodeString") == 0) {
+				text = values[i];
+			} else if (strcmp (names[i], "Indices") == 0) {
+				indices = values[i];
+			} else if (strcmp (names[i], "RenderTransform") == 0) {
+				if (!matrix_stack_parse_transform (context, ctx->page, ctx->matrices,
+								   element_name, names[i], values[i], error)) {
+					g_free (font_uri);
+					return;
+				}
+			} else if (strcmp (names[i], "BidiLevel") == 0) {
+				valid = gxps_value_get_int (values[i], &bidi_level);
+			} else if (strcmp (names[i], "IsSideways") == 0) {
+				valid = gxps_value_get_boolean (values[i], &is_sideways);
+			} else if (strcmp (names[i], "StyleSimulations") == 0) {
+				italic = strcmp (values[i], "ItalicSimulation") == 0;
+			}
+		}
+
+		if (!valid) {
+			gxps_parse_error (context,
+					  ctx->page->priv->source,
+					  G_MARKUP_ERROR_INVALID_CONTENT,
+					  element_name, names[i - 1], values[i - 1], error);
+			g_free (font_uri);
+			return;
+		}
+
+		if (!font_uri || font_size == -1 || x == -1 || y == -1) {
+			gxps_parse_error (context,
+					  ctx->page->priv->source,
+					  G_MARKUP_ERROR_MISSING_ATTRIBUTE,
+					  element_name,
+					  !font_uri ? "FontUri" :
+					  font_size == -1 ? "FontRenderingEmSize" :
+					  x == -1 ? "OriginX" : "OriginY",
+					  NULL, error);
+			g_free (font_uri);
+			return;
+		}
+
+		/* GXPSGlyphs takes ownership of font_uri */
+		ctx->glyphs = gxps_glyphs_new (NULL, font_uri, font_size, x, y);
+		ctx->glyphs->text = g_strdup (text);
+		ctx->glyphs->indices = g_strdup (indices);
+		ctx->glyphs->bidi_level = bidi_level;
+		ctx->glyphs->is_sideways = is_sideways;
+		ctx->glyphs->italic = italic;
+	} else if (strcmp (element_name, "Canvas.RenderTransform") == 0 ||
+		   strcmp (element_name, "Glyphs.RenderTransform") == 0) {
+		ctx->do_transform = TRUE;
+	} else if (strcmp (element_name, "MatrixTransform") == 0) {
+		if (!ctx->do_transform)
+			return;
+
+		for (i = 0; names[i] != NULL; i++) {
+			if (strcmp (names[i], "Matrix") == 0) {
+				matrix_stack_parse_transform (context, ctx->page, ctx->matrices,
+							      element_name, names[i], values[i], error);
+				return;
+			}
+		}
+	} else if (strcmp (element_name, "FixedPage") == 0) {
+		/* Nothing to do */
+	} else {
+		/* Paths, brushes, resources, clips... */
+		ctx->skip_depth = 1;
+	}
+}
+
+static void
+text_end_element (GMarkupParseContext  *context,
+		  const gchar          *element_name,
+		  gpointer              user_data,
+		  GError              **error)
+{
+	GXPSTextContext *ctx = (GXPSTextContext *)user_data;
+
+	if (ctx->skip_depth > 0) {
+		ctx->skip_depth--;
+		return;
+	}
+
+	if (strcmp (element_name, "Canvas") == 0) {
+		gxps_matrix_stack_restore (ctx->matrices);
+	} else if (strcmp (element_name, "Glyphs") == 0) {
+		GXPSGlyphs *glyphs = ctx->glyphs;
+
+		ctx->glyphs = NULL;
+		text_add_glyphs_run (ctx, glyphs, error);
+		gxps_glyphs_free (glyphs);
+		gxps_matrix_stack_restore (ctx->matrices);
+	} else if (strcmp (element_name, "Canvas.RenderTransform") == 0 ||
+		   strcmp (element_name, "Glyphs.RenderTransform") == 0) {
+		ctx->do_transform = FALSE;
+	}
+}
+
+static const GMarkupParser text_parser = {
+	text_start_element,
+	text_end_element,
+	NULL,
+	NULL,
+	NULL
+};
+
+static GArray *
+gxps_page_parse_text (GXPSPage *page,
+		      GError  **error)
+{
+	GInputStream        *stream;
+	GXPSTextContext      ctx;
+	GMarkupParseContext *context;
+	cairo_matrix_t       matrix;
+	GError              *err = NULL;
+
+	stream = gxps_archive_open (page->priv->zip,
+				    page->priv->source);
+	if (!stream) {
+		g_set_error (error,
+			     GXPS_ERROR,
+			     GXPS_ERROR_SOURCE_NOT_FOUND,
+			     "Page source %s not found in archive",
+			     page->priv->source);
+		return NULL;
+	}
+
+	cairo_matrix_init_identity (&matrix);
+	ctx.page = page;
+	ctx.matrices = gxps_matrix_stack_new (&matrix);
+	ctx.glyphs = NULL;
+	ctx.runs = g_array_new (FALSE, FALSE, sizeof (GXPSTextRun));
+	g_array_set_clear_func (ctx.runs, (GDestroyNotify)text_run_clear);
+	ctx.skip_depth = 0;
+	ctx.do_transform = FALSE;
+
+	context = g_markup_parse_context_new (&text_parser, 0, &ctx, NULL);
+	gxps_parse_stream (context, stream, &err);
+	g_object_unref (stream);
+	g_markup_parse_context_free (context);
+
+	gxps_glyphs_free (ctx.glyphs);
+	gxps_matrix_stack_free (ctx.matrices);
+
+	if (err) {
+		g_propagate_error (error, err);
+		g_array_free (ctx.runs, TRUE);
+		return NULL;
+	}
+
+	return ctx.runs;
+}
+
+/* Image mapping */
+typedef struct {
+	gchar             *image_uri;
+	cairo_rectangle_t  viewport;
+	cairo_matrix_t     transform;
+} ImageMappingBrush;
+
+typedef struct {
+	GXPSPage          *page;
+	GXPSMatrixStack   *matrices;
+	GList             *mappings;
+
+	/* ImageBrush elements of the page resources by key */
+	GHashTable        *brushes;
+	/* Image URI to its GXPSImage with only the size, or NULL */
+	GHashTable        *images;
+
+	ImageMappingBrush *brush;
+	gchar             *brush_key;
+
+	/* Brush references of the Canvas, Path and Glyphs elements being
+	 * parsed, innermost first, as a NULL terminated array or NULL.
+	 * They're resolved once the RenderTransform of the element is known.
+	 */
+	GSList            *references;
+
+	guint              resources_depth;
+	/* Depth of a VisualBrush whose contents are ignored, or 0 */
+	guint              skip_depth;
+	gboolean           do_transform;
+	gboolean           do_brush_transform;
+} GXPSImageMappingContext;
+
+static void
+image_mapping_brush_free (ImageMappingBrush *brush)
+{
+	if (G_UNLIKELY (!brush))
+		return;
+
+	g_free (brush->image_uri);
+	g_slice_free (ImageMappingBrush, brush);
+}
+
+static void
+image_mapping_add (GXPSImageMappingContext *ctx,
+		   ImageMappingBrush       *brush)
+{
+	GXPSImageMapping *mapping;
+	GXPSImage        *image;
+	cairo_matrix_t    matrix;
+
+	cairo_matrix_multiply (&matrix, &brush->transform,
+			       gxps_matrix_stack_get_matrix (ctx->matrices));
+
+	mapping = g_slice_new (GXPSImageMapping);
+	mapping->image_uri = g_strdup (brush->image_uri);
+	matrix_transform_box (&matrix,
+			      brush->viewport.x,
+			      brush->viewport.y,
+			      brush->viewport.x + brush->viewport.width,
+			      brush->viewport.y + brush->viewport.height,
+			      &mapping->area);
+
+	/* Only the image header is read */
+	if (!g_hash_table_lookup_extended (ctx->images, brush->image_uri, NULL, (gpointer *)&image)) {
+		image = gxps_images_get_image_info (ctx->page->priv->zip, brush->image_uri, 0, NULL);
+		g_hash_table_insert (ctx->images, g_strdup (brush->image_uri), image);
+	}
+	mapping->width = image ? image->width : 0;
+	mapping->height = image ? image->height : 0;
+
+	ctx->mappings = g_list_prepend (ctx->mappings, mapping);
+}
+
+/* Brushes of the page resources are referenced as {StaticResource key} */
+static void
+image_mapping_add_resource (GXPSImageMappingContext *ctx,
+			    const gchar             *value)
+{
+	ImageMappingBrush *brush;
+	gchar             *key;
+
+	if (!g_str_has_prefix (value, "{StaticResource ") || !g_str_has_suffix (value, "}"))
+		return;
+
+	key = g_strndup (value + strlen ("{StaticResource "),
+			 strlen (value) - strlen ("{StaticResource ") - 1);
+	brush = g_hash_table_lookup (ctx->brushes, g_strstrip (key));
+	g_free (key);
+
+	if (brush)
+		image_mapping_add (ctx, brush);
+}
+
+/* Resolves the brush references of the innermost element */
+static void
+image_mapping_resolve_references (GXPSImageMappingContext *ctx)
+{
+	gchar **references = ctx->references->data;
+	gint    i;
+
+	if (!references)
+		return;
+
+	/* Brushes are in the coordinates of the element */
+	for (i = 0; references[i] != NULL; i++)
+		image_mapping_add_resource (ctx, references[i]);
+
+	g_strfreev (references);
+	ctx->references->data = NULL;
+}
+
+static void
+image_mapping_start_element (GMarkupParseContext  *context,
+			     const gchar          *element_name,
+			     const gchar         **names,
+			     const gchar         **values,
+			     gpointer              user_data,
+			     GError              **error)
+{
+	GXPSImageMappingContext *ctx = (GXPSImageMappingContext *)user_data;
+	gint                     i;
+
+	if (ctx->skip_depth > 0) {
+		ctx->skip_depth++;
+		return;
+	}
+
+	if (strcmp (element_name, "Canvas") == 0 ||
+	    strcmp (element_name, "Path") == 0 ||
+	    strcmp (element_name, "Glyphs") == 0) {
+		GPtrArray *references = NULL;
+
+		gxps_matrix_stack_save (ctx->matrices);
+
+		for (i = 0; names[i] != NULL; i++) {
+			if (strcmp (names[i], "RenderTransform") == 0) {
+				if (!matrix_stack_parse_transform (context, ctx->page, ctx->matrices,
+								   element_name, names[i], values[i], error))
+					break;
+			} else if (strcmp (names[i], "Fill") == 0 ||
+				   strcmp (names[i], "Stroke") == 0 ||
+				   strcmp (names[i], "OpacityMask") == 0) {
+				if (!references)
+					references = g_ptr_array_new ();
+				g_ptr_array_add (references, g_strdup (values[i]));
+			}
+		}
+
+		/* The element transform might still be in a child element */
+		if (references)
+			g_ptr_array_add (references, NULL);
+		ctx->references = g_slist_prepend (ctx->references,
+						   references ? g_ptr_array_free (references, FALSE) : NULL);
+	} else if (strcmp (element_name, "Canvas.RenderTransform") == 0 ||
+		   strcmp (element_name, "Path.RenderTransform") == 0 ||
+		   strcmp (element_name, "Glyphs.RenderTransform") == 0) {
+		ctx->do_transform = TRUE;
+	} else if (strcmp (element_name, "ImageBrush.Transform") == 0) {
+		ctx->do_brush_transform = TRUE;
+	} else if (strcmp (element_name, "MatrixTransform") == 0) {
+		for (i = 0; names[i] != NULL; i++) {
+			if (strcmp (names[i], "Matrix") != 0)
+				continue;
+
+			if (ctx->do_brush_transform && ctx->brush) {
+				if (!gxps_matrix_parse (values[i], &ctx->brush->transform)) {
+					gxps_parse_error (context,
+							  ctx->page->priv->source,
+							  G_MARKUP_ERROR_INVALID_CONTENT,
+							  element_name, names[i], values[i], error);
+				}
+			} else if (ctx->do_transform) {
+				matrix_stack_parse_transform (context, ctx->page, ctx->matrices,
+							      element_name, names[i], values[i], error);
+			}
+			return;
+		}
+	} else if (strcmp (element_name, "ImageBrush") == 0) {
+		ImageMappingBrush *brush;
+
+		brush = g_slice_new0 (ImageMappingBrush);
+		cairo_matrix_init_identity (&brush->transform);
+
+		for (i = 0; names[i] != NULL; i++) {
+			if (strcmp (names[i], "ImageSource") == 0) {
+				g_free (brush->image_uri);
+				brush->image_uri = gxps_resolve_relative_path (ctx->page->priv->source,
+									       values[i]);
+			} else if (strcmp (names[i], "Transform") == 0) {
+				if (!gxps_matrix_parse (values[i], &brush->transform)) {
+					gxps_parse_error (context,
+							  ctx->page->priv->source,
+							  G_MARKUP_ERROR_INVALID_CONTENT,
+							  element_name, names[i], values[i], error);
+					image_mapping_brush_free (brush);
+					return;
+				}
+			} else if (strcmp (names[i], "Viewport") == 0) {
+				if (!gxps_box_parse (values[i], &brush->viewport)) {
+					gxps_parse_error (context,
+							  ctx->page->priv->source,
+							  G_MARKUP_ERROR_INVALID_CONTENT,
+							  element_name, names[i], values[i], error);
+					image_mapping_brush_free (brush);
+					return;
+				}
+			} else if (strcmp (names[i], "x:Key") == 0) {
+				g_free (ctx->brush_key);
+				ctx->brush_key = g_strdup (values[i]);
+			}
+		}
+
+		if (!brush->image_uri) {
+			gxps_parse_error (context,
+					  ctx->page->priv->source,
+					  G_MARKUP_ERROR_MISSING_ATTRIBUTE,
+					  element_name, "ImageSource",
+					  NULL, error);
+			image_mapping_brush_free (brush);
+			return;
+		}
+
+		ctx->brush = brush;
+	} else if (strcmp (element_name, "VisualBrush") == 0) {
+		/* Images of visual brushes are not in page coordinates */
+		ctx->skip_depth = 1;
+	} else if (g_str_has_suffix (element_name, ".Resources")) {
+		ctx->resources_depth++;
+	}
+}
+
+static void
+image_mapping_end_element (GMarkupParseContext  *context,
+			   const gchar          *element_name,
+			   gpointer              user_data,
+			   GError              **error)
+{
+	GXPSImageMappingContext *ctx = (GXPSImageMappingContext *)user_data;
+
+	if (ctx->skip_depth > 0) {
+		ctx->skip_depth--;
+		return;
+	}
+
+	if (strcmp (element_name, "Canvas") == 0 ||
+	    strcmp (element_name, "Path") == 0 ||
+	    strcmp (element_name, "Glyphs") == 0) {
+		image_mapping_resolve_references (ctx);
+		ctx->references = g_slist_delete_link (ctx->references, ctx->references);
+		gxps_matrix_stack_restore (ctx->matrices);
+	} else if (strcmp (element_name, "Canvas.RenderTransform") == 0 ||
+		   strcmp (element_name, "Path.RenderTransform") == 0 ||
+		   strcmp (element_name, "Glyphs.RenderTransform") == 0) {
+		ctx->do_transform = FALSE;
+		image_mapping_resolve_references (ctx);
+	} else if (strcmp (element_name, "ImageBrush.Transform") == 0) {
+		ctx->do_brush_transform = FALSE;
+	} else if (strcmp (element_name, "ImageBrush") == 0) {
+		ImageMappingBrush *brush = ctx->brush;
+		gchar             *key = ctx->brush_key;
+
+		ctx->brush = NULL;
+		ctx->brush_key = NULL;
+
+		if (ctx->resources_depth > 0) {
+			if (key) {
+				g_hash_table_replace (ctx->brushes, key, brush);
+				return;
+			}
+			image_mapping_brush_free (brush);
+		} else {
+			image_mapping_add (ctx, brush);
+			image_mapping_brush_free (brush);
+		}
+		g_free (key);
+	} else if (g_str_has_suffix (element_name, ".Resources")) {
+		ctx->resources_depth--;
+	}
+}
+
+static const GMarkupParser image_mapping_parser = {
+	image_mapping_start_element,
+	image_mapping_end_element,
+	NULL,
+	NULL,
+	NULL
+};
+
+static GList *
+gxps_page_parse_image_mapping (GXPSPage *page,
+			       GError  **error)
+{
+	GInputStream            *stream;
+	GXPSImageMappingContext  ctx;
+	GMarkupParseContext     *context;
+	cairo_matrix_t           matrix;
+	GError                  *err = NULL;
+
+	stream = gxps_archive_open (page->priv->zip,
+				    page->priv->source);
+	if (!stream) {
+		g_set_error (error,
+			     GXPS_ERROR,
+			     GXPS_ERROR_SOURCE_NOT_FOUND,
+			     "Page source %s not found in archive",
+			     page->priv->source);
+		return NULL;
+	}
+
+	cairo_matrix_init_identity (&matrix);
+	memset (&ctx, 0, sizeof (GXPSImageMappingContext));
+	ctx.page = page;
+	ctx.matrices = gxps_matrix_stack_new (&matrix);
+	ctx.brushes = g_hash_table_new_full (g_str_hash,
+					     g_str_equal,
+					     (GDestroyNotify)g_free,
+					     (GDestroyNotify)image_mapping_brush_free);
+	ctx.images = g_hash_table_new_full (g_str_hash,
+					    g_str_equal,
+					    (GDestroyNotify)g_free,
+					    (GDestroyNotify)gxps_image_free);
+
+	context = g_markup_parse_context_new (&image_mapping_parser, 0, &ctx, NULL);
+	gxps_parse_stream (context, stream, &err);
+	g_object_unref (stream);
+	g_markup_parse_context_free (context);
+
+	image_mapping_brush_free (ctx.brush);
+	g_free (ctx.brush_key);
+	g_slist_free_full (ctx.references, (GDestroyNotify)g_strfreev);
+	g_hash_table_destroy (ctx.brushes);
+	g_hash_table_destroy (ctx.images);
+	gxps_matrix_stack_free (ctx.matrices);
+
+	if (err) {
+		g_propagate_error (error, err);
+		g_list_free_full (ctx.mappings, (GDestroyNotify)gxps_image_mapping_free);
+		return NULL;
+	}
+
+	return g_list_reverse (ctx.mappings);
+}
+
+static void
+gxps_page_finalize (GObject *object)
+{
+	GXPSPage *page = GXPS_PAGE (object);
+
+	g_clear_object (&page->priv->zip);
+	g_clear_pointer (&page->priv->source, g_free);
 	g_clear_error (&page->priv->init_error);
 	g_clear_pointer (&page->priv->lang, g_free);
 	g_clear_pointer (&page->priv->name, g_free);
 	g_clear_pointer (&page->priv->image_cache, g_hash_table_destroy);
+	g_list_free_full (page->priv->links, (GDestroyNotify)gxps_link_free);
+	page->priv->links = NULL;
+	page->priv->has_links = FALSE;
 	g_clear_pointer (&page->priv->anchors, g_hash_table_destroy);
 	page->priv->has_anchors = FALSE;
+	g_clear_pointer (&page->priv->stats, gxps_stats_free);
+	if (page->priv->complexity) {
+		g_slice_free (GXPSPageComplexity, page->priv->complexity);
+		page->priv->complexity = NULL;
+	}
+	g_clear_pointer (&page->priv->text_runs, g_array_unref);
 
 	G_OBJECT_CLASS (gxps_page_parent_class)->finalize (object);
 }
@@ -1720,7 +3194,10 @@ gxps_page_initable_init (GInitable     *initable,
 			 GCancellable  *cancellable,
 			 GError       **error)
 {
-	GXPSPage *page = GXPS_PAGE (initable);
+	GXPSPage  *page = GXPS_PAGE (initable);
+	GXPSStats *previous_stats;
+	gint64     start;
+	gboolean   parsed;
 
 	if (page->priv->initialized) {
 		if (page->priv->init_error) {
@@ -1733,7 +3210,13 @@ gxps_page_initable_init (GInitable     *initable,
 
 	page->priv->initialized = TRUE;
 
-	if (!gxps_page_parse_fixed_page (page, &page->priv->init_error)) {
+	previous_stats = gxps_page_push_stats (page);
+	start = gxps_archive_stats_begin (page->priv->zip);
+	parsed = gxps_page_parse_fixed_page (page, &page->priv->init_error);
+	gxps_archive_stats_end (page->priv->zip, GXPS_STATS_PHASE_PAGE, start);
+	gxps_archive_stats_pop_page (previous_stats);
+
+	if (!parsed) {
 		g_propagate_error (error, g_error_copy (page->priv->init_error));
 		return FALSE;
 	}
@@ -1819,7 +3302,40 @@ gxps_page_render (GXPSPage *page,
 	g_return_val_if_fail (GXPS_IS_PAGE (page), FALSE);
 	g_return_val_if_fail (cr != NULL, FALSE);
 
-	return gxps_page_parse_for_rendering (page, cr, error);
+	return gxps_page_parse_for_rendering (page, cr, FALSE, error);
+}
+
+/**
+ * gxps_page_set_collect_links:
+ * @page: a #GXPSPage
+ * @collect_links: whether to collect links and anchors while rendering
+ *
+ * Sets whether gxps_page_render() should also collect the links and
+ * anchors of @page. They are cached in @page, so that the next calls to
+ * gxps_page_get_links() and gxps_page_get_anchor_destination() don't
+ * need to parse the page again. This is useful for viewers that render
+ * a page and then ask for its links.
+ *
+ * Since: 0.3.3
+ */
+void
+gxps_page_set_collect_links (GXPSPage *page,
+			     gboolean  collect_links)
+{
+	g_return_if_fail (GXPS_IS_PAGE (page));
+
+	page->priv->collect_links = collect_links;
+}
+
+/* Renders the page for previews: glyphs too small to be
+ * readable are skipped instead of loading their fonts.
+ */
+gboolean
+gxps_page_render_draft (GXPSPage *page,
+			cairo_t  *cr,
+			GError  **error)
+{
+	return gxps_page_parse_for_rendering (page, cr, TRUE, error);
 }
 
 /**
@@ -1830,7 +3346,9 @@ gxps_page_render (GXPSPage *page,
  * Gets a list of #GXPSLink items that map from a location
  * in @page to a #GXPSLinkTarget. Items in the list should
  * be freed with gxps_link_free() and the list itself with
- * g_list_free() when done.
+ * g_list_free() when done. The links are cached, so the page
+ * is only parsed the first time, or not at all if they were
+ * collected by gxps_page_render(), see gxps_page_set_collect_links().
  *
  * Returns: (element-type GXPS.Link) (transfer full):  a #GList
  *     of #GXPSLink items.
@@ -1839,23 +3357,23 @@ GList *
 gxps_page_get_links (GXPSPage *page,
 		     GError  **error)
 {
-	cairo_surface_t  *surface;
-	cairo_t          *cr;
-	GList            *links;
-	cairo_rectangle_t extents;
+	GList  *links;
+	GError *err = NULL;
 
         g_return_val_if_fail (GXPS_IS_PAGE (page), NULL);
 
-	extents.x = extents.y = 0;
-	extents.width = page->priv->width;
-	extents.height = page->priv->height;
+	if (page->priv->has_links)
+		return g_list_copy_deep (page->priv->links, (GCopyFunc)gxps_link_copy, NULL);
 
-	surface = cairo_recording_surface_create (CAIRO_CONTENT_COLOR, &extents);
-	cr = cairo_create (surface);
-	cairo_surface_destroy (surface);
+	links = gxps_page_parse_links (page, NULL, &err);
 
-	links = gxps_page_parse_links (page, cr, error);
-	cairo_destroy (cr);
+	if (err) {
+		g_propagate_error (error, err);
+		return links;
+	}
+
+	page->priv->links = g_list_copy_deep (links, (GCopyFunc)gxps_link_copy, NULL);
+	page->priv->has_links = TRUE;
 
 	return links;
 }
@@ -1890,22 +3408,7 @@ gxps_page_get_anchor_destination (GXPSPage          *page,
 		return FALSE;
 
 	if (!page->priv->anchors) {
-		cairo_surface_t  *surface;
-		cairo_t          *cr;
-		cairo_rectangle_t extents;
-		gboolean          success;
-
-		extents.x = extents.y = 0;
-		extents.width = page->priv->width;
-		extents.height = page->priv->height;
-
-		surface = cairo_recording_surface_create (CAIRO_CONTENT_COLOR, &extents);
-		cr = cairo_create (surface);
-		cairo_surface_destroy (surface);
-
-		success = gxps_page_parse_anchors (page, cr, error);
-		cairo_destroy (cr);
-		if (!success)
+		if (!gxps_page_parse_anchors (page, error))
 			return FALSE;
 	}
 
@@ -1922,3 +3425,322 @@ gxps_page_get_anchor_destination (GXPSPage          *page,
 
 	return TRUE;
 }
+
+/* The anchor areas of the page, or %NULL if they haven't been parsed
+ * yet or the page doesn't have anchors.
+ */
+GHashTable *
+_gxps_page_get_anchors (GXPSPage *page)
+{
+	return page->priv->anchors;
+}
+
+/**
+ * gxps_page_get_stats:
+ * @page: a #GXPSPage
+ *
+ * Gets the performance counters of loading and rendering @page. Stats
+ * are only collected after gxps_file_set_stats_enabled() has been called
+ * for the #GXPSFile @page belongs to. The work done for @page that is
+ * shared with other pages, like loading fonts, is only accounted to the
+ * page that did it first.
+ *
+ * Returns: (transfer full) (nullable): a new #GXPSStats if stats are
+ *     enabled, %NULL otherwise. Free the returned value with gxps_stats_free().
+ *
+ * Since: 0.3.3
+ */
+GXPSStats *
+gxps_page_get_stats (GXPSPage *page)
+{
+	g_return_val_if_fail (GXPS_IS_PAGE (page), NULL);
+
+	if (!gxps_archive_get_stats_enabled (page->priv->zip))
+		return NULL;
+
+	if (page->priv->stats)
+		return gxps_stats_copy (page->priv->stats);
+
+	return g_slice_new0 (GXPSStats);
+}
+
+/**
+ * gxps_page_get_complexity:
+ * @page: a #GXPSPage
+ * @complexity: (out caller-allocates): return location for the complexity
+ * @error: #GError for error reporting, or %NULL to ignore
+ *
+ * Estimates the cost of rendering @page, without rendering it. The page
+ * markup is scanned to count its elements, glyphs and path data, and
+ * only the headers of the images are read to get their size, so this
+ * is much cheaper than rendering and can be used to schedule the
+ * rendering of pages, for example sending the heaviest ones to
+ * dedicated workers. Geometries and brushes in remote resource
+ * dictionaries are not included. The result is cached, so calling
+ * this again for the same page costs nothing.
+ *
+ * Returns: %TRUE if @complexity has been filled, %FALSE in case of error.
+ *
+ * Since: 0.3.3
+ */
+gboolean
+gxps_page_get_complexity (GXPSPage           *page,
+			  GXPSPageComplexity *complexity,
+			  GError            **error)
+{
+	g_return_val_if_fail (GXPS_IS_PAGE (page), FALSE);
+	g_return_val_if_fail (complexity != NULL, FALSE);
+
+	if (!page->priv->complexity) {
+		GXPSPageComplexity page_complexity;
+
+		if (!gxps_page_parse_complexity (page, &page_complexity, error))
+			return FALSE;
+
+		page->priv->complexity = g_slice_dup (GXPSPageComplexity, &page_complexity);
+	}
+
+	*complexity = *page->priv->complexity;
+
+	return TRUE;
+}
+
+GArray *
+gxps_page_get_text_runs (GXPSPage *page,
+			 GError  **error)
+{
+	if (!page->priv->text_runs)
+		page->priv->text_runs = gxps_page_parse_text (page, error);
+
+	return page->priv->text_runs;
+}
+
+/**
+ * gxps_page_get_text:
+ * @page: a #GXPSPage
+ * @error: #GError for error reporting, or %NULL to ignore
+ *
+ * Gets the text of @page, the contents of its Glyphs elements in
+ * document order, one per line. The page is not rendered: paths,
+ * images and brushes are skipped, only the fonts used by the text
+ * are loaded.
+ *
+ * Returns: (transfer full): a newly allocated UTF-8 string with the
+ *     text of @page, or %NULL in case of error.
+ *     Free the returned string with g_free().
+ *
+ * Since: 0.3.3
+ */
+gchar *
+gxps_page_get_text (GXPSPage *page,
+		    GError  **error)
+{
+	GArray  *runs;
+	GString *text;
+	guint    i;
+
+	g_return_val_if_fail (GXPS_IS_PAGE (page), NULL);
+
+	runs = gxps_page_get_text_runs (page, error);
+	if (!runs)
+		return NULL;
+
+	text = g_string_new (NULL);
+	for (i = 0; i < runs->len; i++) {
+		GXPSTextRun *run = &g_array_index (runs, GXPSTextRun, i);
+
+		if (i > 0)
+			g_string_append_c (text, '\n');
+		g_string_append (text, run->text);
+	}
+
+	return g_string_free (text, FALSE);
+}
+
+/**
+ * gxps_page_get_text_layout:
+ * @page: a #GXPSPage
+ * @areas: (out) (array length=n_areas) (transfer full): return location
+ *     for the areas of the characters
+ * @n_areas: (out): return location for the number of areas
+ * @error: #GError for error reporting, or %NULL to ignore
+ *
+ * Gets the area in page coordinates of every character of the text
+ * returned by gxps_page_get_text(), in the same order. The areas are
+ * computed from the font metrics without rendering the page. Line
+ * breaks between runs get an empty area at the end of the previous run.
+ *
+ * Returns: %TRUE if @areas has been filled, %FALSE in case of error.
+ *     Free the returned array with g_free().
+ *
+ * Since: 0.3.3
+ */
+gboolean
+gxps_page_get_text_layout (GXPSPage           *page,
+			   cairo_rectangle_t **areas,
+			   guint              *n_areas,
+			   GError            **error)
+{
+	GArray *runs;
+	GArray *layout;
+	guint   i;
+
+	g_return_val_if_fail (GXPS_IS_PAGE (page), FALSE);
+	g_return_val_if_fail (areas != NULL, FALSE);
+	g_return_val_if_fail (n_areas != NULL, FALSE);
+
+	runs = gxps_page_get_text_runs (page, error);
+	if (!runs)
+		return FALSE;
+
+	layout = g_array_new (FALSE, FALSE, sizeof (cairo_rectangle_t));
+	for (i = 0; i < runs->len; i++) {
+		GXPSTextRun *run = &g_array_index (runs, GXPSTextRun, i);
+
+		if (i > 0) {
+			GXPSTextRun      *prev = &g_array_index (runs, GXPSTextRun, i - 1);
+			cairo_rectangle_t line_break;
+
+			line_break.x = prev->extents.x + prev->extents.width;
+			line_break.y = prev->extents.y;
+			line_break.width = 0;
+			line_break.height = prev->extents.height;
+			g_array_append_val (layout, line_break);
+		}
+		g_array_append_vals (layout, run->areas, run->n_areas);
+	}
+
+	*n_areas = layout->len;
+	*areas = (cairo_rectangle_t *)g_array_free (layout, FALSE);
+
+	return TRUE;
+}
+
+/**
+ * gxps_image_mapping_copy:
+ * @mapping: a #GXPSImageMapping
+ *
+ * Creates a copy of a #GXPSImageMapping.
+ *
+ * Returns: a copy of @mapping.
+ *     Free the returned object with gxps_image_mapping_free().
+ *
+ * Since: 0.3.3
+ */
+GXPSImageMapping *
+gxps_image_mapping_copy (GXPSImageMapping *mapping)
+{
+	GXPSImageMapping *mapping_copy;
+
+	g_return_val_if_fail (mapping != NULL, NULL);
+
+	mapping_copy = g_slice_dup (GXPSImageMapping, mapping);
+	mapping_copy->image_uri = g_strdup (mapping->image_uri);
+
+	return mapping_copy;
+}
+
+/**
+ * gxps_image_mapping_free:
+ * @mapping: a #GXPSImageMapping
+ *
+ * Frees a #GXPSImageMapping.
+ *
+ * Since: 0.3.3
+ */
+void
+gxps_image_mapping_free (GXPSImageMapping *mapping)
+{
+	if (G_UNLIKELY (!mapping))
+		return;
+
+	g_free (mapping->image_uri);
+	g_slice_free (GXPSImageMapping, mapping);
+}
+
+/**
+ * gxps_page_get_image_mapping:
+ * @page: a #GXPSPage
+ * @error: #GError for error reporting, or %NULL to ignore
+ *
+ * Gets the images drawn by the image brushes of @page, in document
+ * order, with the area where they are placed in page coordinates.
+ * Images are not decoded, their size in pixels is read from the image
+ * header. For tiled brushes the area is the one of a single tile. Images
+ * of visual brushes and of brushes in remote resource dictionaries
+ * are not included. The encoded data of the images can be retrieved
+ * with gxps_page_get_image_data().
+ *
+ * Returns: (element-type GXPSImageMapping) (transfer full): a #GList
+ *     of #GXPSImageMapping items, or %NULL if @page has no images or
+ *     in case of error.
+ *     Free the returned list with g_list_free_full() and
+ *     gxps_image_mapping_free().
+ *
+ * Since: 0.3.3
+ */
+GList *
+gxps_page_get_image_mapping (GXPSPage *page,
+			     GError  **error)
+{
+	g_return_val_if_fail (GXPS_IS_PAGE (page), NULL);
+
+	return gxps_page_parse_image_mapping (page, error);
+}
+
+/**
+ * gxps_page_get_image_data:
+ * @page: a #GXPSPage
+ * @image_uri: the URI of an image, as returned by
+ *     gxps_page_get_image_mapping()
+ * @error: #GError for error reporting, or %NULL to ignore
+ *
+ * Gets the encoded data of the image @image_uri, PNG, JPEG, TIFF or
+ * JPEG XR, without decoding it. If the image was already decoded to
+ * render @page, the data kept for it is returned without reading the
+ * archive again.
+ *
+ * Returns: (transfer full): a #GBytes with the contents of the image
+ *     part, or %NULL in case of error.
+ *     Free the returned object with g_bytes_unref().
+ *
+ * Since: 0.3.3
+ */
+GBytes *
+gxps_page_get_image_data (GXPSPage    *page,
+			  const gchar *image_uri,
+			  GError     **error)
+{
+	GXPSImage *image = NULL;
+	guchar    *data;
+	gsize      length;
+
+	g_return_val_if_fail (GXPS_IS_PAGE (page), NULL);
+	g_return_val_if_fail (image_uri != NULL, NULL);
+
+	if (page->priv->image_cache)
+		image = g_hash_table_lookup (page->priv->image_cache, image_uri);
+	if (image && image->surface) {
+		const guchar  *mime_data;
+		unsigned long  mime_length;
+
+		cairo_surface_get_mime_data (image->surface, CAIRO_MIME_TYPE_PNG,
+					     &mime_data, &mime_length);
+		if (!mime_data) {
+			cairo_surface_get_mime_data (image->surface, CAIRO_MIME_TYPE_JPEG,
+						     &mime_data, &mime_length);
+		}
+
+		/* The data is owned by the surface */
+		if (mime_data) {
+			return g_bytes_new_with_free_func (mime_data, mime_length,
+							   (GDestroyNotify)cairo_surface_destroy,
+							   cairo_surface_reference (image->surface));
+		}
+	}
+
+	if (!gxps_archive_read_entry (page->priv->zip, image_uri, &data, &length, error))
+		return NULL;
+
+	return g_bytes_new_take (data, length);
+}
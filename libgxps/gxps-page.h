@@ -28,6 +28,7 @@
 #include <gio/gio.h>
 #include <cairo.h>
 #include <libgxps/gxps-version.h>
+#include <libgxps/gxps-stats.h>
 
 G_BEGIN_DECLS
 
@@ -38,6 +39,8 @@ G_BEGIN_DECLS
 #define GXPS_IS_PAGE_CLASS(obj)  (G_TYPE_CHECK_CLASS_TYPE (obj, GXPS_TYPE_PAGE))
 #define GXPS_PAGE_GET_CLASS(obj) (G_TYPE_INSTANCE_GET_CLASS ((obj), GXPS_TYPE_PAGE, GXPSPageClass))
 
+#define GXPS_TYPE_IMAGE_MAPPING  (gxps_image_mapping_get_type ())
+
 /**
  * GXPS_PAGE_ERROR:
  *
@@ -65,6 +68,60 @@ typedef struct _GXPSPage        GXPSPage;
 typedef struct _GXPSPageClass   GXPSPageClass;
 typedef struct _GXPSPagePrivate GXPSPagePrivate;
 
+/**
+ * GXPSPageComplexity:
+ * @n_elements: number of elements in the page markup
+ * @n_canvases: number of Canvas elements
+ * @n_paths: number of Path elements
+ * @n_glyph_runs: number of Glyphs elements
+ * @n_glyphs: number of glyphs of all the Glyphs elements
+ * @path_data_bytes: length in bytes of all the path geometries
+ * @n_images: number of different images used by image brushes
+ * @image_pixels: number of pixels of all the different images
+ * @max_group_depth: maximum nesting of elements rendered in an
+ *     intermediate group because of their opacity or opacity mask
+ *
+ * An estimation of the cost of rendering a #GXPSPage, see
+ * gxps_page_get_complexity().
+ *
+ * Since: 0.3.3
+ */
+typedef struct _GXPSPageComplexity GXPSPageComplexity;
+
+struct _GXPSPageComplexity {
+	guint   n_elements;
+	guint   n_canvases;
+	guint   n_paths;
+	guint   n_glyph_runs;
+	guint64 n_glyphs;
+	guint64 path_data_bytes;
+	guint   n_images;
+	guint64 image_pixels;
+	guint   max_group_depth;
+};
+
+/**
+ * GXPSImageMapping:
+ * @image_uri: the URI of the image in the XPS file, to be passed
+ *     to gxps_page_get_image_data()
+ * @area: the area of the page where the image is placed, in page
+ *     coordinates
+ * @width: the width of the image in pixels, or 0 if unknown
+ * @height: the height of the image in pixels, or 0 if unknown
+ *
+ * An image placed in a #GXPSPage, see gxps_page_get_image_mapping().
+ *
+ * Since: 0.3.3
+ */
+typedef struct _GXPSImageMapping GXPSImageMapping;
+
+struct _GXPSImageMapping {
+	gchar             *image_uri;
+	cairo_rectangle_t  area;
+	guint              width;
+	guint              height;
+};
+
 /**
  * GXPSPage:
  *
@@ -96,6 +153,9 @@ gboolean gxps_page_render                 (GXPSPage          *page,
 					   cairo_t           *cr,
 					   GError           **error);
 GXPS_AVAILABLE_IN_ALL
+void     gxps_page_set_collect_links      (GXPSPage          *page,
+					   gboolean           collect_links);
+GXPS_AVAILABLE_IN_ALL
 GList   *gxps_page_get_links              (GXPSPage          *page,
 					   GError           **error);
 GXPS_AVAILABLE_IN_ALL
@@ -103,7 +163,34 @@ gboolean gxps_page_get_anchor_destination (GXPSPage          *page,
 					   const gchar       *anchor,
 					   cairo_rectangle_t *area,
 					   GError           **error);
+GXPS_AVAILABLE_IN_ALL
+GXPSStats *gxps_page_get_stats            (GXPSPage          *page);
+GXPS_AVAILABLE_IN_ALL
+gboolean gxps_page_get_complexity         (GXPSPage           *page,
+					   GXPSPageComplexity *complexity,
+					   GError            **error);
+GXPS_AVAILABLE_IN_ALL
+gchar   *gxps_page_get_text               (GXPSPage          *page,
+					   GError           **error);
+GXPS_AVAILABLE_IN_ALL
+gboolean gxps_page_get_text_layout        (GXPSPage           *page,
+					   cairo_rectangle_t **areas,
+					   guint              *n_areas,
+					   GError            **error);
+GXPS_AVAILABLE_IN_ALL
+GList   *gxps_page_get_image_mapping      (GXPSPage          *page,
+					   GError           **error);
+GXPS_AVAILABLE_IN_ALL
+GBytes  *gxps_page_get_image_data         (GXPSPage          *page,
+					   const gchar       *image_uri,
+					   GError           **error);
 
+GXPS_AVAILABLE_IN_ALL
+GType             gxps_image_mapping_get_type (void) G_GNUC_CONST;
+GXPS_AVAILABLE_IN_ALL
+GXPSImageMapping *gxps_image_mapping_copy     (GXPSImageMapping *mapping);
+GXPS_AVAILABLE_IN_ALL
+void              gxps_image_mapping_free     (GXPSImageMapping *mapping);
 
 G_END_DECLS
 
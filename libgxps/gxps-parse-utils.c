@@ -25,6 +25,8 @@
 
 #include "gxps-parse-utils.h"
 #include "gxps-private.h"
+#include "gxps-archive.h"
+#include "gxps-trace.h"
 
 #define BUFFER_SIZE 4096
 
@@ -153,46 +155,70 @@ gxps_charset_converter_new (void)
 
 #define utf8_has_bom(x) (x[0] == 0xef && x[1] == 0xbb && x[2] == 0xbf)
 
-gboolean
-gxps_parse_stream (GMarkupParseContext  *context,
-		   GInputStream         *stream,
-		   GError              **error)
+GInputStream *
+gxps_parse_stream_open (GInputStream *stream)
 {
 	GXPSCharsetConverter *converter;
 	GInputStream         *cstream;
-	guchar                buffer[BUFFER_SIZE];
-	gssize                bytes_read;
-	gboolean              has_bom;
-	gint                  line, column;
-	gboolean              retval = TRUE;
 
 	converter = gxps_charset_converter_new ();
 	cstream = g_converter_input_stream_new (stream, G_CONVERTER (converter));
 	g_object_unref (converter);
 
-	do {
-		bytes_read = g_input_stream_read (cstream, buffer, BUFFER_SIZE, NULL, error);
-		if (bytes_read < 0) {
-			retval = FALSE;
-			break;
-		}
+	return cstream;
+}
 
-		g_markup_parse_context_get_position (context, &line, &column);
-		has_bom = line == 1 && column == 1 && bytes_read >= 3 && utf8_has_bom (buffer);
-		if (!g_markup_parse_context_parse (context,
-						   has_bom ? (const gchar *)buffer + 3 : (const gchar *)buffer,
-						   has_bom ? bytes_read - 3 : bytes_read,
-						   error)) {
-			retval = FALSE;
-			break;
-		}
-	} while (bytes_read > 0);
+/* Parses the next chunk of @cstream, a stream created with
+ * gxps_parse_stream_open(). Returns the number of bytes parsed, 0 when
+ * the whole stream has been parsed, or -1 in case of error.
+ */
+gssize
+gxps_parse_stream_step (GMarkupParseContext  *context,
+			GInputStream         *cstream,
+			GError              **error)
+{
+	guchar   buffer[BUFFER_SIZE];
+	gssize   bytes_read;
+	gboolean has_bom;
+	gint     line, column;
+
+	bytes_read = g_input_stream_read (cstream, buffer, BUFFER_SIZE, NULL, error);
+	if (bytes_read < 0)
+		return -1;
+
+	if (bytes_read == 0)
+		return g_markup_parse_context_end_parse (context, error) ? 0 : -1;
+
+	g_markup_parse_context_get_position (context, &line, &column);
+	has_bom = line == 1 && column == 1 && bytes_read >= 3 && utf8_has_bom (buffer);
+	if (!g_markup_parse_context_parse (context,
+					   has_bom ? (const gchar *)buffer + 3 : (const gchar *)buffer,
+					   has_bom ? bytes_read - 3 : bytes_read,
+					   error))
+		return -1;
+
+	return bytes_read;
+}
+
+gboolean
+gxps_parse_stream (GMarkupParseContext  *context,
+		   GInputStream         *stream,
+		   GError              **error)
+{
+	GInputStream *cstream;
+	gssize        bytes_read;
 
-	if (retval)
-		g_markup_parse_context_end_parse (context, error);
+	GXPS_TRACE_BEGIN ("gxps_parse_stream", gxps_archive_input_stream_get_path (stream));
+
+	cstream = gxps_parse_stream_open (stream);
+	do {
+		bytes_read = gxps_parse_stream_step (context, cstream, error);
+	} while (bytes_read > 0);
 	g_object_unref (cstream);
 
-	return retval;
+	GXPS_TRACE_END ("gxps_parse_stream");
+
+	return bytes_read == 0;
 }
 
 void
@@ -354,6 +380,39 @@ gxps_point_parse (const gchar *point,
         return TRUE;
 }
 
+gboolean
+gxps_box_parse (const gchar       *box,
+                cairo_rectangle_t *rect)
+{
+        gchar **tokens;
+        gdouble b[4];
+        guint   i;
+
+        tokens = g_strsplit (box, ",", 4);
+        if (g_strv_length (tokens) != 4) {
+                g_strfreev (tokens);
+
+                return FALSE;
+        }
+
+        for (i = 0; i < 4; i++) {
+                if (!gxps_value_get_double (tokens[i], &b[i])) {
+                        g_strfreev (tokens);
+
+                        return FALSE;
+                }
+        }
+
+        rect->x = b[0];
+        rect->y = b[1];
+        rect->width = b[2];
+        rect->height = b[3];
+
+        g_strfreev (tokens);
+
+        return TRUE;
+}
+
 void
 gxps_parse_skip_number (gchar      **iter,
                         const gchar *end)
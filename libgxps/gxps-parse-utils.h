@@ -27,6 +27,10 @@ G_BEGIN_DECLS
 gboolean gxps_parse_stream                  (GMarkupParseContext  *context,
                                              GInputStream         *stream,
                                              GError              **error);
+GInputStream *gxps_parse_stream_open        (GInputStream         *stream);
+gssize   gxps_parse_stream_step             (GMarkupParseContext  *context,
+                                             GInputStream         *cstream,
+                                             GError              **error);
 void     gxps_parse_error                   (GMarkupParseContext  *context,
                                              const gchar          *source,
                                              GMarkupError          error_type,
@@ -47,6 +51,8 @@ gboolean gxps_value_get_boolean             (const gchar          *value,
 gboolean gxps_point_parse                   (const gchar          *point,
                                              gdouble              *x,
                                              gdouble              *y);
+gboolean gxps_box_parse                     (const gchar          *box,
+                                             cairo_rectangle_t    *rect);
 void     gxps_parse_skip_number             (gchar               **iter,
                                              const gchar          *end);
 gchar   *gxps_resolve_relative_path         (const gchar          *source,
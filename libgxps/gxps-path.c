@@ -20,6 +20,7 @@
 #include <config.h>
 
 #include <string.h>
+#include <math.h>
 
 #include "gxps-path.h"
 #include "gxps-matrix.h"
@@ -76,6 +77,8 @@ gxps_path_free (GXPSPath *path)
         cairo_pattern_destroy (path->stroke_pattern);
         cairo_pattern_destroy (path->opacity_mask);
         g_free (path->dash);
+        g_free (path->link_uri);
+        g_free (path->name);
 
         g_slice_free (GXPSPath, path);
 }
@@ -255,10 +258,289 @@ path_data_get_point (PathDataToken *token,
         return TRUE;
 }
 
-gboolean
-gxps_path_parse (const gchar *data,
-                 cairo_t     *cr,
-                 GError     **error)
+/* Path data is either built in a cairo context, or only used to compute
+ * its bounds, or both. The current point is tracked here too when
+ * computing the bounds, so that they don't depend on cairo.
+ */
+typedef struct {
+        cairo_t              *cr;
+        const cairo_matrix_t *matrix;
+        GXPSPathBounds       *bounds;
+
+        gdouble               current_x;
+        gdouble               current_y;
+        gdouble               start_x;
+        gdouble               start_y;
+        gboolean              has_current_point;
+} PathDataSink;
+
+static inline void
+path_bounds_add_device_point (GXPSPathBounds *bounds,
+                              gdouble         x,
+                              gdouble         y)
+{
+        if (bounds->is_empty) {
+                bounds->x1 = bounds->x2 = x;
+                bounds->y1 = bounds->y2 = y;
+                bounds->is_empty = FALSE;
+                return;
+        }
+
+        if (x < bounds->x1)
+                bounds->x1 = x;
+        else if (x > bounds->x2)
+                bounds->x2 = x;
+        if (y < bounds->y1)
+                bounds->y1 = y;
+        else if (y > bounds->y2)
+                bounds->y2 = y;
+}
+
+static inline void
+path_data_sink_to_device (PathDataSink *sink,
+                          gdouble      *x,
+                          gdouble      *y)
+{
+        if (sink->matrix)
+                cairo_matrix_transform_point (sink->matrix, x, y);
+}
+
+/* Adds the extrema of a cubic Bézier curve in one axis, the roots of
+ * its derivative, a t² + b t + c, in (0, 1).
+ */
+static void
+path_bounds_add_curve_extrema (GXPSPathBounds *bounds,
+                               const gdouble  *xs,
+                               const gdouble  *ys,
+                               const gdouble  *ps)
+{
+        gdouble a, b, c;
+        gdouble t[2];
+        guint   n_roots = 0;
+        guint   i;
+
+        /* The curve is inside the bounds of its end points when
+         * the control points are.
+         */
+        if (MIN (ps[0], ps[3]) <= MIN (ps[1], ps[2]) &&
+            MAX (ps[0], ps[3]) >= MAX (ps[1], ps[2]))
+                return;
+
+        a = -ps[0] + 3 * ps[1] - 3 * ps[2] + ps[3];
+        b = 2 * (ps[0] - 2 * ps[1] + ps[2]);
+        c = ps[1] - ps[0];
+
+        if (fabs (a) < 1e-12) {
+                if (fabs (b) > 1e-12)
+                        t[n_roots++] = -c / b;
+        } else {
+                gdouble discriminant = b * b - 4 * a * c;
+
+                if (discriminant >= 0) {
+                        gdouble sq = sqrt (discriminant);
+
+                        t[n_roots++] = (-b + sq) / (2 * a);
+                        t[n_roots++] = (-b - sq) / (2 * a);
+                }
+        }
+
+        for (i = 0; i < n_roots; i++) {
+                gdouble mt, x, y;
+
+                if (t[i] <= 0 || t[i] >= 1)
+                        continue;
+
+                mt = 1 - t[i];
+                x = mt * mt * mt * xs[0] + 3 * mt * mt * t[i] * xs[1] +
+                        3 * mt * t[i] * t[i] * xs[2] + t[i] * t[i] * t[i] * xs[3];
+                y = mt * mt * mt * ys[0] + 3 * mt * mt * t[i] * ys[1] +
+                        3 * mt * t[i] * t[i] * ys[2] + t[i] * t[i] * t[i] * ys[3];
+                path_bounds_add_device_point (bounds, x, y);
+        }
+}
+
+static void
+path_data_sink_get_current_point (PathDataSink *sink,
+                                  gdouble      *x,
+                                  gdouble      *y)
+{
+        if (sink->cr) {
+                cairo_get_current_point (sink->cr, x, y);
+        } else {
+                *x = sink->current_x;
+                *y = sink->current_y;
+        }
+}
+
+static void
+path_data_sink_track_move_to (PathDataSink *sink,
+                              gdouble       x,
+                              gdouble       y)
+{
+        sink->current_x = sink->start_x = x;
+        sink->current_y = sink->start_y = y;
+        sink->has_current_point = TRUE;
+}
+
+static void
+path_data_sink_track_line_to (PathDataSink *sink,
+                              gdouble       x,
+                              gdouble       y)
+{
+        gdouble dx, dy;
+
+        /* Like cairo, a line without current point is a move */
+        if (!sink->has_current_point) {
+                path_data_sink_track_move_to (sink, x, y);
+                return;
+        }
+
+        dx = sink->current_x;
+        dy = sink->current_y;
+        path_data_sink_to_device (sink, &dx, &dy);
+        path_bounds_add_device_point (sink->bounds, dx, dy);
+
+        sink->current_x = x;
+        sink->current_y = y;
+        path_data_sink_to_device (sink, &x, &y);
+        path_bounds_add_device_point (sink->bounds, x, y);
+}
+
+static void
+path_data_sink_track_curve_to (PathDataSink *sink,
+                               gdouble       x1,
+                               gdouble       y1,
+                               gdouble       x2,
+                               gdouble       y2,
+                               gdouble       x3,
+                               gdouble       y3)
+{
+        gdouble xs[4], ys[4];
+        guint   i;
+
+        /* Like cairo, a curve without current point starts at
+         * its first control point.
+         */
+        if (!sink->has_current_point)
+                path_data_sink_track_move_to (sink, x1, y1);
+
+        xs[0] = sink->current_x;
+        ys[0] = sink->current_y;
+        xs[1] = x1;
+        ys[1] = y1;
+        xs[2] = x2;
+        ys[2] = y2;
+        xs[3] = x3;
+        ys[3] = y3;
+
+        sink->current_x = x3;
+        sink->current_y = y3;
+
+        /* Transforming the control points is the same as transforming
+         * the curve, so the extrema are found in device space.
+         */
+        for (i = 0; i < 4; i++)
+                path_data_sink_to_device (sink, &xs[i], &ys[i]);
+
+        path_bounds_add_device_point (sink->bounds, xs[0], ys[0]);
+        path_bounds_add_device_point (sink->bounds, xs[3], ys[3]);
+        path_bounds_add_curve_extrema (sink->bounds, xs, ys, xs);
+        path_bounds_add_curve_extrema (sink->bounds, xs, ys, ys);
+}
+
+static void
+path_data_sink_move_to (PathDataSink *sink,
+                        gboolean      is_rel,
+                        gdouble       x,
+                        gdouble       y)
+{
+        if (sink->cr) {
+                if (is_rel)
+                        cairo_rel_move_to (sink->cr, x, y);
+                else
+                        cairo_move_to (sink->cr, x, y);
+        }
+
+        if (!sink->bounds)
+                return;
+
+        if (is_rel) {
+                x += sink->current_x;
+                y += sink->current_y;
+        }
+        path_data_sink_track_move_to (sink, x, y);
+}
+
+static void
+path_data_sink_line_to (PathDataSink *sink,
+                        gboolean      is_rel,
+                        gdouble       x,
+                        gdouble       y)
+{
+        if (sink->cr) {
+                if (is_rel)
+                        cairo_rel_line_to (sink->cr, x, y);
+                else
+                        cairo_line_to (sink->cr, x, y);
+        }
+
+        if (!sink->bounds)
+                return;
+
+        if (is_rel) {
+                x += sink->current_x;
+                y += sink->current_y;
+        }
+        path_data_sink_track_line_to (sink, x, y);
+}
+
+static void
+path_data_sink_curve_to (PathDataSink *sink,
+                         gboolean      is_rel,
+                         gdouble       x1,
+                         gdouble       y1,
+                         gdouble       x2,
+                         gdouble       y2,
+                         gdouble       x3,
+                         gdouble       y3)
+{
+        if (sink->cr) {
+                if (is_rel)
+                        cairo_rel_curve_to (sink->cr, x1, y1, x2, y2, x3, y3);
+                else
+                        cairo_curve_to (sink->cr, x1, y1, x2, y2, x3, y3);
+        }
+
+        if (!sink->bounds)
+                return;
+
+        if (is_rel) {
+                x1 += sink->current_x;
+                y1 += sink->current_y;
+                x2 += sink->current_x;
+                y2 += sink->current_y;
+                x3 += sink->current_x;
+                y3 += sink->current_y;
+        }
+        path_data_sink_track_curve_to (sink, x1, y1, x2, y2, x3, y3);
+}
+
+static void
+path_data_sink_close_path (PathDataSink *sink)
+{
+        if (sink->cr)
+                cairo_close_path (sink->cr);
+
+        if (!sink->bounds || !sink->has_current_point)
+                return;
+
+        path_data_sink_track_line_to (sink, sink->start_x, sink->start_y);
+}
+
+static gboolean
+path_data_parse (const gchar  *data,
+                 PathDataSink *sink,
+                 GError      **error)
 {
         PathDataToken token;
         gdouble       control_point_x;
@@ -294,10 +576,7 @@ gxps_path_parse (const gchar *data,
 
                                 GXPS_DEBUG (g_message ("%s (%f, %f)", is_rel ? "rel_move_to" : "move_to", x, y));
 
-                                if (is_rel)
-                                        cairo_rel_move_to (cr, x, y);
-                                else
-                                        cairo_move_to (cr, x, y);
+                                path_data_sink_move_to (sink, is_rel, x, y);
 
                                 if (!path_data_iter_next (&token, error))
                                         return FALSE;
@@ -316,10 +595,7 @@ gxps_path_parse (const gchar *data,
 
                                 GXPS_DEBUG (g_message ("%s (%f, %f)", is_rel ? "rel_line_to" : "line_to", x, y));
 
-                                if (is_rel)
-                                        cairo_rel_line_to (cr, x, y);
-                                else
-                                        cairo_line_to (cr, x, y);
+                                path_data_sink_line_to (sink, is_rel, x, y);
 
                                 if (!path_data_iter_next (&token, error))
                                         return FALSE;
@@ -338,9 +614,9 @@ gxps_path_parse (const gchar *data,
 
                                 GXPS_DEBUG (g_message ("%s (%f)", is_rel ? "rel_hline_to" : "hline_to", offset));
 
-                                cairo_get_current_point (cr, &x, &y);
+                                path_data_sink_get_current_point (sink, &x, &y);
                                 x = is_rel ? x + offset : offset;
-                                cairo_line_to (cr, x, y);
+                                path_data_sink_line_to (sink, FALSE, x, y);
 
                                 if (!path_data_iter_next (&token, error))
                                         return FALSE;
@@ -359,9 +635,9 @@ gxps_path_parse (const gchar *data,
 
                                 GXPS_DEBUG (g_message ("%s (%f)", is_rel ? "rel_vline_to" : "vline_to", offset));
 
-                                cairo_get_current_point (cr, &x, &y);
+                                path_data_sink_get_current_point (sink, &x, &y);
                                 y = is_rel ? y + offset : offset;
-                                cairo_line_to (cr, x, y);
+                                path_data_sink_line_to (sink, FALSE, x, y);
 
                                 if (!path_data_iter_next (&token, error))
                                         return FALSE;
@@ -391,10 +667,7 @@ gxps_path_parse (const gchar *data,
                                 GXPS_DEBUG (g_message ("%s (%f, %f, %f, %f, %f, %f)", is_rel ? "rel_curve_to" : "curve_to",
                                               x1, y1, x2, y2, x3, y3));
 
-                                if (is_rel)
-                                        cairo_rel_curve_to (cr, x1, y1, x2, y2, x3, y3);
-                                else
-                                        cairo_curve_to (cr, x1, y1, x2, y2, x3, y3);
+                                path_data_sink_curve_to (sink, is_rel, x1, y1, x2, y2, x3, y3);
 
                                 control_point_x = x3 - x2;
                                 control_point_y = y3 - y2;
@@ -422,17 +695,17 @@ gxps_path_parse (const gchar *data,
                                 GXPS_DEBUG (g_message ("%s (%f, %f, %f, %f)", is_rel ? "rel_quad_curve_to" : "quad_curve_to",
                                               x1, y1, x2, y2));
 
-                                cairo_get_current_point (cr, &x, &y);
+                                path_data_sink_get_current_point (sink, &x, &y);
                                 x1 += is_rel ? x : 0;
                                 y1 += is_rel ? y : 0;
                                 x2 += is_rel ? x : 0;
                                 y2 += is_rel ? y : 0;
-                                cairo_curve_to (cr,
-                                                2.0 / 3.0 * x1 + 1.0 / 3.0 * x,
-                                                2.0 / 3.0 * y1 + 1.0 / 3.0 * y,
-                                                2.0 / 3.0 * x1 + 1.0 / 3.0 * x2,
-                                                2.0 / 3.0 * y1 + 1.0 / 3.0 * y2,
-                                                x2, y2);
+                                path_data_sink_curve_to (sink, FALSE,
+                                                         2.0 / 3.0 * x1 + 1.0 / 3.0 * x,
+                                                         2.0 / 3.0 * y1 + 1.0 / 3.0 * y,
+                                                         2.0 / 3.0 * x1 + 1.0 / 3.0 * x2,
+                                                         2.0 / 3.0 * y1 + 1.0 / 3.0 * y2,
+                                                         x2, y2);
 
                                 if (!path_data_iter_next (&token, error))
                                         return FALSE;
@@ -458,12 +731,12 @@ gxps_path_parse (const gchar *data,
                                                        control_point_x, control_point_y, x2, y2, x3, y3));
 
                                 if (is_rel) {
-                                        cairo_rel_curve_to (cr, control_point_x, control_point_y, x2, y2, x3, y3);
+                                        path_data_sink_curve_to (sink, TRUE, control_point_x, control_point_y, x2, y2, x3, y3);
                                 } else {
                                         gdouble x, y;
 
-                                        cairo_get_current_point (cr, &x, &y);
-                                        cairo_curve_to (cr, x + control_point_x, y + control_point_y, x2, y2, x3, y3);
+                                        path_data_sink_get_current_point (sink, &x, &y);
+                                        path_data_sink_curve_to (sink, FALSE, x + control_point_x, y + control_point_y, x2, y2, x3, y3);
                                 }
 
                                 control_point_x = x3 - x2;
@@ -537,7 +810,7 @@ gxps_path_parse (const gchar *data,
                 case 'z':
                         is_rel = TRUE;
                 case 'Z':
-                        cairo_close_path (cr);
+                        path_data_sink_close_path (sink);
                         GXPS_DEBUG (g_message ("close_path"));
                         control_point_x = control_point_y = 0;
                         break;
@@ -546,10 +819,12 @@ gxps_path_parse (const gchar *data,
                         gint fill_rule;
 
                         fill_rule = (gint)token.number;
-                        cairo_set_fill_rule (cr,
-                                             (fill_rule == 0) ?
-                                             CAIRO_FILL_RULE_EVEN_ODD :
-                                             CAIRO_FILL_RULE_WINDING);
+                        if (sink->cr) {
+                                cairo_set_fill_rule (sink->cr,
+                                                     (fill_rule == 0) ?
+                                                     CAIRO_FILL_RULE_EVEN_ODD :
+                                                     CAIRO_FILL_RULE_WINDING);
+                        }
                         GXPS_DEBUG (g_message ("set_fill_rule (%s)", (fill_rule == 0) ? "EVEN_ODD" : "WINDING"));
 
                         if (!path_data_iter_next (&token, error))
@@ -565,6 +840,113 @@ gxps_path_parse (const gchar *data,
         return TRUE;
 }
 
+gboolean
+gxps_path_parse (const gchar *data,
+                 cairo_t     *cr,
+                 GError     **error)
+{
+        PathDataSink sink = { 0, };
+
+        sink.cr = cr;
+
+        return path_data_parse (data, &sink, error);
+}
+
+/* Builds the path in @cr like gxps_path_parse(), and also adds its
+ * bounds in user space to @bounds.
+ */
+gboolean
+gxps_path_parse_with_bounds (const gchar    *data,
+                             cairo_t        *cr,
+                             GXPSPathBounds *bounds,
+                             GError        **error)
+{
+        PathDataSink sink = { 0, };
+
+        sink.cr = cr;
+        sink.bounds = bounds;
+
+        return path_data_parse (data, &sink, error);
+}
+
+/* Adds the bounds of the path to @bounds without building it. The points
+ * are transformed by @matrix, or used as they are when it's %NULL. Like
+ * cairo_path_extents(), the bounds don't include the stroke.
+ */
+gboolean
+gxps_path_get_bounds (const gchar          *data,
+                      const cairo_matrix_t *matrix,
+                      GXPSPathBounds       *bounds,
+                      GError              **error)
+{
+        PathDataSink sink = { 0, };
+
+        sink.matrix = matrix;
+        sink.bounds = bounds;
+
+        return path_data_parse (data, &sink, error);
+}
+
+void
+gxps_path_bounds_init (GXPSPathBounds *bounds)
+{
+        bounds->x1 = bounds->y1 = 0;
+        bounds->x2 = bounds->y2 = 0;
+        bounds->is_empty = TRUE;
+}
+
+void
+gxps_path_bounds_get_rectangle (const GXPSPathBounds *bounds,
+                                cairo_rectangle_t    *rect)
+{
+        rect->x = bounds->x1;
+        rect->y = bounds->y1;
+        rect->width = bounds->x2 - bounds->x1;
+        rect->height = bounds->y2 - bounds->y1;
+}
+
+void
+gxps_path_fill (cairo_t         *cr,
+                cairo_pattern_t *pattern,
+                gdouble          opacity,
+                gboolean         preserve)
+{
+        cairo_pattern_t *faded;
+
+        opacity *= gxps_brush_pattern_get_opacity (pattern);
+        if (opacity == 1.0) {
+                cairo_set_source (cr, pattern);
+                if (preserve)
+                        cairo_fill_preserve (cr);
+                else
+                        cairo_fill (cr);
+                return;
+        }
+
+        faded = gxps_brush_pattern_fold_opacity (pattern, opacity);
+        if (faded) {
+                cairo_set_source (cr, faded);
+                cairo_pattern_destroy (faded);
+                if (preserve)
+                        cairo_fill_preserve (cr);
+                else
+                        cairo_fill (cr);
+                return;
+        }
+
+        /* A fill never overlaps itself, so instead of compositing the
+         * surface through a group, clip to the path and paint it with
+         * alpha directly on the target.
+         */
+        cairo_save (cr);
+        cairo_clip_preserve (cr);
+        cairo_set_source (cr, pattern);
+        cairo_paint_with_alpha (cr, opacity);
+        cairo_restore (cr);
+        if (!preserve)
+                cairo_new_path (cr);
+}
+
 static gboolean
 gxps_points_parse (const gchar *points,
                    gdouble    **coords,
@@ -629,6 +1011,8 @@ path_geometry_start_element (GMarkupParseContext  *context,
 		gint     i;
                 gboolean has_start_point = FALSE;
 
+		gxps_archive_stats_add_element (path->ctx->page->priv->zip, GXPS_STATS_ELEMENT_PATH_FIGURE);
+
 		for (i = 0; names[i] != NULL; i++) {
 			if (strcmp (names[i], "StartPoint") == 0) {
 				gdouble x, y;
@@ -901,17 +1285,15 @@ path_geometry_end_element (GMarkupParseContext  *context,
 			cairo_rectangle (path->ctx->cr, x1, y1, x2 - x1, y2 - y1);
 			cairo_clip (path->ctx->cr);
 			cairo_push_group (path->ctx->cr);
+			GXPS_STATS_ADD (path->ctx->page->priv->zip, PUSH_GROUPS, 1);
 			cairo_append_path (path->ctx->cr, cairo_path);
 			cairo_path_destroy (cairo_path);
 		}
 
 		if (path->is_filled && path->fill_pattern) {
 			GXPS_DEBUG (g_message ("fill"));
-			cairo_set_source (path->ctx->cr, path->fill_pattern);
-			if (path->is_stroked && path->stroke_pattern)
-				cairo_fill_preserve (path->ctx->cr);
-			else
-				cairo_fill (path->ctx->cr);
+			gxps_path_fill (path->ctx->cr, path->fill_pattern, 1.0,
+					path->is_stroked && path->stroke_pattern);
 		}
 
 		if (path->stroke_pattern) {
@@ -994,6 +1376,15 @@ path_start_element (GMarkupParseContext  *context,
 		}
 
 		if (!path->data) {
+			/* Every figure is painted as soon as it's parsed, so
+			 * they have to be composited together before applying
+			 * the opacity.
+			 */
+			if (path->opacity != 1.0 && !path->has_group) {
+				cairo_push_group (path->ctx->cr);
+				GXPS_STATS_ADD (path->ctx->page->priv->zip, PUSH_GROUPS, 1);
+				path->has_group = TRUE;
+			}
 			cairo_set_fill_rule (path->ctx->cr, path->fill_rule);
 			if (path->clip_data) {
 				if (!gxps_path_parse (path->clip_data, path->ctx->cr, error))
@@ -1036,7 +1427,7 @@ path_end_element (GMarkupParseContext  *context,
 		GXPSBrush *brush;
 
 		brush = g_markup_parse_context_pop (context);
-		path->stroke_pattern = cairo_pattern_reference (brush->pattern);
+		path->stroke_pattern = gxps_brush_pattern_realize (brush->pattern, path->ctx);
 		gxps_brush_free (brush);
 	} else if (strcmp (element_name, "Path.Data") == 0) {
 	} else if (strcmp (element_name, "PathGeometry") == 0) {
@@ -1058,7 +1449,7 @@ path_end_element (GMarkupParseContext  *context,
 
 		brush = g_markup_parse_context_pop (context);
 		if (!path->opacity_mask)
-			path->opacity_mask = cairo_pattern_reference (brush->pattern);
+			path->opacity_mask = gxps_brush_pattern_realize (brush->pattern, path->ctx);
 		gxps_brush_free (brush);
 	} else {
 
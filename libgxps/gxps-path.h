@@ -45,20 +45,52 @@ struct _GXPSPath {
         gdouble            opacity;
         cairo_pattern_t   *opacity_mask;
 
+        /* Only set when collecting links while rendering */
+        gchar             *link_uri;
+        gchar             *name;
+
         gboolean           is_stroked : 1;
         gboolean           is_filled  : 1;
         gboolean           is_closed  : 1;
+        gboolean           has_group  : 1;
 };
 
+/* Bounding box of path data computed without cairo */
+typedef struct {
+        gdouble  x1;
+        gdouble  y1;
+        gdouble  x2;
+        gdouble  y2;
+        gboolean is_empty;
+} GXPSPathBounds;
+
 GXPSPath *gxps_path_new         (GXPSRenderContext   *ctx);
 void      gxps_path_free        (GXPSPath            *path);
 gboolean  gxps_path_parse       (const gchar         *data,
                                  cairo_t             *cr,
                                  GError             **error);
+gboolean  gxps_path_parse_with_bounds
+                                (const gchar         *data,
+                                 cairo_t             *cr,
+                                 GXPSPathBounds      *bounds,
+                                 GError             **error);
+gboolean  gxps_path_get_bounds  (const gchar         *data,
+                                 const cairo_matrix_t *matrix,
+                                 GXPSPathBounds      *bounds,
+                                 GError             **error);
+void      gxps_path_fill        (cairo_t             *cr,
+                                 cairo_pattern_t     *pattern,
+                                 gdouble              opacity,
+                                 gboolean             preserve);
 
 void      gxps_path_parser_push (GMarkupParseContext *context,
                                  GXPSPath            *path);
 
+void      gxps_path_bounds_init (GXPSPathBounds      *bounds);
+void      gxps_path_bounds_get_rectangle
+                                (const GXPSPathBounds *bounds,
+                                 cairo_rectangle_t   *rect);
+
 G_END_DECLS
 
 #endif /* __GXPS_PATH_H__ */
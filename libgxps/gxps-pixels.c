@@ -0,0 +1,865 @@
+/* GXPSPixels
+ *
+ * Copyright (C) 2026  libgxps contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <config.h>
+
+#include "gxps-pixels.h"
+
+#ifdef HAVE_X86_SIMD
+#include <immintrin.h>
+
+#define GXPS_TARGET(isa) __attribute__ ((target (isa)))
+#endif
+
+typedef struct {
+	const gchar *name;
+
+	void (* premultiply_rgba)   (guint32 *dst, const guint8 *src, gsize n_pixels);
+	void (* rgbx_to_xrgb)       (guint32 *dst, const guint8 *src, gsize n_pixels);
+	void (* rgb_to_xrgb)        (guint32 *dst, const guint8 *src, gsize n_pixels);
+	void (* gray_to_xrgb)       (guint32 *dst, const guint8 *src, gsize n_pixels);
+	void (* cmyk_to_xrgb)       (guint32 *dst, const guint8 *src, gsize n_pixels);
+	void (* abgr_to_argb)       (guint32 *dst, const guint32 *src, gsize n_pixels);
+	void (* unpremultiply_rgba) (guint8 *dst, const guint32 *src, gsize n_pixels);
+	void (* xrgb_to_rgbx)       (guint8 *dst, const guint32 *src, gsize n_pixels);
+} GXPSPixelsKernels;
+
+/* Scalar implementations, they work on any architecture and
+ * are used by the vector ones for the trailing pixels.
+ */
+
+/* From cairo's cairo-png.c <http://cairographics.org> */
+static inline guint
+multiply_alpha (guint alpha,
+		guint color)
+{
+	guint temp = (alpha * color) + 0x80;
+
+	return ((temp + (temp >> 8)) >> 8);
+}
+
+/* Same as x / 255 for x <= 255 * 255 */
+static inline guint
+divide_255 (guint x)
+{
+	return (x + 1 + (x >> 8)) >> 8;
+}
+
+static void
+premultiply_rgba_scalar (guint32      *dst,
+			 const guint8 *src,
+			 gsize         n_pixels)
+{
+	gsize i;
+
+	for (i = 0; i < n_pixels; i++, src += 4) {
+		guint8  alpha = src[3];
+		guint32 pixel;
+
+		if (alpha == 0) {
+			pixel = 0;
+		} else {
+			guint8 red   = src[0];
+			guint8 green = src[1];
+			guint8 blue  = src[2];
+
+			if (alpha != 0xff) {
+				red   = multiply_alpha (alpha, red);
+				green = multiply_alpha (alpha, green);
+				blue  = multiply_alpha (alpha, blue);
+			}
+			pixel = ((guint32)alpha << 24) | (red << 16) | (green << 8) | (blue << 0);
+		}
+		dst[i] = pixel;
+	}
+}
+
+static void
+rgbx_to_xrgb_scalar (guint32      *dst,
+		     const guint8 *src,
+		     gsize         n_pixels)
+{
+	gsize i;
+
+	for (i = 0; i < n_pixels; i++, src += 4)
+		dst[i] = 0xff000000 | (src[0] << 16) | (src[1] << 8) | (src[2] << 0);
+}
+
+static void
+rgb_to_xrgb_scalar (guint32      *dst,
+		    const guint8 *src,
+		    gsize         n_pixels)
+{
+	gsize i;
+
+	for (i = 0; i < n_pixels; i++, src += 3)
+		dst[i] = 0xff000000 | (src[0] << 16) | (src[1] << 8) | (src[2] << 0);
+}
+
+static void
+gray_to_xrgb_scalar (guint32      *dst,
+		     const guint8 *src,
+		     gsize         n_pixels)
+{
+	gsize i;
+
+	for (i = 0; i < n_pixels; i++)
+		dst[i] = 0xff000000 | (src[i] * 0x010101);
+}
+
+/* The CMYK samples are expected inverted, as written by Adobe
+ * applications, so every channel is just scaled by the black one.
+ */
+static void
+cmyk_to_xrgb_scalar (guint32      *dst,
+		     const guint8 *src,
+		     gsize         n_pixels)
+{
+	gsize i;
+
+	for (i = 0; i < n_pixels; i++, src += 4) {
+		guint k = src[3];
+
+		dst[i] = 0xff000000 |
+			(divide_255 (src[0] * k) << 16) |
+			(divide_255 (src[1] * k) << 8) |
+			(divide_255 (src[2] * k) << 0);
+	}
+}
+
+static void
+abgr_to_argb_scalar (guint32       *dst,
+		     const guint32 *src,
+		     gsize          n_pixels)
+{
+	gsize i;
+
+	for (i = 0; i < n_pixels; i++) {
+		guint32 pixel = src[i];
+
+		dst[i] = (pixel & 0xff00ff00) | ((pixel >> 16) & 0xff) | ((pixel & 0xff) << 16);
+	}
+}
+
+static void
+unpremultiply_rgba_scalar (guint8        *dst,
+			   const guint32 *src,
+			   gsize          n_pixels)
+{
+	gsize i;
+
+	for (i = 0; i < n_pixels; i++, dst += 4) {
+		guint32 pixel = src[i];
+		guint8  alpha = pixel >> 24;
+
+		if (alpha == 0) {
+			dst[0] = dst[1] = dst[2] = dst[3] = 0;
+		} else {
+			dst[0] = (((pixel & 0xff0000) >> 16) * 255 + alpha / 2) / alpha;
+			dst[1] = (((pixel & 0x00ff00) >>  8) * 255 + alpha / 2) / alpha;
+			dst[2] = (((pixel & 0x0000ff) >>  0) * 255 + alpha / 2) / alpha;
+			dst[3] = alpha;
+		}
+	}
+}
+
+static void
+xrgb_to_rgbx_scalar (guint8        *dst,
+		     const guint32 *src,
+		     gsize          n_pixels)
+{
+	gsize i;
+
+	for (i = 0; i < n_pixels; i++, dst += 4) {
+		guint32 pixel = src[i];
+
+		dst[0] = (pixel & 0xff0000) >> 16;
+		dst[1] = (pixel & 0x00ff00) >>  8;
+		dst[2] = (pixel & 0x0000ff) >>  0;
+		dst[3] = 0;
+	}
+}
+
+static const GXPSPixelsKernels scalar_kernels = {
+	"scalar",
+	premultiply_rgba_scalar,
+	rgbx_to_xrgb_scalar,
+	rgb_to_xrgb_scalar,
+	gray_to_xrgb_scalar,
+	cmyk_to_xrgb_scalar,
+	abgr_to_argb_scalar,
+	unpremultiply_rgba_scalar,
+	xrgb_to_rgbx_scalar
+};
+
+#ifdef HAVE_X86_SIMD
+/* The vector implementations only exist for x86, which is little
+ * endian, so native endian xRGB pixels are BGRx bytes in memory.
+ */
+
+/* SSE2 */
+GXPS_TARGET ("sse2") static inline __m128i
+swap_red_blue_sse2 (__m128i v)
+{
+	const __m128i mask = _mm_set1_epi32 (0xff);
+	__m128i       ag = _mm_andnot_si128 (_mm_or_si128 (mask, _mm_slli_epi32 (mask, 16)), v);
+	__m128i       r = _mm_and_si128 (_mm_srli_epi32 (v, 16), mask);
+	__m128i       b = _mm_slli_epi32 (_mm_and_si128 (v, mask), 16);
+
+	return _mm_or_si128 (ag, _mm_or_si128 (r, b));
+}
+
+/* Premultiplies two RGBA pixels unpacked to 16 bit channels
+ * and reorders the channels as BGRA.
+ */
+GXPS_TARGET ("sse2") static inline __m128i
+premultiply_2_sse2 (__m128i p)
+{
+	const __m128i alpha_mask = _mm_set1_epi64x ((gint64) G_GINT64_CONSTANT (0xffff000000000000));
+	const __m128i alpha_one = _mm_set1_epi64x ((gint64) G_GINT64_CONSTANT (0x00ff000000000000));
+	__m128i       a, t;
+
+	a = _mm_shufflelo_epi16 (p, _MM_SHUFFLE (3, 3, 3, 3));
+	a = _mm_shufflehi_epi16 (a, _MM_SHUFFLE (3, 3, 3, 3));
+	a = _mm_or_si128 (_mm_andnot_si128 (alpha_mask, a), alpha_one);
+
+	t = _mm_add_epi16 (_mm_mullo_epi16 (p, a), _mm_set1_epi16 (0x80));
+	t = _mm_srli_epi16 (_mm_add_epi16 (t, _mm_srli_epi16 (t, 8)), 8);
+
+	t = _mm_shufflelo_epi16 (t, _MM_SHUFFLE (3, 0, 1, 2));
+	return _mm_shufflehi_epi16 (t, _MM_SHUFFLE (3, 0, 1, 2));
+}
+
+/* Scales the CMY channels of two CMYK pixels unpacked to 16 bit
+ * channels by K and reorders the channels as YMCK.
+ */
+GXPS_TARGET ("sse2") static inline __m128i
+cmyk_2_sse2 (__m128i p)
+{
+	__m128i k, t;
+
+	k = _mm_shufflelo_epi16 (p, _MM_SHUFFLE (3, 3, 3, 3));
+	k = _mm_shufflehi_epi16 (k, _MM_SHUFFLE (3, 3, 3, 3));
+
+	t = _mm_mullo_epi16 (p, k);
+	t = _mm_add_epi16 (_mm_add_epi16 (t, _mm_set1_epi16 (1)), _mm_srli_epi16 (t, 8));
+	t = _mm_srli_epi16 (t, 8);
+
+	t = _mm_shufflelo_epi16 (t, _MM_SHUFFLE (3, 0, 1, 2));
+	return _mm_shufflehi_epi16 (t, _MM_SHUFFLE (3, 0, 1, 2));
+}
+
+GXPS_TARGET ("sse2") static void
+premultiply_rgba_sse2 (guint32      *dst,
+		       const guint8 *src,
+		       gsize         n_pixels)
+{
+	const __m128i zero = _mm_setzero_si128 ();
+	gsize         i;
+
+	for (i = 0; i + 4 <= n_pixels; i += 4) {
+		__m128i v = _mm_loadu_si128 ((const __m128i *)(src + i * 4));
+		__m128i lo = premultiply_2_sse2 (_mm_unpacklo_epi8 (v, zero));
+		__m128i hi = premultiply_2_sse2 (_mm_unpackhi_epi8 (v, zero));
+
+		_mm_storeu_si128 ((__m128i *)(dst + i), _mm_packus_epi16 (lo, hi));
+	}
+
+	premultiply_rgba_scalar (dst + i, src + i * 4, n_pixels - i);
+}
+
+GXPS_TARGET ("sse2") static void
+rgbx_to_xrgb_sse2 (guint32      *dst,
+		   const guint8 *src,
+		   gsize         n_pixels)
+{
+	const __m128i alpha = _mm_set1_epi32 ((gint) 0xff000000);
+	gsize         i;
+
+	for (i = 0; i + 4 <= n_pixels; i += 4) {
+		__m128i v = _mm_loadu_si128 ((const __m128i *)(src + i * 4));
+
+		_mm_storeu_si128 ((__m128i *)(dst + i), _mm_or_si128 (swap_red_blue_sse2 (v), alpha));
+	}
+
+	rgbx_to_xrgb_scalar (dst + i, src + i * 4, n_pixels - i);
+}
+
+GXPS_TARGET ("sse2") static void
+gray_to_xrgb_sse2 (guint32      *dst,
+		   const guint8 *src,
+		   gsize         n_pixels)
+{
+	const __m128i alpha = _mm_set1_epi32 ((gint) 0xff000000);
+	gsize         i;
+
+	for (i = 0; i + 16 <= n_pixels; i += 16) {
+		__m128i v = _mm_loadu_si128 ((const __m128i *)(src + i));
+		__m128i lo = _mm_unpacklo_epi8 (v, v);
+		__m128i hi = _mm_unpackhi_epi8 (v, v);
+
+		_mm_storeu_si128 ((__m128i *)(dst + i), _mm_or_si128 (_mm_unpacklo_epi16 (lo, lo), alpha));
+		_mm_storeu_si128 ((__m128i *)(dst + i + 4), _mm_or_si128 (_mm_unpackhi_epi16 (lo, lo), alpha));
+		_mm_storeu_si128 ((__m128i *)(dst + i + 8), _mm_or_si128 (_mm_unpacklo_epi16 (hi, hi), alpha));
+		_mm_storeu_si128 ((__m128i *)(dst + i + 12), _mm_or_si128 (_mm_unpackhi_epi16 (hi, hi), alpha));
+	}
+
+	gray_to_xrgb_scalar (dst + i, src + i, n_pixels - i);
+}
+
+GXPS_TARGET ("sse2") static void
+cmyk_to_xrgb_sse2 (guint32      *dst,
+		   const guint8 *src,
+		   gsize         n_pixels)
+{
+	const __m128i zero = _mm_setzero_si128 ();
+	const __m128i alpha = _mm_set1_epi32 ((gint) 0xff000000);
+	gsize         i;
+
+	for (i = 0; i + 4 <= n_pixels; i += 4) {
+		__m128i v = _mm_loadu_si128 ((const __m128i *)(src + i * 4));
+		__m128i lo = cmyk_2_sse2 (_mm_unpacklo_epi8 (v, zero));
+		__m128i hi = cmyk_2_sse2 (_mm_unpackhi_epi8 (v, zero));
+
+		_mm_storeu_si128 ((__m128i *)(dst + i), _mm_or_si128 (_mm_packus_epi16 (lo, hi), alpha));
+	}
+
+	cmyk_to_xrgb_scalar (dst + i, src + i * 4, n_pixels - i);
+}
+
+GXPS_TARGET ("sse2") static void
+abgr_to_argb_sse2 (guint32       *dst,
+		   const guint32 *src,
+		   gsize          n_pixels)
+{
+	gsize i;
+
+	for (i = 0; i + 4 <= n_pixels; i += 4) {
+		__m128i v = _mm_loadu_si128 ((const __m128i *)(src + i));
+
+		_mm_storeu_si128 ((__m128i *)(dst + i), swap_red_blue_sse2 (v));
+	}
+
+	abgr_to_argb_scalar (dst + i, src + i, n_pixels - i);
+}
+
+/* Only fully opaque and fully transparent pixels are vectorized,
+ * the others need a division per channel.
+ */
+GXPS_TARGET ("sse2") static void
+unpremultiply_rgba_sse2 (guint8        *dst,
+			 const guint32 *src,
+			 gsize          n_pixels)
+{
+	const __m128i alpha = _mm_set1_epi32 ((gint) 0xff000000);
+	const __m128i zero = _mm_setzero_si128 ();
+	gsize         i;
+
+	for (i = 0; i + 4 <= n_pixels; i += 4) {
+		__m128i v = _mm_loadu_si128 ((const __m128i *)(src + i));
+		__m128i a = _mm_and_si128 (v, alpha);
+
+		if (_mm_movemask_epi8 (_mm_cmpeq_epi32 (a, alpha)) == 0xffff)
+			_mm_storeu_si128 ((__m128i *)(dst + i * 4), swap_red_blue_sse2 (v));
+		else if (_mm_movemask_epi8 (_mm_cmpeq_epi32 (a, zero)) == 0xffff)
+			_mm_storeu_si128 ((__m128i *)(dst + i * 4), zero);
+		else
+			unpremultiply_rgba_scalar (dst + i * 4, src + i, 4);
+	}
+
+	unpremultiply_rgba_scalar (dst + i * 4, src + i, n_pixels - i);
+}
+
+GXPS_TARGET ("sse2") static void
+xrgb_to_rgbx_sse2 (guint8        *dst,
+		   const guint32 *src,
+		   gsize          n_pixels)
+{
+	const __m128i rgb = _mm_set1_epi32 (0x00ffffff);
+	gsize         i;
+
+	for (i = 0; i + 4 <= n_pixels; i += 4) {
+		__m128i v = _mm_loadu_si128 ((const __m128i *)(src + i));
+
+		_mm_storeu_si128 ((__m128i *)(dst + i * 4), _mm_and_si128 (swap_red_blue_sse2 (v), rgb));
+	}
+
+	xrgb_to_rgbx_scalar (dst + i * 4, src + i, n_pixels - i);
+}
+
+static const GXPSPixelsKernels sse2_kernels = {
+	"sse2",
+	premultiply_rgba_sse2,
+	rgbx_to_xrgb_sse2,
+	rgb_to_xrgb_scalar,
+	gray_to_xrgb_sse2,
+	cmyk_to_xrgb_sse2,
+	abgr_to_argb_sse2,
+	unpremultiply_rgba_sse2,
+	xrgb_to_rgbx_sse2
+};
+
+/* SSSE3: byte shuffles for the swizzles */
+#define SHUFFLE_SWAP_RED_BLUE       2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15
+#define SHUFFLE_SWAP_RED_BLUE_NO_X  2, 1, 0, -1, 6, 5, 4, -1, 10, 9, 8, -1, 14, 13, 12, -1
+#define SHUFFLE_RGB_TO_BGRX         2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1
+
+GXPS_TARGET ("ssse3") static void
+rgbx_to_xrgb_ssse3 (guint32      *dst,
+		    const guint8 *src,
+		    gsize         n_pixels)
+{
+	const __m128i shuffle = _mm_setr_epi8 (SHUFFLE_SWAP_RED_BLUE_NO_X);
+	const __m128i alpha = _mm_set1_epi32 ((gint) 0xff000000);
+	gsize         i;
+
+	for (i = 0; i + 4 <= n_pixels; i += 4) {
+		__m128i v = _mm_loadu_si128 ((const __m128i *)(src + i * 4));
+
+		_mm_storeu_si128 ((__m128i *)(dst + i), _mm_or_si128 (_mm_shuffle_epi8 (v, shuffle), alpha));
+	}
+
+	rgbx_to_xrgb_scalar (dst + i, src + i * 4, n_pixels - i);
+}
+
+GXPS_TARGET ("ssse3") static void
+rgb_to_xrgb_ssse3 (guint32      *dst,
+		   const guint8 *src,
+		   gsize         n_pixels)
+{
+	const __m128i shuffle = _mm_setr_epi8 (SHUFFLE_RGB_TO_BGRX);
+	const __m128i alpha = _mm_set1_epi32 ((gint) 0xff000000);
+	gsize         i;
+
+	/* Every iteration consumes 12 bytes but loads 16 */
+	for (i = 0; i + 6 <= n_pixels; i += 4) {
+		__m128i v = _mm_loadu_si128 ((const __m128i *)(src + i * 3));
+
+		_mm_storeu_si128 ((__m128i *)(dst + i), _mm_or_si128 (_mm_shuffle_epi8 (v, shuffle), alpha));
+	}
+
+	rgb_to_xrgb_scalar (dst + i, src + i * 3, n_pixels - i);
+}
+
+GXPS_TARGET ("ssse3") static void
+abgr_to_argb_ssse3 (guint32       *dst,
+		    const guint32 *src,
+		    gsize          n_pixels)
+{
+	const __m128i shuffle = _mm_setr_epi8 (SHUFFLE_SWAP_RED_BLUE);
+	gsize         i;
+
+	for (i = 0; i + 4 <= n_pixels; i += 4) {
+		__m128i v = _mm_loadu_si128 ((const __m128i *)(src + i));
+
+		_mm_storeu_si128 ((__m128i *)(dst + i), _mm_shuffle_epi8 (v, shuffle));
+	}
+
+	abgr_to_argb_scalar (dst + i, src + i, n_pixels - i);
+}
+
+GXPS_TARGET ("ssse3") static void
+unpremultiply_rgba_ssse3 (guint8        *dst,
+			  const guint32 *src,
+			  gsize          n_pixels)
+{
+	const __m128i shuffle = _mm_setr_epi8 (SHUFFLE_SWAP_RED_BLUE);
+	const __m128i alpha = _mm_set1_epi32 ((gint) 0xff000000);
+	const __m128i zero = _mm_setzero_si128 ();
+	gsize         i;
+
+	for (i = 0; i + 4 <= n_pixels; i += 4) {
+		__m128i v = _mm_loadu_si128 ((const __m128i *)(src + i));
+		__m128i a = _mm_and_si128 (v, alpha);
+
+		if (_mm_movemask_epi8 (_mm_cmpeq_epi32 (a, alpha)) == 0xffff)
+			_mm_storeu_si128 ((__m128i *)(dst + i * 4), _mm_shuffle_epi8 (v, shuffle));
+		else if (_mm_movemask_epi8 (_mm_cmpeq_epi32 (a, zero)) == 0xffff)
+			_mm_storeu_si128 ((__m128i *)(dst + i * 4), zero);
+		else
+			unpremultiply_rgba_scalar (dst + i * 4, src + i, 4);
+	}
+
+	unpremultiply_rgba_scalar (dst + i * 4, src + i, n_pixels - i);
+}
+
+GXPS_TARGET ("ssse3") static void
+xrgb_to_rgbx_ssse3 (guint8        *dst,
+		    const guint32 *src,
+		    gsize          n_pixels)
+{
+	const __m128i shuffle = _mm_setr_epi8 (SHUFFLE_SWAP_RED_BLUE_NO_X);
+	gsize         i;
+
+	for (i = 0; i + 4 <= n_pixels; i += 4) {
+		__m128i v = _mm_loadu_si128 ((const __m128i *)(src + i));
+
+		_mm_storeu_si128 ((__m128i *)(dst + i * 4), _mm_shuffle_epi8 (v, shuffle));
+	}
+
+	xrgb_to_rgbx_scalar (dst + i * 4, src + i, n_pixels - i);
+}
+
+static const GXPSPixelsKernels ssse3_kernels = {
+	"ssse3",
+	premultiply_rgba_sse2,
+	rgbx_to_xrgb_ssse3,
+	rgb_to_xrgb_ssse3,
+	gray_to_xrgb_sse2,
+	cmyk_to_xrgb_sse2,
+	abgr_to_argb_ssse3,
+	unpremultiply_rgba_ssse3,
+	xrgb_to_rgbx_ssse3
+};
+
+/* AVX2: same algorithms on eight pixels at a time. Unpacking, packing
+ * and shuffling work within 128 bit lanes, so pixels never cross them.
+ */
+GXPS_TARGET ("avx2") static inline __m256i
+premultiply_4_avx2 (__m256i p)
+{
+	const __m256i alpha_mask = _mm256_set1_epi64x ((gint64) G_GINT64_CONSTANT (0xffff000000000000));
+	const __m256i alpha_one = _mm256_set1_epi64x ((gint64) G_GINT64_CONSTANT (0x00ff000000000000));
+	__m256i       a, t;
+
+	a = _mm256_shufflelo_epi16 (p, _MM_SHUFFLE (3, 3, 3, 3));
+	a = _mm256_shufflehi_epi16 (a, _MM_SHUFFLE (3, 3, 3, 3));
+	a = _mm256_or_si256 (_mm256_andnot_si256 (alpha_mask, a), alpha_one);
+
+	t = _mm256_add_epi16 (_mm256_mullo_epi16 (p, a), _mm256_set1_epi16 (0x80));
+	t = _mm256_srli_epi16 (_mm256_add_epi16 (t, _mm256_srli_epi16 (t, 8)), 8);
+
+	t = _mm256_shufflelo_epi16 (t, _MM_SHUFFLE (3, 0, 1, 2));
+	return _mm256_shufflehi_epi16 (t, _MM_SHUFFLE (3, 0, 1, 2));
+}
+
+GXPS_TARGET ("avx2") static inline __m256i
+cmyk_4_avx2 (__m256i p)
+{
+	__m256i k, t;
+
+	k = _mm256_shufflelo_epi16 (p, _MM_SHUFFLE (3, 3, 3, 3));
+	k = _mm256_shufflehi_epi16 (k, _MM_SHUFFLE (3, 3, 3, 3));
+
+	t = _mm256_mullo_epi16 (p, k);
+	t = _mm256_add_epi16 (_mm256_add_epi16 (t, _mm256_set1_epi16 (1)), _mm256_srli_epi16 (t, 8));
+	t = _mm256_srli_epi16 (t, 8);
+
+	t = _mm256_shufflelo_epi16 (t, _MM_SHUFFLE (3, 0, 1, 2));
+	return _mm256_shufflehi_epi16 (t, _MM_SHUFFLE (3, 0, 1, 2));
+}
+
+GXPS_TARGET ("avx2") static void
+premultiply_rgba_avx2 (guint32      *dst,
+		       const guint8 *src,
+		       gsize         n_pixels)
+{
+	const __m256i zero = _mm256_setzero_si256 ();
+	gsize         i;
+
+	for (i = 0; i + 8 <= n_pixels; i += 8) {
+		__m256i v = _mm256_loadu_si256 ((const __m256i *)(src + i * 4));
+		__m256i lo = premultiply_4_avx2 (_mm256_unpacklo_epi8 (v, zero));
+		__m256i hi = premultiply_4_avx2 (_mm256_unpackhi_epi8 (v, zero));
+
+		_mm256_storeu_si256 ((__m256i *)(dst + i), _mm256_packus_epi16 (lo, hi));
+	}
+
+	premultiply_rgba_sse2 (dst + i, src + i * 4, n_pixels - i);
+}
+
+GXPS_TARGET ("avx2") static void
+rgbx_to_xrgb_avx2 (guint32      *dst,
+		   const guint8 *src,
+		   gsize         n_pixels)
+{
+	const __m256i shuffle = _mm256_setr_epi8 (SHUFFLE_SWAP_RED_BLUE_NO_X, SHUFFLE_SWAP_RED_BLUE_NO_X);
+	const __m256i alpha = _mm256_set1_epi32 ((gint) 0xff000000);
+	gsize         i;
+
+	for (i = 0; i + 8 <= n_pixels; i += 8) {
+		__m256i v = _mm256_loadu_si256 ((const __m256i *)(src + i * 4));
+
+		_mm256_storeu_si256 ((__m256i *)(dst + i), _mm256_or_si256 (_mm256_shuffle_epi8 (v, shuffle), alpha));
+	}
+
+	rgbx_to_xrgb_ssse3 (dst + i, src + i * 4, n_pixels - i);
+}
+
+GXPS_TARGET ("avx2") static void
+rgb_to_xrgb_avx2 (guint32      *dst,
+		  const guint8 *src,
+		  gsize         n_pixels)
+{
+	const __m256i shuffle = _mm256_setr_epi8 (SHUFFLE_RGB_TO_BGRX, SHUFFLE_RGB_TO_BGRX);
+	const __m256i alpha = _mm256_set1_epi32 ((gint) 0xff000000);
+	gsize         i;
+
+	/* Every iteration consumes 24 bytes, loading 16 of them
+	 * into each lane, the last load ends 28 bytes after the start.
+	 */
+	for (i = 0; i + 10 <= n_pixels; i += 8) {
+		__m128i lo = _mm_loadu_si128 ((const __m128i *)(src + i * 3));
+		__m128i hi = _mm_loadu_si128 ((const __m128i *)(src + i * 3 + 12));
+		__m256i v = _mm256_inserti128_si256 (_mm256_castsi128_si256 (lo), hi, 1);
+
+		_mm256_storeu_si256 ((__m256i *)(dst + i), _mm256_or_si256 (_mm256_shuffle_epi8 (v, shuffle), alpha));
+	}
+
+	rgb_to_xrgb_ssse3 (dst + i, src + i * 3, n_pixels - i);
+}
+
+GXPS_TARGET ("avx2") static void
+cmyk_to_xrgb_avx2 (guint32      *dst,
+		   const guint8 *src,
+		   gsize         n_pixels)
+{
+	const __m256i zero = _mm256_setzero_si256 ();
+	const __m256i alpha = _mm256_set1_epi32 ((gint) 0xff000000);
+	gsize         i;
+
+	for (i = 0; i + 8 <= n_pixels; i += 8) {
+		__m256i v = _mm256_loadu_si256 ((const __m256i *)(src + i * 4));
+		__m256i lo = cmyk_4_avx2 (_mm256_unpacklo_epi8 (v, zero));
+		__m256i hi = cmyk_4_avx2 (_mm256_unpackhi_epi8 (v, zero));
+
+		_mm256_storeu_si256 ((__m256i *)(dst + i), _mm256_or_si256 (_mm256_packus_epi16 (lo, hi), alpha));
+	}
+
+	cmyk_to_xrgb_sse2 (dst + i, src + i * 4, n_pixels - i);
+}
+
+GXPS_TARGET ("avx2") static void
+abgr_to_argb_avx2 (guint32       *dst,
+		   const guint32 *src,
+		   gsize          n_pixels)
+{
+	const __m256i shuffle = _mm256_setr_epi8 (SHUFFLE_SWAP_RED_BLUE, SHUFFLE_SWAP_RED_BLUE);
+	gsize         i;
+
+	for (i = 0; i + 8 <= n_pixels; i += 8) {
+		__m256i v = _mm256_loadu_si256 ((const __m256i *)(src + i));
+
+		_mm256_storeu_si256 ((__m256i *)(dst + i), _mm256_shuffle_epi8 (v, shuffle));
+	}
+
+	abgr_to_argb_ssse3 (dst + i, src + i, n_pixels - i);
+}
+
+GXPS_TARGET ("avx2") static void
+unpremultiply_rgba_avx2 (guint8        *dst,
+			 const guint32 *src,
+			 gsize          n_pixels)
+{
+	const __m256i shuffle = _mm256_setr_epi8 (SHUFFLE_SWAP_RED_BLUE, SHUFFLE_SWAP_RED_BLUE);
+	const __m256i alpha = _mm256_set1_epi32 ((gint) 0xff000000);
+	const __m256i zero = _mm256_setzero_si256 ();
+	gsize         i;
+
+	for (i = 0; i + 8 <= n_pixels; i += 8) {
+		__m256i v = _mm256_loadu_si256 ((const __m256i *)(src + i));
+		__m256i a = _mm256_and_si256 (v, alpha);
+
+		if (_mm256_movemask_epi8 (_mm256_cmpeq_epi32 (a, alpha)) == -1)
+			_mm256_storeu_si256 ((__m256i *)(dst + i * 4), _mm256_shuffle_epi8 (v, shuffle));
+		else if (_mm256_movemask_epi8 (_mm256_cmpeq_epi32 (a, zero)) == -1)
+			_mm256_storeu_si256 ((__m256i *)(dst + i * 4), zero);
+		else
+			unpremultiply_rgba_ssse3 (dst + i * 4, src + i, 8);
+	}
+
+	unpremultiply_rgba_ssse3 (dst + i * 4, src + i, n_pixels - i);
+}
+
+GXPS_TARGET ("avx2") static void
+xrgb_to_rgbx_avx2 (guint8        *dst,
+		   const guint32 *src,
+		   gsize          n_pixels)
+{
+	const __m256i shuffle = _mm256_setr_epi8 (SHUFFLE_SWAP_RED_BLUE_NO_X, SHUFFLE_SWAP_RED_BLUE_NO_X);
+	gsize         i;
+
+	for (i = 0; i + 8 <= n_pixels; i += 8) {
+		__m256i v = _mm256_loadu_si256 ((const __m256i *)(src + i));
+
+		_mm256_storeu_si256 ((__m256i *)(dst + i * 4), _mm256_shuffle_epi8 (v, shuffle));
+	}
+
+	xrgb_to_rgbx_ssse3 (dst + i * 4, src + i, n_pixels - i);
+}
+
+static const GXPSPixelsKernels avx2_kernels = {
+	"avx2",
+	premultiply_rgba_avx2,
+	rgbx_to_xrgb_avx2,
+	rgb_to_xrgb_avx2,
+	gray_to_xrgb_sse2,
+	cmyk_to_xrgb_avx2,
+	abgr_to_argb_avx2,
+	unpremultiply_rgba_avx2,
+	xrgb_to_rgbx_avx2
+};
+#endif /* HAVE_X86_SIMD */
+
+static const GXPSPixelsKernels *
+gxps_pixels_lookup_kernels (const gchar *name)
+{
+	if (g_strcmp0 (name, "scalar") == 0)
+		return &scalar_kernels;
+
+#ifdef HAVE_X86_SIMD
+	__builtin_cpu_init ();
+	if (g_strcmp0 (name, "sse2") == 0 && __builtin_cpu_supports ("sse2"))
+		return &sse2_kernels;
+	if (g_strcmp0 (name, "ssse3") == 0 && __builtin_cpu_supports ("ssse3"))
+		return &ssse3_kernels;
+	if (g_strcmp0 (name, "avx2") == 0 && __builtin_cpu_supports ("avx2"))
+		return &avx2_kernels;
+#endif
+
+	return NULL;
+}
+
+static const GXPSPixelsKernels *kernels = NULL;
+
+/* The best implementation supported by the CPU is chosen the
+ * first time it's needed. Setting GXPS_PIXELS_SCALAR in the
+ * environment forces the scalar one.
+ */
+static const GXPSPixelsKernels *
+gxps_pixels_get_kernels (void)
+{
+	if (g_once_init_enter (&kernels)) {
+		const GXPSPixelsKernels *k = &scalar_kernels;
+
+		if (!g_getenv ("GXPS_PIXELS_SCALAR")) {
+			static const gchar *best[] = { "avx2", "ssse3", "sse2" };
+			guint i;
+
+			for (i = 0; i < G_N_ELEMENTS (best) && k == &scalar_kernels; i++) {
+				const GXPSPixelsKernels *found = gxps_pixels_lookup_kernels (best[i]);
+
+				if (found)
+					k = found;
+			}
+		}
+		g_once_init_leave (&kernels, k);
+	}
+
+	return g_atomic_pointer_get (&kernels);
+}
+
+/* Replaces the implementation chosen at runtime, so that the tests
+ * and benchmarks can run every kernel supported by the CPU. Returns
+ * FALSE if @name is unknown or not supported, leaving the current
+ * implementation in place. It must not be called while other threads
+ * are converting pixels.
+ */
+gboolean
+gxps_pixels_set_implementation (const gchar *name)
+{
+	const GXPSPixelsKernels *k;
+
+	k = gxps_pixels_lookup_kernels (name);
+	if (!k)
+		return FALSE;
+
+	gxps_pixels_get_kernels ();
+	g_atomic_pointer_set (&kernels, k);
+
+	return TRUE;
+}
+
+const gchar *
+gxps_pixels_get_implementation (void)
+{
+	return gxps_pixels_get_kernels ()->name;
+}
+
+/* RGBA bytes => premultiplied native endian ARGB */
+void
+gxps_pixels_premultiply_rgba (guint32      *dst,
+			      const guint8 *src,
+			      gsize         n_pixels)
+{
+	gxps_pixels_get_kernels ()->premultiply_rgba (dst, src, n_pixels);
+}
+
+/* RGBx bytes => native endian xRGB */
+void
+gxps_pixels_rgbx_to_xrgb (guint32      *dst,
+			  const guint8 *src,
+			  gsize         n_pixels)
+{
+	gxps_pixels_get_kernels ()->rgbx_to_xrgb (dst, src, n_pixels);
+}
+
+/* RGB bytes => native endian xRGB */
+void
+gxps_pixels_rgb_to_xrgb (guint32      *dst,
+			 const guint8 *src,
+			 gsize         n_pixels)
+{
+	gxps_pixels_get_kernels ()->rgb_to_xrgb (dst, src, n_pixels);
+}
+
+/* Gray bytes => native endian xRGB */
+void
+gxps_pixels_gray_to_xrgb (guint32      *dst,
+			  const guint8 *src,
+			  gsize         n_pixels)
+{
+	gxps_pixels_get_kernels ()->gray_to_xrgb (dst, src, n_pixels);
+}
+
+/* Inverted CMYK bytes => native endian xRGB */
+void
+gxps_pixels_cmyk_to_xrgb (guint32      *dst,
+			  const guint8 *src,
+			  gsize         n_pixels)
+{
+	gxps_pixels_get_kernels ()->cmyk_to_xrgb (dst, src, n_pixels);
+}
+
+/* Native endian ABGR (as returned by libtiff) => native endian ARGB */
+void
+gxps_pixels_abgr_to_argb (guint32       *dst,
+			  const guint32 *src,
+			  gsize          n_pixels)
+{
+	gxps_pixels_get_kernels ()->abgr_to_argb (dst, src, n_pixels);
+}
+
+/* Premultiplied native endian ARGB => RGBA bytes */
+void
+gxps_pixels_unpremultiply_rgba (guint8        *dst,
+				const guint32 *src,
+				gsize          n_pixels)
+{
+	gxps_pixels_get_kernels ()->unpremultiply_rgba (dst, src, n_pixels);
+}
+
+/* Native endian xRGB => RGBx bytes */
+void
+gxps_pixels_xrgb_to_rgbx (guint8        *dst,
+			  const guint32 *src,
+			  gsize          n_pixels)
+{
+	gxps_pixels_get_kernels ()->xrgb_to_rgbx (dst, src, n_pixels);
+}
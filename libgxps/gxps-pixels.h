@@ -0,0 +1,62 @@
+/* GXPSPixels
+ *
+ * Copyright (C) 2026  libgxps contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __GXPS_PIXELS_H__
+#define __GXPS_PIXELS_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Pixel format conversions between the byte layouts used by the image
+ * codecs and the native endian 32 bit pixels used by cairo. Conversions
+ * whose input and output pixels have the same size can be done in place.
+ */
+
+const gchar *gxps_pixels_get_implementation   (void);
+gboolean     gxps_pixels_set_implementation   (const gchar   *name);
+
+void         gxps_pixels_premultiply_rgba     (guint32       *dst,
+					       const guint8  *src,
+					       gsize          n_pixels);
+void         gxps_pixels_rgbx_to_xrgb         (guint32       *dst,
+					       const guint8  *src,
+					       gsize          n_pixels);
+void         gxps_pixels_rgb_to_xrgb          (guint32       *dst,
+					       const guint8  *src,
+					       gsize          n_pixels);
+void         gxps_pixels_gray_to_xrgb         (guint32       *dst,
+					       const guint8  *src,
+					       gsize          n_pixels);
+void         gxps_pixels_cmyk_to_xrgb         (guint32       *dst,
+					       const guint8  *src,
+					       gsize          n_pixels);
+void         gxps_pixels_abgr_to_argb         (guint32       *dst,
+					       const guint32 *src,
+					       gsize          n_pixels);
+void         gxps_pixels_unpremultiply_rgba   (guint8        *dst,
+					       const guint32 *src,
+					       gsize          n_pixels);
+void         gxps_pixels_xrgb_to_rgbx         (guint8        *dst,
+					       const guint32 *src,
+					       gsize          n_pixels);
+
+G_END_DECLS
+
+#endif /* __GXPS_PIXELS_H__ */
@@ -34,6 +34,10 @@ G_BEGIN_DECLS
 GXPSDocument          *_gxps_document_new           (GXPSArchive       *zip,
 						     const gchar       *source,
 						     GError           **error);
+GXPSDocument          *_gxps_document_new_progressive
+						    (GXPSArchive       *zip,
+						     const gchar       *source,
+						     GError           **error);
 GXPSPage              *_gxps_page_new               (GXPSArchive       *zip,
 						     const gchar       *source,
 						     GError           **error);
@@ -47,6 +51,10 @@ GXPSDocumentStructure *_gxps_document_structure_new (GXPSArchive       *zip,
 GXPSCoreProperties    *_gxps_core_properties_new    (GXPSArchive       *zip,
                                                      const gchar       *source,
                                                      GError           **error);
+GHashTable            *_gxps_page_get_anchors       (GXPSPage          *page);
+GList                 *_gxps_page_get_links_with_cairo
+						    (GXPSPage          *page,
+						     GError           **error);
 
 G_END_DECLS
 
@@ -146,10 +146,14 @@ gxps_resources_get_resource (GXPSResources *resources,
 
 		ht = node->data;
 		data = g_hash_table_lookup (ht, key);
-		if (data)
+		if (data) {
+			GXPS_STATS_ADD (resources->zip, RESOURCES_RESOLVED, 1);
 			return data;
+		}
 	}
 
+	GXPS_STATS_ADD (resources->zip, RESOURCES_UNRESOLVED, 1);
+
 	return NULL;
 }
 
@@ -435,6 +439,9 @@ resources_start_element (GMarkupParseContext  *context,
 	gint i;
 
 	if (strcmp (element_name, "ResourceDictionary") == 0) {
+		gxps_archive_stats_add_element (rcontext->resources->zip,
+						GXPS_STATS_ELEMENT_RESOURCE_DICTIONARY);
+
 		for (i = 0; names[i] != NULL; i++) {
 			if (strcmp (names[i], "Source") == 0)
 				source = values[i];
@@ -0,0 +1,36 @@
+/* GXPSStats
+ *
+ * Copyright (C) 2026  libgxps contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __GXPS_STATS_PRIVATE_H__
+#define __GXPS_STATS_PRIVATE_H__
+
+#include "gxps-stats.h"
+
+G_BEGIN_DECLS
+
+/* Every member is a guint64, gxps_archive_stats_add() adds to them by offset */
+struct _GXPSStats {
+	guint64 counters[GXPS_STATS_N_COUNTERS];
+	guint64 elements[GXPS_STATS_N_ELEMENTS];
+	guint64 phase_time[GXPS_STATS_N_PHASES];
+};
+
+G_END_DECLS
+
+#endif /* __GXPS_STATS_PRIVATE_H__ */
@@ -0,0 +1,140 @@
+/* GXPSStats
+ *
+ * Copyright (C) 2026  libgxps contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <config.h>
+
+#include "gxps-stats-private.h"
+
+/**
+ * SECTION:gxps-stats
+ * @Short_description: Performance counters
+ * @Title: GXPSStats
+ * @See_also: #GXPSFile, #GXPSPage
+ *
+ * #GXPSStats contains counters of the work done by libgxps to load
+ * and render a #GXPSFile, like the number of bytes read from the
+ * archive, the cache hits and misses, the number of elements parsed
+ * and the time spent in every phase, see #GXPSStatsCounter,
+ * #GXPSStatsElement and #GXPSStatsPhase. Collecting them is disabled by
+ * default, it has to be enabled with gxps_file_set_stats_enabled().
+ * The counters of the whole file are retrieved with
+ * gxps_file_get_stats() and the ones of a single page with
+ * gxps_page_get_stats().
+ */
+
+G_DEFINE_BOXED_TYPE (GXPSStats, gxps_stats, gxps_stats_copy, gxps_stats_free)
+
+/**
+ * gxps_stats_copy:
+ * @stats: a #GXPSStats
+ *
+ * Creates a copy of a #GXPSStats.
+ *
+ * Returns: a copy of @stats.
+ *     Free the returned object with gxps_stats_free().
+ *
+ * Since: 0.3.3
+ */
+GXPSStats *
+gxps_stats_copy (GXPSStats *stats)
+{
+	g_return_val_if_fail (stats != NULL, NULL);
+
+	return g_slice_dup (GXPSStats, stats);
+}
+
+/**
+ * gxps_stats_free:
+ * @stats: a #GXPSStats
+ *
+ * Frees a #GXPSStats.
+ *
+ * Since: 0.3.3
+ */
+void
+gxps_stats_free (GXPSStats *stats)
+{
+	if (G_UNLIKELY (!stats))
+		return;
+
+	g_slice_free (GXPSStats, stats);
+}
+
+/**
+ * gxps_stats_get_counter:
+ * @stats: a #GXPSStats
+ * @counter: a #GXPSStatsCounter
+ *
+ * Gets the value of @counter in @stats.
+ *
+ * Returns: the value of @counter.
+ *
+ * Since: 0.3.3
+ */
+guint64
+gxps_stats_get_counter (GXPSStats        *stats,
+			GXPSStatsCounter  counter)
+{
+	g_return_val_if_fail (stats != NULL, 0);
+	g_return_val_if_fail (counter < GXPS_STATS_N_COUNTERS, 0);
+
+	return stats->counters[counter];
+}
+
+/**
+ * gxps_stats_get_elements:
+ * @stats: a #GXPSStats
+ * @element: a #GXPSStatsElement
+ *
+ * Gets the number of elements of type @element parsed.
+ *
+ * Returns: the number of @element elements.
+ *
+ * Since: 0.3.3
+ */
+guint64
+gxps_stats_get_elements (GXPSStats        *stats,
+			 GXPSStatsElement  element)
+{
+	g_return_val_if_fail (stats != NULL, 0);
+	g_return_val_if_fail (element < GXPS_STATS_N_ELEMENTS, 0);
+
+	return stats->elements[element];
+}
+
+/**
+ * gxps_stats_get_phase_time:
+ * @stats: a #GXPSStats
+ * @phase: a #GXPSStatsPhase
+ *
+ * Gets the wall time spent in @phase.
+ *
+ * Returns: the time spent in @phase, in microseconds.
+ *
+ * Since: 0.3.3
+ */
+guint64
+gxps_stats_get_phase_time (GXPSStats      *stats,
+			   GXPSStatsPhase  phase)
+{
+	g_return_val_if_fail (stats != NULL, 0);
+	g_return_val_if_fail (phase < GXPS_STATS_N_PHASES, 0);
+
+	return stats->phase_time[phase];
+}
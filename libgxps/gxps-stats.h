@@ -0,0 +1,172 @@
+/* GXPSStats
+ *
+ * Copyright (C) 2026  libgxps contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#if !defined (__GXPS_H_INSIDE__) && !defined (GXPS_COMPILATION)
+#error "Only <libgxps/gxps.h> can be included directly."
+#endif
+
+#ifndef __GXPS_STATS_H__
+#define __GXPS_STATS_H__
+
+#include <glib-object.h>
+#include <libgxps/gxps-version.h>
+
+G_BEGIN_DECLS
+
+#define GXPS_TYPE_STATS (gxps_stats_get_type ())
+
+/**
+ * GXPSStatsPhase:
+ * @GXPS_STATS_PHASE_OPEN: opening the archive and parsing the
+ *     document sequence in gxps_file_new()
+ * @GXPS_STATS_PHASE_DOCUMENT: parsing the page table of documents
+ * @GXPS_STATS_PHASE_PAGE: loading pages
+ * @GXPS_STATS_PHASE_RENDER: rendering pages
+ * @GXPS_STATS_PHASE_IMAGE_DECODE: decoding images, included in the
+ *     time of the phase that needed them, usually rendering
+ * @GXPS_STATS_PHASE_FONT_LOAD: loading fonts, included in the
+ *     time of the phase that needed them, usually rendering
+ * @GXPS_STATS_N_PHASES: the number of phases
+ *
+ * Phases whose wall time is measured in #GXPSStats, see
+ * gxps_stats_get_phase_time().
+ *
+ * Since: 0.3.3
+ */
+typedef enum {
+	GXPS_STATS_PHASE_OPEN,
+	GXPS_STATS_PHASE_DOCUMENT,
+	GXPS_STATS_PHASE_PAGE,
+	GXPS_STATS_PHASE_RENDER,
+	GXPS_STATS_PHASE_IMAGE_DECODE,
+	GXPS_STATS_PHASE_FONT_LOAD,
+	GXPS_STATS_N_PHASES
+} GXPSStatsPhase;
+
+/**
+ * GXPSStatsElement:
+ * @GXPS_STATS_ELEMENT_CANVAS: Canvas elements
+ * @GXPS_STATS_ELEMENT_PATH: Path elements
+ * @GXPS_STATS_ELEMENT_GLYPHS: Glyphs elements
+ * @GXPS_STATS_ELEMENT_PATH_FIGURE: PathFigure elements
+ * @GXPS_STATS_ELEMENT_SOLID_COLOR_BRUSH: SolidColorBrush elements
+ * @GXPS_STATS_ELEMENT_IMAGE_BRUSH: ImageBrush elements
+ * @GXPS_STATS_ELEMENT_LINEAR_GRADIENT_BRUSH: LinearGradientBrush elements
+ * @GXPS_STATS_ELEMENT_RADIAL_GRADIENT_BRUSH: RadialGradientBrush elements
+ * @GXPS_STATS_ELEMENT_VISUAL_BRUSH: VisualBrush elements
+ * @GXPS_STATS_ELEMENT_RESOURCE_DICTIONARY: ResourceDictionary elements
+ * @GXPS_STATS_N_ELEMENTS: the number of element types
+ *
+ * Types of the elements counted in #GXPSStats, see
+ * gxps_stats_get_elements().
+ *
+ * Since: 0.3.3
+ */
+typedef enum {
+	GXPS_STATS_ELEMENT_CANVAS,
+	GXPS_STATS_ELEMENT_PATH,
+	GXPS_STATS_ELEMENT_GLYPHS,
+	GXPS_STATS_ELEMENT_PATH_FIGURE,
+	GXPS_STATS_ELEMENT_SOLID_COLOR_BRUSH,
+	GXPS_STATS_ELEMENT_IMAGE_BRUSH,
+	GXPS_STATS_ELEMENT_LINEAR_GRADIENT_BRUSH,
+	GXPS_STATS_ELEMENT_RADIAL_GRADIENT_BRUSH,
+	GXPS_STATS_ELEMENT_VISUAL_BRUSH,
+	GXPS_STATS_ELEMENT_RESOURCE_DICTIONARY,
+	GXPS_STATS_N_ELEMENTS
+} GXPSStatsElement;
+
+/**
+ * GXPSStatsCounter:
+ * @GXPS_STATS_COUNTER_BYTES_INFLATED: number of bytes read from the
+ *     archive entries
+ * @GXPS_STATS_COUNTER_ENTRIES_OPENED: number of archive entries opened,
+ *     every one of them reads the archive again from the beginning to
+ *     find the entry
+ * @GXPS_STATS_COUNTER_FONT_CACHE_HITS: number of fonts found in the
+ *     font cache
+ * @GXPS_STATS_COUNTER_FONT_CACHE_MISSES: number of fonts loaded from
+ *     the archive
+ * @GXPS_STATS_COUNTER_IMAGE_CACHE_HITS: number of images found in the
+ *     page image cache
+ * @GXPS_STATS_COUNTER_IMAGE_CACHE_MISSES: number of images decoded
+ * @GXPS_STATS_COUNTER_ICC_CACHE_HITS: number of ICC profiles found in
+ *     the profile cache
+ * @GXPS_STATS_COUNTER_ICC_CACHE_MISSES: number of ICC profiles loaded
+ *     from the archive
+ * @GXPS_STATS_COUNTER_RESOURCES_RESOLVED: number of resource references
+ *     resolved
+ * @GXPS_STATS_COUNTER_RESOURCES_UNRESOLVED: number of resource
+ *     references not found
+ * @GXPS_STATS_COUNTER_PUSH_GROUPS: number of intermediate groups created
+ *     for opacity, opacity masks and brushes
+ * @GXPS_STATS_N_COUNTERS: the number of counters
+ *
+ * Counters of #GXPSStats, see gxps_stats_get_counter().
+ *
+ * Since: 0.3.3
+ */
+typedef enum {
+	GXPS_STATS_COUNTER_BYTES_INFLATED,
+	GXPS_STATS_COUNTER_ENTRIES_OPENED,
+	GXPS_STATS_COUNTER_FONT_CACHE_HITS,
+	GXPS_STATS_COUNTER_FONT_CACHE_MISSES,
+	GXPS_STATS_COUNTER_IMAGE_CACHE_HITS,
+	GXPS_STATS_COUNTER_IMAGE_CACHE_MISSES,
+	GXPS_STATS_COUNTER_ICC_CACHE_HITS,
+	GXPS_STATS_COUNTER_ICC_CACHE_MISSES,
+	GXPS_STATS_COUNTER_RESOURCES_RESOLVED,
+	GXPS_STATS_COUNTER_RESOURCES_UNRESOLVED,
+	GXPS_STATS_COUNTER_PUSH_GROUPS,
+	GXPS_STATS_N_COUNTERS
+} GXPSStatsCounter;
+
+/**
+ * GXPSStats:
+ *
+ * Performance counters of a #GXPSFile or a #GXPSPage, see
+ * gxps_file_set_stats_enabled(). The structure is opaque, so that
+ * new counters can be added, its values are retrieved with
+ * gxps_stats_get_counter(), gxps_stats_get_elements() and
+ * gxps_stats_get_phase_time().
+ *
+ * Since: 0.3.3
+ */
+typedef struct _GXPSStats GXPSStats;
+
+GXPS_AVAILABLE_IN_ALL
+GType      gxps_stats_get_type (void) G_GNUC_CONST;
+GXPS_AVAILABLE_IN_ALL
+GXPSStats *gxps_stats_copy     (GXPSStats *stats);
+GXPS_AVAILABLE_IN_ALL
+void       gxps_stats_free     (GXPSStats *stats);
+
+GXPS_AVAILABLE_IN_ALL
+guint64    gxps_stats_get_counter    (GXPSStats        *stats,
+				      GXPSStatsCounter  counter);
+GXPS_AVAILABLE_IN_ALL
+guint64    gxps_stats_get_elements   (GXPSStats        *stats,
+				      GXPSStatsElement  element);
+GXPS_AVAILABLE_IN_ALL
+guint64    gxps_stats_get_phase_time (GXPSStats        *stats,
+				      GXPSStatsPhase    phase);
+
+G_END_DECLS
+
+#endif /* __GXPS_STATS_H__ */
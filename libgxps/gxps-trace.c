@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2026  libgxps contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <glib/gstdio.h>
+
+#include "gxps-trace.h"
+
+#define EVENTS_PER_CHUNK 1024
+
+typedef struct {
+	const gchar *name;
+	gchar       *part;
+	gint64       timestamp;
+	gchar        phase;
+} GXPSTraceEvent;
+
+typedef struct _GXPSTraceChunk GXPSTraceChunk;
+
+struct _GXPSTraceChunk {
+	GXPSTraceChunk *next;
+	gint            n_events;
+	GXPSTraceEvent  events[EVENTS_PER_CHUNK];
+};
+
+/* Every thread records its events in its own buffer, so recording
+ * doesn't need any locking. Buffers are only added to the global list
+ * the first time a thread records an event, and they are never freed,
+ * so that the events of finished threads are written too. The number
+ * of events of a chunk and the next chunk are set atomically once the
+ * events are complete, so the trace can be written while other threads
+ * are still recording.
+ */
+typedef struct _GXPSTraceBuffer GXPSTraceBuffer;
+
+struct _GXPSTraceBuffer {
+	GXPSTraceBuffer *next;
+	guint            tid;
+	GXPSTraceChunk  *first;
+	GXPSTraceChunk  *last;
+};
+
+static gboolean         trace_enabled = FALSE;
+static gchar           *trace_filename = NULL;
+static GXPSTraceBuffer *trace_buffers = NULL;
+static gint             trace_n_threads = 0;
+static GPrivate         trace_buffer = G_PRIVATE_INIT (NULL);
+
+gboolean
+gxps_trace_enabled (void)
+{
+	static gsize initialized;
+
+	if (g_once_init_enter (&initialized)) {
+		const gchar *filename = g_getenv ("GXPS_TRACE");
+
+		if (filename && filename[0] != '\0') {
+			trace_filename = g_strdup (filename);
+			trace_enabled = TRUE;
+#ifndef __GNUC__
+			/* The atexit() functions of a DLL run when it's unloaded */
+			atexit (gxps_trace_flush);
+#endif
+		}
+
+		g_once_init_leave (&initialized, 1);
+	}
+
+	return trace_enabled;
+}
+
+static GXPSTraceBuffer *
+gxps_trace_get_buffer (void)
+{
+	GXPSTraceBuffer *buffer;
+
+	buffer = g_private_get (&trace_buffer);
+	if (G_LIKELY (buffer))
+		return buffer;
+
+	buffer = g_new0 (GXPSTraceBuffer, 1);
+	buffer->tid = g_atomic_int_add (&trace_n_threads, 1) + 1;
+	buffer->first = buffer->last = g_new0 (GXPSTraceChunk, 1);
+	g_private_set (&trace_buffer, buffer);
+
+	do {
+		buffer->next = g_atomic_pointer_get (&trace_buffers);
+	} while (!g_atomic_pointer_compare_and_exchange (&trace_buffers, buffer->next, buffer));
+
+	return buffer;
+}
+
+static void
+gxps_trace_add_event (const gchar *name,
+		      const gchar *part,
+		      gchar        phase)
+{
+	GXPSTraceBuffer *buffer = gxps_trace_get_buffer ();
+	GXPSTraceChunk  *chunk = buffer->last;
+	GXPSTraceEvent  *event;
+	gint             n_events;
+
+	/* Only this thread changes the chunks of its buffer */
+	n_events = g_atomic_int_get (&chunk->n_events);
+	if (n_events == EVENTS_PER_CHUNK) {
+		chunk = g_new0 (GXPSTraceChunk, 1);
+		g_atomic_pointer_set (&buffer->last->next, chunk);
+		buffer->last = chunk;
+		n_events = 0;
+	}
+
+	event = &chunk->events[n_events];
+	event->name = name;
+	event->part = g_strdup (part);
+	event->timestamp = g_get_monotonic_time ();
+	event->phase = phase;
+	g_atomic_int_set (&chunk->n_events, n_events + 1);
+}
+
+void
+gxps_trace_begin (const gchar *name,
+		  const gchar *part)
+{
+	gxps_trace_add_event (name, part, 'B');
+}
+
+void
+gxps_trace_end (const gchar *name)
+{
+	gxps_trace_add_event (name, NULL, 'E');
+}
+
+static void
+write_json_string (FILE        *file,
+		   const gchar *str)
+{
+	const gchar *p;
+
+	fputc ('"', file);
+	for (p = str; *p; p++) {
+		guchar c = *p;
+
+		if (c == '"' || c == '\\')
+			fprintf (file, "\\%c", c);
+		else if (c < 0x20)
+			fprintf (file, "\\u%04x", c);
+		else
+			fputc (c, file);
+	}
+	fputc ('"', file);
+}
+
+/* Writes all the events recorded so far, replacing the file written
+ * by any previous call. It's called when the library is unloaded or
+ * the process exits.
+ */
+void
+gxps_trace_flush (void)
+{
+	FILE            *file;
+	GXPSTraceBuffer *buffer;
+	gboolean         first = TRUE;
+
+	if (!gxps_trace_enabled ())
+		return;
+
+	file = g_fopen (trace_filename, "w");
+	if (!file) {
+		g_printerr ("Error writing trace to %s\n", trace_filename);
+		return;
+	}
+
+	fputs ("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", file);
+	for (buffer = g_atomic_pointer_get (&trace_buffers); buffer; buffer = buffer->next) {
+		GXPSTraceChunk *chunk;
+
+		for (chunk = buffer->first; chunk; chunk = g_atomic_pointer_get (&chunk->next)) {
+			gint n_events = g_atomic_int_get (&chunk->n_events);
+			gint i;
+
+			for (i = 0; i < n_events; i++) {
+				GXPSTraceEvent *event = &chunk->events[i];
+
+				fprintf (file, "%s\n{\"name\":", first ? "" : ",");
+				write_json_string (file, event->name);
+				fprintf (file, ",\"cat\":\"gxps\",\"ph\":\"%c\",\"ts\":%" G_GINT64_FORMAT ",\"pid\":1,\"tid\":%u",
+					 event->phase, event->timestamp, buffer->tid);
+				if (event->part) {
+					fputs (",\"args\":{\"part\":", file);
+					write_json_string (file, event->part);
+					fputc ('}', file);
+				}
+				fputc ('}', file);
+				first = FALSE;
+			}
+		}
+	}
+	fputs ("\n]}\n", file);
+
+	fclose (file);
+}
+
+/* A library destructor rather than atexit(), so that the trace is
+ * written before the library is unloaded when it's used as a module.
+ */
+#ifdef __GNUC__
+static void gxps_trace_destructor (void) __attribute__ ((destructor));
+
+static void
+gxps_trace_destructor (void)
+{
+	if (trace_enabled)
+		gxps_trace_flush ();
+}
+#endif
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2026  libgxps contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __GXPS_TRACE_H__
+#define __GXPS_TRACE_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Tracing is enabled by setting GXPS_TRACE to the path of the file where
+ * the trace is written when the library is unloaded or the process exits,
+ * in the Chrome trace event format that can be loaded in about:tracing
+ * and Perfetto.
+ */
+gboolean gxps_trace_enabled (void);
+void     gxps_trace_begin   (const gchar *name,
+			     const gchar *part);
+void     gxps_trace_end     (const gchar *name);
+void     gxps_trace_flush   (void);
+
+/* @name must be a static string, @part is copied */
+#define GXPS_TRACE_BEGIN(name, part) G_STMT_START {		\
+		if (G_UNLIKELY (gxps_trace_enabled ()))		\
+			gxps_trace_begin (name, part);		\
+	} G_STMT_END
+
+#define GXPS_TRACE_END(name) G_STMT_START {			\
+		if (G_UNLIKELY (gxps_trace_enabled ()))		\
+			gxps_trace_end (name);			\
+	} G_STMT_END
+
+G_END_DECLS
+
+#endif /* __GXPS_TRACE_H__ */
@@ -0,0 +1,490 @@
+# CorpusGenerator.py
+#
+# Copyright (C) 2026 libgxps contributors
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+# Generator of synthetic XPS documents. The output only depends on the
+# parameters and the seed, so the same corpus can be recreated anywhere
+# without redistributing real documents. Fonts and images are generated
+# too: every font is a minimal TrueType font whose glyphs are boxes of
+# different heights, and every image is a gradient PNG.
+
+import random
+import struct
+import zipfile
+import zlib
+from xml.sax.saxutils import quoteattr
+
+XPS_NS = 'http://schemas.microsoft.com/xps/2005/06'
+KEY_NS = 'http://schemas.microsoft.com/xps/2005/06/resourcedictionary-key'
+RELS_NS = 'http://schemas.openxmlformats.org/package/2006/relationships'
+FIXED_REPRESENTATION = 'http://schemas.microsoft.com/xps/2005/06/fixedrepresentation'
+REQUIRED_RESOURCE = 'http://schemas.microsoft.com/xps/2005/06/required-resource'
+
+CONTENT_TYPES = [
+    ('rels', 'application/vnd.openxmlformats-package.relationships+xml'),
+    ('fdseq', 'application/vnd.ms-package.xps-fixeddocumentsequence+xml'),
+    ('fdoc', 'application/vnd.ms-package.xps-fixeddocument+xml'),
+    ('fpage', 'application/vnd.ms-package.xps-fixedpage+xml'),
+    ('dict', 'application/vnd.ms-package.xps-resourcedictionary+xml'),
+    ('ttf', 'application/vnd.ms-opentype'),
+    ('odttf', 'application/vnd.ms-package.obfuscated-opentype'),
+    ('png', 'image/png'),
+]
+
+# Fixed timestamp for the zip entries, so that the same parameters
+# always produce the same bytes.
+ZIP_DATE_TIME = (1980, 1, 1, 0, 0, 0)
+
+class CorpusParameters:
+
+    def __init__(self):
+        self.seed = 0
+        self.documents = 1
+        self.pages = 10
+        self.page_width = 816
+        self.page_height = 1056
+        self.paths = 50
+        self.path_segments = 10
+        self.glyph_runs = 20
+        self.glyph_run_length = 40
+        self.fonts = 1
+        self.obfuscate_fonts = False
+        self.font_file = None
+        self.images = 0
+        self.shared_images = True
+        self.image_width = 256
+        self.image_height = 256
+        self.remote_dictionaries = False
+        self.dictionary_entries = 16
+        self.piece_size = 0
+
+def _table_checksum(data):
+    data += b'\0' * (-len(data) % 4)
+    total = 0
+    for value in struct.unpack('>%dI' % (len(data) // 4), data):
+        total = (total + value) & 0xffffffff
+    return total
+
+def create_font(variant = 0):
+    '''Create a TrueType font mapping the printable ASCII characters to
+    boxes. Different variants produce glyphs of different heights.'''
+
+    first_char = 0x20
+    last_char = 0x7e
+    units_per_em = 1000
+    advance = 600
+
+    # Glyph 0 is .notdef and glyph 1 is the space, both empty.
+    glyphs = [b'', b'']
+    for c in range(first_char + 1, last_char + 1):
+        height = 300 + ((c + variant) * 37) % 450
+        points = [(50, 0), (50, height), (550, height), (550, 0)]
+        glyph = struct.pack('>hhhhh', 1, 50, 0, 550, height)
+        glyph += struct.pack('>HH', len(points) - 1, 0)
+        glyph += b'\x01' * len(points)
+        x = y = 0
+        deltas_x = b''
+        deltas_y = b''
+        for px, py in points:
+            deltas_x += struct.pack('>h', px - x)
+            deltas_y += struct.pack('>h', py - y)
+            x, y = px, py
+        glyph += deltas_x + deltas_y
+        glyph += b'\0' * (-len(glyph) % 4)
+        glyphs.append(glyph)
+    n_glyphs = len(glyphs)
+
+    loca = b''
+    offset = 0
+    for glyph in glyphs:
+        loca += struct.pack('>I', offset)
+        offset += len(glyph)
+    loca += struct.pack('>I', offset)
+    glyf = b''.join(glyphs)
+
+    head = struct.pack('>IIIIHHqqhhhhHHhhh',
+                       0x00010000, 0x00010000, 0, 0x5f0f3cf5, 0x000b,
+                       units_per_em, 0, 0, 0, 0, 550, 750, 0, 8, 2, 1, 0)
+    hhea = struct.pack('>IhhhHhhhhhhhhhhhH',
+                       0x00010000, 800, -200, 0, advance, 0, 0, 550,
+                       1, 0, 0, 0, 0, 0, 0, 0, n_glyphs)
+    maxp = struct.pack('>IHHHHHHHHHHHHHH',
+                       0x00010000, n_glyphs, 4, 1, 0, 0, 2,
+                       0, 0, 0, 0, 0, 0, 0, 0)
+    hmtx = struct.pack('>HH', advance, 0) * n_glyphs
+
+    # Format 4 cmap with a single segment for the whole range plus the
+    # mandatory final segment.
+    seg_count = 2
+    subtable = struct.pack('>HHHHHHH', 4, 16 + seg_count * 8, 0,
+                           seg_count * 2, 4, 1, 0)
+    subtable += struct.pack('>HHH', last_char, 0xffff, 0)
+    subtable += struct.pack('>HH', first_char, 0xffff)
+    subtable += struct.pack('>hh', 1 - first_char, 1)
+    subtable += struct.pack('>HH', 0, 0)
+    cmap = struct.pack('>HHHHI', 0, 1, 3, 1, 12) + subtable
+
+    family = 'GXPS Synthetic %d' % variant
+    names = [(1, family), (2, 'Regular'), (4, family),
+             (6, 'GXPSSynthetic%d-Regular' % variant)]
+    records = b''
+    strings = b''
+    for name_id, value in names:
+        encoded = value.encode('utf-16-be')
+        records += struct.pack('>HHHHHH', 3, 1, 0x409, name_id, len(encoded), len(strings))
+        strings += encoded
+    name = struct.pack('>HHH', 0, len(names), 6 + len(records)) + records + strings
+
+    post = struct.pack('>IIhhIIIII', 0x00030000, 0, -100, 50, 0, 0, 0, 0, 0)
+
+    tables = {
+        b'cmap' : cmap,
+        b'glyf' : glyf,
+        b'head' : head,
+        b'hhea' : hhea,
+        b'hmtx' : hmtx,
+        b'loca' : loca,
+        b'maxp' : maxp,
+        b'name' : name,
+        b'post' : post,
+    }
+
+    n_tables = len(tables)
+    search_range = 16
+    entry_selector = 0
+    while search_range * 2 <= n_tables * 16:
+        search_range *= 2
+        entry_selector += 1
+    directory = struct.pack('>IHHHH', 0x00010000, n_tables, search_range,
+                            entry_selector, n_tables * 16 - search_range)
+    data = b''
+    offset = 12 + 16 * n_tables
+    head_offset = 0
+    for tag in sorted(tables.keys()):
+        table = tables[tag]
+        if tag == b'head':
+            head_offset = offset
+        directory += struct.pack('>4sIII', tag, _table_checksum(table), offset, len(table))
+        table += b'\0' * (-len(table) % 4)
+        data += table
+        offset += len(table)
+
+    font = bytearray(directory + data)
+    adjustment = (0xb1b0afba - _table_checksum(bytes(font))) & 0xffffffff
+    struct.pack_into('>I', font, head_offset + 8, adjustment)
+
+    return bytes(font)
+
+def obfuscate_font(data, guid):
+    '''Obfuscate the font data as described in the XPS specification,
+    using the key derived from the GUID in the font part name.'''
+
+    indexes = [6, 4, 2, 0, 11, 9, 16, 14, 19, 21, 24, 26, 28, 30, 32, 34]
+    mapping = [15, 14, 13, 12, 11, 10, 9, 8, 6, 7, 4, 5, 0, 1, 2, 3]
+    key = [int(guid[i:i + 2], 16) for i in indexes]
+
+    font = bytearray(data)
+    for i in range(16):
+        font[i] ^= key[mapping[i]]
+        font[i + 16] ^= key[mapping[i]]
+
+    return bytes(font)
+
+def create_png(width, height, variant = 0):
+    '''Create an RGB PNG image with a gradient that depends on variant.'''
+
+    rows = []
+    for y in range(height):
+        row = bytearray(1 + width * 3)
+        for x in range(width):
+            row[1 + x * 3] = (x * 255 // max(1, width - 1) + variant * 53) & 0xff
+            row[2 + x * 3] = (y * 255 // max(1, height - 1) + variant * 97) & 0xff
+            row[3 + x * 3] = ((x ^ y) + variant * 31) & 0xff
+        rows.append(bytes(row))
+
+    def chunk(chunk_type, data):
+        crc = zlib.crc32(chunk_type + data) & 0xffffffff
+        return struct.pack('>I', len(data)) + chunk_type + data + struct.pack('>I', crc)
+
+    png = b'\x89PNG\r\n\x1a\n'
+    png += chunk(b'IHDR', struct.pack('>IIBBBBB', width, height, 8, 2, 0, 0, 0))
+    png += chunk(b'IDAT', zlib.compress(b''.join(rows), 9))
+    png += chunk(b'IEND', b'')
+
+    return png
+
+class CorpusGenerator:
+
+    def __init__(self, params):
+        self._params = params
+        self._random = random.Random(params.seed)
+
+    def _guid(self):
+        digits = ''.join(['%02X' % self._random.randint(0, 255) for i in range(16)])
+        return '%s-%s-%s-%s-%s' % (digits[0:8], digits[8:12], digits[12:16],
+                                   digits[16:20], digits[20:32])
+
+    def _point(self):
+        return '%.2f,%.2f' % (self._random.uniform(0, self._params.page_width),
+                              self._random.uniform(0, self._params.page_height))
+
+    def _color(self, alpha = 'FF'):
+        return '#%s%02X%02X%02X' % (alpha, self._random.randint(0, 255),
+                                    self._random.randint(0, 255),
+                                    self._random.randint(0, 255))
+
+    def _path_data(self):
+        data = ['M %s' % self._point()]
+        for i in range(self._params.path_segments):
+            kind = self._random.randint(0, 3)
+            if kind == 0:
+                data.append('L %s' % self._point())
+            elif kind == 1:
+                data.append('C %s %s %s' % (self._point(), self._point(), self._point()))
+            elif kind == 2:
+                data.append('Q %s %s' % (self._point(), self._point()))
+            else:
+                data.append('A 20,10 %d 0 1 %s' % (self._random.randint(0, 359), self._point()))
+        data.append('Z')
+        return ' '.join(data)
+
+    def _glyph_text(self):
+        chars = [chr(self._random.randint(0x21, 0x7e)) for i in range(self._params.glyph_run_length)]
+        for i in range(5, len(chars), 6):
+            chars[i] = ' '
+        text = ''.join(chars).strip() or 'X'
+        return text.replace('{', 'x')
+
+    def _create_fonts(self, resources_dir):
+        fonts = []
+        for i in range(self._params.fonts):
+            if self._params.font_file:
+                with open(self._params.font_file, 'rb') as f:
+                    data = f.read()
+            else:
+                data = create_font(i)
+
+            if self._params.obfuscate_fonts:
+                guid = self._guid()
+                name = '%s/Fonts/%s.odttf' % (resources_dir, guid)
+                data = obfuscate_font(data, guid)
+            else:
+                name = '%s/Fonts/Font%d.ttf' % (resources_dir, i)
+            fonts.append((name, data))
+
+        return fonts
+
+    def _create_images(self, resources_dir, prefix, count, variant):
+        images = []
+        for i in range(count):
+            name = '%s/Images/%sImage%d.png' % (resources_dir, prefix, i)
+            images.append((name, create_png(self._params.image_width,
+                                            self._params.image_height,
+                                            variant + i)))
+        return images
+
+    def _create_dictionary(self):
+        entries = []
+        for i in range(self._params.dictionary_entries):
+            entries.append('  <PathGeometry x:Key="Geometry%d" Figures="%s" />' % (i, self._path_data()))
+            entries.append('  <SolidColorBrush x:Key="Brush%d" Color="%s" />' % (i, self._color()))
+
+        return ('<ResourceDictionary xmlns="%s" xmlns:x="%s">\n%s\n</ResourceDictionary>\n'
+                % (XPS_NS, KEY_NS, '\n'.join(entries)))
+
+    def _create_page(self, fonts, images, dictionary):
+        params = self._params
+        elements = []
+
+        if dictionary:
+            elements.append('  <FixedPage.Resources>\n'
+                            '    <ResourceDictionary Source="%s" />\n'
+                            '  </FixedPage.Resources>' % dictionary)
+
+        for i in range(params.paths):
+            if dictionary and i % 2 == 1:
+                key = self._random.randint(0, params.dictionary_entries - 1)
+                elements.append('  <Path Data="{StaticResource Geometry%d}" Fill="{StaticResource Brush%d}" />'
+                                % (key, key))
+            elif i % 3 == 2:
+                elements.append('  <Path Data="%s" Stroke="%s" StrokeThickness="%.1f" />'
+                                % (self._path_data(), self._color(), self._random.uniform(0.5, 4)))
+            else:
+                elements.append('  <Path Data="%s" Fill="%s" />' % (self._path_data(), self._color('80')))
+
+        for i, image in enumerate(images):
+            x = self._random.uniform(0, params.page_width / 2)
+            y = self._random.uniform(0, params.page_height / 2)
+            width = params.image_width
+            height = params.image_height
+            elements.append('  <Path Data="M %.2f,%.2f L %.2f,%.2f %.2f,%.2f %.2f,%.2f Z">\n'
+                            '    <Path.Fill>\n'
+                            '      <ImageBrush ImageSource="%s" Viewbox="0,0,%d,%d" ViewboxUnits="Absolute" '
+                            'Viewport="%.2f,%.2f,%d,%d" ViewportUnits="Absolute" />\n'
+                            '    </Path.Fill>\n'
+                            '  </Path>'
+                            % (x, y, x + width, y, x + width, y + height, x, y + height,
+                               image, width, height, x, y, width, height))
+
+        if fonts:
+            for i in range(params.glyph_runs):
+                font = fonts[i % len(fonts)]
+                elements.append('  <Glyphs FontUri="%s" FontRenderingEmSize="%.1f" OriginX="%.2f" '
+                                'OriginY="%.2f" Fill="%s" UnicodeString=%s />'
+                                % (font, self._random.uniform(8, 24),
+                                   self._random.uniform(0, params.page_width / 2),
+                                   self._random.uniform(24, params.page_height),
+                                   self._color(), quoteattr(self._glyph_text())))
+
+        return ('<FixedPage xmlns="%s" xmlns:x="%s" Width="%d" Height="%d" xml:lang="en-US">\n%s\n</FixedPage>\n'
+                % (XPS_NS, KEY_NS, params.page_width, params.page_height, '\n'.join(elements)))
+
+    def _create_rels(self, targets, relationship_type):
+        rels = []
+        for i, target in enumerate(targets):
+            rels.append('  <Relationship Id="R%d" Type="%s" Target="%s" />' % (i, relationship_type, target))
+        return '<Relationships xmlns="%s">\n%s\n</Relationships>\n' % (RELS_NS, '\n'.join(rels))
+
+    def _create_parts(self):
+        params = self._params
+        parts = []
+        pages = []
+
+        content_types = ['  <Default Extension="%s" ContentType="%s" />' % ct for ct in CONTENT_TYPES]
+        parts.append(('[Content_Types].xml',
+                      '<Types xmlns="http://schemas.openxmlformats.org/package/2006/content-types">\n%s\n</Types>\n'
+                      % '\n'.join(content_types)))
+        parts.append(('_rels/.rels', self._create_rels(['/FixedDocumentSequence.fdseq'], FIXED_REPRESENTATION)))
+
+        references = []
+        for n_doc in range(params.documents):
+            doc_dir = '/Documents/%d' % (n_doc + 1)
+            resources_dir = '%s/Resources' % doc_dir
+            references.append('  <DocumentReference Source="%s/FixedDocument.fdoc" />' % doc_dir)
+
+            fonts = self._create_fonts(resources_dir) if params.glyph_runs > 0 else []
+            parts.extend(fonts)
+
+            dictionary = None
+            if params.remote_dictionaries:
+                dictionary = '%s/Shared.dict' % resources_dir
+                parts.append((dictionary, self._create_dictionary()))
+
+            shared_images = []
+            if params.shared_images:
+                shared_images = self._create_images(resources_dir, 'Shared', params.images, 0)
+                parts.extend(shared_images)
+
+            page_contents = []
+            for n_page in range(params.pages):
+                if params.shared_images:
+                    images = shared_images
+                else:
+                    images = self._create_images(resources_dir, 'Page%d' % (n_page + 1), params.images, n_page)
+                    parts.extend(images)
+
+                image_names = [image[0] for image in images]
+                font_names = [font[0] for font in fonts]
+                page_name = '%s/Pages/%d.fpage' % (doc_dir, n_page + 1)
+                pages.append((page_name, self._create_page(font_names, image_names, dictionary)))
+
+                resources = font_names + image_names
+                if dictionary:
+                    resources.append(dictionary)
+                if resources:
+                    parts.append(('%s/Pages/_rels/%d.fpage.rels' % (doc_dir, n_page + 1),
+                                  self._create_rels(resources, REQUIRED_RESOURCE)))
+
+                page_contents.append('  <PageContent Source="Pages/%d.fpage" Width="%d" Height="%d" />'
+                                     % (n_page + 1, params.page_width, params.page_height))
+
+            parts.append(('%s/FixedDocument.fdoc' % doc_dir,
+                          '<FixedDocument xmlns="%s">\n%s\n</FixedDocument>\n'
+                          % (XPS_NS, '\n'.join(page_contents))))
+
+        parts.append(('/FixedDocumentSequence.fdseq',
+                      '<FixedDocumentSequence xmlns="%s">\n%s\n</FixedDocumentSequence>\n'
+                      % (XPS_NS, '\n'.join(references))))
+
+        return parts, pages
+
+    def _split_pieces(self, name, data):
+        size = self._params.piece_size
+        chunks = [data[i:i + size] for i in range(0, len(data), size)]
+        pieces = []
+        for i, chunk in enumerate(chunks):
+            if i == len(chunks) - 1:
+                pieces.append(('%s/[%d].last.piece' % (name, i), chunk))
+            else:
+                pieces.append(('%s/[%d].piece' % (name, i), chunk))
+        return pieces
+
+    def _interleave_pages(self, pages):
+        # Pages are interleaved in pairs, so the pieces of a page are
+        # not contiguous in the archive.
+        entries = []
+        for i in range(0, len(pages), 2):
+            split = [self._split_pieces(name, data) for name, data in pages[i:i + 2]]
+            for n in range(max([len(pieces) for pieces in split])):
+                for pieces in split:
+                    if n < len(pieces):
+                        entries.append(pieces[n])
+        return entries
+
+    def write(self, filename):
+        parts, pages = self._create_parts()
+        pages = [(name, data.encode('utf-8')) for name, data in pages]
+        if self._params.piece_size > 0:
+            pages = self._interleave_pages(pages)
+
+        archive = zipfile.ZipFile(filename, 'w', zipfile.ZIP_DEFLATED)
+        for name, data in parts + pages:
+            if not isinstance(data, bytes):
+                data = data.encode('utf-8')
+            info = zipfile.ZipInfo(name.lstrip('/'), ZIP_DATE_TIME)
+            info.compress_type = zipfile.ZIP_DEFLATED
+            archive.writestr(info, data)
+        archive.close()
+
+# Documents generated by "generate-corpus --suite", every one of them
+# stresses a different subsystem.
+SUITE = [
+    ('paths', { 'pages' : 20, 'paths' : 500, 'path_segments' : 20, 'glyph_runs' : 0 }),
+    ('long-paths', { 'pages' : 5, 'paths' : 20, 'path_segments' : 5000, 'glyph_runs' : 0 }),
+    ('glyphs', { 'pages' : 20, 'paths' : 0, 'glyph_runs' : 500, 'fonts' : 4 }),
+    ('obfuscated-fonts', { 'pages' : 20, 'paths' : 0, 'glyph_runs' : 200, 'fonts' : 8, 'obfuscate_fonts' : True }),
+    ('shared-images', { 'pages' : 50, 'paths' : 10, 'glyph_runs' : 0, 'images' : 4, 'shared_images' : True }),
+    ('per-page-images', { 'pages' : 20, 'paths' : 10, 'glyph_runs' : 0, 'images' : 4, 'shared_images' : False }),
+    ('remote-dictionaries', { 'pages' : 20, 'paths' : 300, 'remote_dictionaries' : True, 'dictionary_entries' : 64 }),
+    ('pieces', { 'pages' : 20, 'paths' : 200, 'piece_size' : 4096 }),
+    ('many-pages', { 'pages' : 2000, 'paths' : 5, 'glyph_runs' : 5 }),
+    ('many-documents', { 'documents' : 50, 'pages' : 10, 'paths' : 10, 'glyph_runs' : 5 }),
+]
+
+def generate_suite(outdir, seed = 0):
+    import os
+
+    filenames = []
+    for name, values in SUITE:
+        params = CorpusParameters()
+        params.seed = seed
+        for key, value in values.items():
+            setattr(params, key, value)
+        filename = os.path.join(outdir, '%s.xps' % name)
+        CorpusGenerator(params).write(filename)
+        filenames.append(filename)
+    return filenames
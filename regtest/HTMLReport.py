@@ -16,12 +16,15 @@
 # along with this program; if not, write to the Free Software
 # Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
-from Test import Test
+from Test import Test, MIN_TIME_DELTA
 from Config import Config
 import os
 import errno
 import subprocess
 
+# Number of tests listed in every performance table
+N_WORST_OFFENDERS = 20
+
 class HTMLPrettyDiff:
 
     def write(self, test, outdir, actual, expected, diff):
@@ -136,6 +139,16 @@ class TestResult:
     def get_stderr(self):
         return self._test.get_stderr(os.path.join(self._outdir, self._test_name))
 
+    def get_perf(self):
+        '''Returns the reference and result performance data, or None
+        if any of them is missing'''
+        ref_perf = self._test.get_perf(os.path.join(self._refsdir, self._test_name))
+        perf = self._test.get_perf(os.path.join(self._outdir, self._test_name))
+        if ref_perf is None or perf is None:
+            return None
+
+        return ref_perf, perf
+
     def get_failed_html(self):
         html = ""
         for result in self._results:
@@ -180,6 +193,39 @@ class TestResult:
             return "<ul>%s</ul>\n" % (html)
         return ""
 
+def _perf_change(ref_value, value):
+    if ref_value <= 0:
+        return 0.
+    return (value - ref_value) * 100. / ref_value
+
+def get_worst_offenders_html(results, key, title, unit_format, min_delta = 0):
+    # Changes of at most min_delta are noise, the same floor used by
+    # Test.compare_perf, however big they are relative to the reference
+    offenders = []
+    for test in results:
+        perf_data = test.get_perf()
+        if perf_data is None:
+            continue
+
+        ref_perf, perf = perf_data
+        if perf[key] - ref_perf[key] <= min_delta:
+            continue
+        change = _perf_change(ref_perf[key], perf[key])
+        if change <= 0:
+            continue
+        offenders.append((change, test.get_test_name(), ref_perf[key], perf[key]))
+
+    if not offenders:
+        return ""
+
+    offenders.sort(reverse = True)
+    html = "<table>\n<tr><th>Test</th><th>Reference</th><th>Result</th><th>Change</th></tr>\n"
+    for change, test_name, ref_value, value in offenders[:N_WORST_OFFENDERS]:
+        html += "<tr><td>%s</td><td>%s</td><td>%s</td><td>+%.1f%%</td></tr>\n" % (test_name, unit_format % ref_value, unit_format % value, change)
+    html += "</table>\n"
+
+    return "<h2>%s</h2>\n%s" % (title, html)
+
 class HTMLReport:
 
     def __init__(self, docsdir, refsdir, outdir):
@@ -232,7 +278,13 @@ class HTMLReport:
         if failed_to_run:
             failed_to_run = "<h1><a name='failed_to_run'>Tests that failed to run (command returned an error status)</a></h1>\n%s" % (failed_to_run)
 
-        if failed or crashed or failed_to_run:
+        test_results = [results[test_name] for test_name in tests]
+        performance = get_worst_offenders_html(test_results, 'time', 'CPU time', '%.2f s', MIN_TIME_DELTA)
+        performance += get_worst_offenders_html(test_results, 'rss', 'Peak RSS', '%d KB')
+        if performance:
+            performance = "<h1><a name='performance'>Worst performance regressions</a></h1>\n%s" % (performance)
+
+        if failed or crashed or failed_to_run or performance:
             html += "<ul>\n"
             if failed:
                 html += "<li><a href='#failed'>Tests Failed (differences were found)</a></li>\n<ul>"
@@ -243,9 +295,11 @@ class HTMLReport:
                 html += "<li><a href='#crashed'>Tests Crashed(differences were found)</a></li>\n"
             if failed_to_run:
                 html += "<li><a href='#failed_to_run'>Tests that failed to run (command returned an error status)</a></li>\n"
+            if performance:
+                html += "<li><a href='#performance'>Worst performance regressions</a></li>\n"
             html += "</ul>\n"
 
-        html += failed + crashed + failed_to_run + "</body></html>"
+        html += failed + crashed + failed_to_run + performance + "</body></html>"
 
         report_index = os.path.join(self._htmldir, 'index.html')
         f = open(report_index, 'wb')
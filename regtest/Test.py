@@ -21,9 +21,13 @@ import os
 import subprocess
 import shutil
 import errno
+import time
 from Config import Config
 from Printer import get_printer
 
+# Time differences below this, in seconds, are considered noise
+MIN_TIME_DELTA = 0.05
+
 class Test:
 
     def __init__(self):
@@ -39,7 +43,7 @@ class Test:
         return md5.hexdigest()
 
     def __should_have_checksum(self, entry):
-        return entry not in ('md5', 'crashed', 'failed', 'stderr');
+        return entry not in ('md5', 'crashed', 'failed', 'stderr', 'perf');
 
     def create_checksums(self, refs_path, delete_refs = False):
         path = os.path.join(refs_path, 'md5')
@@ -107,7 +111,7 @@ class Test:
             f.close()
             os.rename(md5_path + '.tmp', md5_path)
 
-            for ref in ('crashed', 'failed', 'stderr'):
+            for ref in ('crashed', 'failed', 'stderr', 'perf'):
                 src = os.path.join(out_path, ref)
                 dest = os.path.join(refs_path, ref)
                 try:
@@ -133,7 +137,7 @@ class Test:
 
             md5_file.close()
 
-        for ref in ('crashed', 'failed', 'stderr'):
+        for ref in ('crashed', 'failed', 'stderr', 'perf'):
             result_path = os.path.join(out_path, ref)
             ref_path = os.path.join(refs_path, ref)
 
@@ -183,6 +187,38 @@ class Test:
     def has_stderr(self, test_path):
         return os.path.exists(self.get_stderr(test_path))
 
+    def get_perf(self, test_path):
+        perf_path = os.path.join(test_path, 'perf')
+        if not os.path.exists(perf_path):
+            return None
+
+        perf = {}
+        f = open(perf_path, 'r')
+        for line in f.readlines():
+            key, value = line.strip('\n').split(' ', 1)
+            perf[key] = float(value)
+        f.close()
+
+        return perf
+
+    def compare_perf(self, refs_path, out_path, time_threshold, rss_threshold):
+        '''Returns the reference and result performance data if the
+        result CPU time or peak RSS grew more than the given thresholds,
+        in percent, or None otherwise'''
+        ref_perf = self.get_perf(refs_path)
+        perf = self.get_perf(out_path)
+        if ref_perf is None or perf is None:
+            return None
+
+        time_delta = perf['time'] - ref_perf['time']
+        if time_delta > MIN_TIME_DELTA and time_delta * 100. > ref_perf['time'] * time_threshold:
+            return ref_perf, perf
+
+        if (perf['rss'] - ref_perf['rss']) * 100. > ref_perf['rss'] * rss_threshold:
+            return ref_perf, perf
+
+        return None
+
     def has_diff(self, test_result):
         return os.path.exists(test_result + '.diff.png')
 
@@ -204,11 +240,23 @@ class Test:
 
         return True
 
-    def _check_exit_status(self, p, out_path):
+    def __create_perf_file(self, wall_time, rusage, out_path):
+        # CPU time is used to detect regressions because wall time
+        # depends too much on the load of the other workers
+        perf_file = open(os.path.join(out_path, 'perf'), 'w')
+        perf_file.write("time %f\n" % (rusage.ru_utime + rusage.ru_stime))
+        perf_file.write("wall %f\n" % (wall_time))
+        perf_file.write("rss %d\n" % (rusage.ru_maxrss))
+        perf_file.close()
+
+    def _check_exit_status(self, p, out_path, start_time):
         stderr = p.stderr.read()
-        status = p.wait()
+        pid, status, rusage = os.wait4(p.pid, 0)
+        # The process has already been reaped
+        p.returncode = status
 
         self.__create_stderr_file(stderr, out_path)
+        self.__create_perf_file(time.time() - start_time, rusage, out_path)
 
         if not os.WIFEXITED(status):
             open(os.path.join(out_path, 'crashed'), 'w').close()
@@ -232,7 +280,8 @@ class Test:
 
     def create_refs(self, doc_path, refs_path):
         out_path = os.path.join(refs_path, 'page')
+        start_time = time.time()
         p = subprocess.Popen([self._xpstopng, '-r', '72', doc_path, out_path], stderr = subprocess.PIPE)
-        return self._check_exit_status(p, refs_path)
+        return self._check_exit_status(p, refs_path, start_time)
 
 
@@ -48,6 +48,7 @@ class TestRun:
         self._did_not_crash = []
         self._did_not_fail_status_error = []
         self._stderr = []
+        self._slower = []
         self._new = []
 
         self._queue = Queue()
@@ -80,6 +81,10 @@ class TestRun:
         elif self.config.update_refs:
             self._test.update_results(refs_path, test_path)
 
+        perf_regression = None
+        if test_has_md5:
+            perf_regression = self._test.compare_perf(refs_path, test_path, self.config.time_threshold, self.config.rss_threshold)
+
         with self._lock:
             self._n_tests += 1
             self._n_run += 1
@@ -87,6 +92,12 @@ class TestRun:
             if self._test.has_stderr(test_path):
                 self._stderr.append(doc_path)
 
+            if perf_regression is not None:
+                ref_perf, perf = perf_regression
+                self.printer.print_default("Performance regression in %s: time %.2fs -> %.2fs, peak RSS %d KB -> %d KB" %
+                                           (doc_path, ref_perf['time'], perf['time'], ref_perf['rss'], perf['rss']))
+                self._slower.append(doc_path)
+
             if ref_has_md5 and test_has_md5:
                 if test_passed:
                     # FIXME: remove dir if it's empty?
@@ -211,6 +222,7 @@ class TestRun:
             report_tests(self._crashed, "crashed")
             report_tests(self._failed_status_error, "failed to run")
             report_tests(self._stderr, "have stderr output")
+            report_tests(self._slower, "are slower or use more memory than the references")
             report_tests(self._did_not_crash, "expected to crash, but didn't crash")
             report_tests(self._did_not_fail_status_error, "expected to fail to run, but didn't fail")
         else:
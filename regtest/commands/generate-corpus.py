@@ -0,0 +1,121 @@
+# generate-corpus.py
+#
+# Copyright (C) 2026 libgxps contributors
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+from commands import Command, register_command
+from CorpusGenerator import CorpusParameters, CorpusGenerator, generate_suite
+from Timer import Timer
+from Printer import get_printer
+import os
+import errno
+
+class GenerateCorpus(Command):
+
+    name = 'generate-corpus'
+    usage_args = '[ options ... ] output '
+    description = 'Generate synthetic XPS documents'
+
+    def __init__(self):
+        Command.__init__(self)
+        parser = self._get_args_parser()
+        defaults = CorpusParameters()
+        parser.add_argument('--suite',
+                            action = 'store_true', dest = 'suite', default = False,
+                            help = 'Generate the benchmark suite in the output directory, ignoring the other options but --seed')
+        parser.add_argument('--seed',
+                            action = 'store', dest = 'seed', type = int, default = defaults.seed,
+                            help = 'Seed of the random generator')
+        parser.add_argument('--documents',
+                            action = 'store', dest = 'documents', type = int, default = defaults.documents,
+                            help = 'Number of fixed documents')
+        parser.add_argument('-p', '--pages',
+                            action = 'store', dest = 'pages', type = int, default = defaults.pages,
+                            help = 'Number of pages of every document')
+        parser.add_argument('--paths',
+                            action = 'store', dest = 'paths', type = int, default = defaults.paths,
+                            help = 'Number of paths per page')
+        parser.add_argument('--path-segments',
+                            action = 'store', dest = 'path_segments', type = int, default = defaults.path_segments,
+                            help = 'Number of segments of the path data')
+        parser.add_argument('--glyph-runs',
+                            action = 'store', dest = 'glyph_runs', type = int, default = defaults.glyph_runs,
+                            help = 'Number of glyph runs per page')
+        parser.add_argument('--glyph-run-length',
+                            action = 'store', dest = 'glyph_run_length', type = int, default = defaults.glyph_run_length,
+                            help = 'Number of characters of every glyph run')
+        parser.add_argument('--fonts',
+                            action = 'store', dest = 'fonts', type = int, default = defaults.fonts,
+                            help = 'Number of embedded fonts')
+        parser.add_argument('--obfuscate-fonts',
+                            action = 'store_true', dest = 'obfuscate_fonts', default = defaults.obfuscate_fonts,
+                            help = 'Embed the fonts obfuscated')
+        parser.add_argument('--font-file',
+                            action = 'store', dest = 'font_file', default = defaults.font_file,
+                            help = 'Embed the given font file instead of generating fonts')
+        parser.add_argument('--images',
+                            action = 'store', dest = 'images', type = int, default = defaults.images,
+                            help = 'Number of images per page')
+        parser.add_argument('--per-page-images',
+                            action = 'store_false', dest = 'shared_images', default = defaults.shared_images,
+                            help = 'Use different images in every page instead of sharing them')
+        parser.add_argument('--image-size',
+                            action = 'store', dest = 'image_size',
+                            default = '%dx%d' % (defaults.image_width, defaults.image_height),
+                            help = 'Size of the images as WIDTHxHEIGHT')
+        parser.add_argument('--remote-dictionaries',
+                            action = 'store_true', dest = 'remote_dictionaries', default = defaults.remote_dictionaries,
+                            help = 'Reference geometries and brushes from a remote resource dictionary')
+        parser.add_argument('--dictionary-entries',
+                            action = 'store', dest = 'dictionary_entries', type = int, default = defaults.dictionary_entries,
+                            help = 'Number of geometries and brushes in the remote resource dictionary')
+        parser.add_argument('--piece-size',
+                            action = 'store', dest = 'piece_size', type = int, default = defaults.piece_size,
+                            help = 'Split the pages in interleaved pieces of the given size')
+        parser.add_argument('output')
+
+    def run(self, options):
+        t = Timer()
+        output = options['output']
+
+        if options['suite']:
+            try:
+                os.makedirs(output)
+            except OSError as e:
+                if e.errno != errno.EEXIST:
+                    raise
+            filenames = generate_suite(output, options['seed'])
+            get_printer().printout_ln("%d documents generated in %s" % (len(filenames), t.elapsed_str()))
+            return 0
+
+        params = CorpusParameters()
+        for key in options:
+            if hasattr(params, key):
+                setattr(params, key, options[key])
+        try:
+            width, height = options['image_size'].split('x')
+            params.image_width = int(width)
+            params.image_height = int(height)
+        except ValueError:
+            get_printer().printerr("Invalid image size %s" % (options['image_size']))
+            return 1
+
+        CorpusGenerator(params).write(output)
+        get_printer().printout_ln("%s generated in %s" % (output, t.elapsed_str()))
+
+        return 0
+
+register_command('generate-corpus', GenerateCorpus)
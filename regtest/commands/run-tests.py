@@ -48,6 +48,12 @@ class RunTests(Command):
         parser.add_argument('--update-refs',
                             action = 'store_true', dest = 'update_refs', default = False,
                             help = 'Update references for failed tests')
+        parser.add_argument('--time-threshold', metavar = 'PERCENT',
+                            action = 'store', dest = 'time_threshold', type = float, default = 20.,
+                            help = 'Report tests whose CPU time grows more than the given percentage (Default: 20)')
+        parser.add_argument('--rss-threshold', metavar = 'PERCENT',
+                            action = 'store', dest = 'rss_threshold', type = float, default = 20.,
+                            help = 'Report tests whose peak RSS grows more than the given percentage (Default: 20)')
         parser.add_argument('tests')
 
     def run(self, options):
@@ -55,6 +61,8 @@ class RunTests(Command):
         config.keep_results = options['keep_results']
         config.create_diffs = options['create_diffs']
         config.update_refs = options['update_refs']
+        config.time_threshold = options['time_threshold']
+        config.rss_threshold = options['rss_threshold']
 
         t = Timer()
         doc = options['tests']
@@ -0,0 +1,392 @@
+/* Tests for the vectorized pixel conversions
+ *
+ * Copyright (C) 2026  libgxps contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <glib.h>
+#include <string.h>
+
+#include "gxps-pixels.h"
+
+/* Every vector implementation must give exactly the same result as
+ * the scalar one. Rows of every width up to MAX_PIXELS are converted
+ * starting at every pixel offset up to MAX_OFFSET, so that all the
+ * trailing pixel counts and buffer alignments are covered, and the
+ * bytes after the row are checked to be left untouched.
+ */
+#define MAX_PIXELS 67
+#define MAX_OFFSET 8
+#define BUFFER_SIZE ((MAX_OFFSET + MAX_PIXELS + 1) * 4)
+#define CANARY 0xa5
+
+typedef void (* ConvertFunc) (gpointer dst, gconstpointer src, gsize n_pixels);
+
+typedef struct {
+	const gchar *name;
+	ConvertFunc  convert;
+	guint        src_bpp;
+	guint        dst_bpp;
+	gboolean     premultiplied;
+} Conversion;
+
+static const Conversion conversions[] = {
+	{ "premultiply-rgba", (ConvertFunc)gxps_pixels_premultiply_rgba, 4, 4, FALSE },
+	{ "rgbx-to-xrgb", (ConvertFunc)gxps_pixels_rgbx_to_xrgb, 4, 4, FALSE },
+	{ "rgb-to-xrgb", (ConvertFunc)gxps_pixels_rgb_to_xrgb, 3, 4, FALSE },
+	{ "gray-to-xrgb", (ConvertFunc)gxps_pixels_gray_to_xrgb, 1, 4, FALSE },
+	{ "cmyk-to-xrgb", (ConvertFunc)gxps_pixels_cmyk_to_xrgb, 4, 4, FALSE },
+	{ "abgr-to-argb", (ConvertFunc)gxps_pixels_abgr_to_argb, 4, 4, FALSE },
+	{ "unpremultiply-rgba", (ConvertFunc)gxps_pixels_unpremultiply_rgba, 4, 4, TRUE },
+	{ "xrgb-to-rgbx", (ConvertFunc)gxps_pixels_xrgb_to_rgbx, 4, 4, FALSE }
+};
+
+static const gchar *implementations[] = {
+	"scalar",
+	"sse2",
+	"ssse3",
+	"avx2"
+};
+
+typedef struct {
+	const gchar      *implementation;
+	const Conversion *conversion;
+} PixelsTest;
+
+/* Known results of every conversion, every implementation must give
+ * them. Byte layouts are written as guint8 arrays, and native endian
+ * pixels as guint32 ones.
+ */
+typedef struct {
+	const gchar   *name;
+	gconstpointer  src;
+	gconstpointer  expected;
+	guint          n_pixels;
+} KnownPixels;
+
+/* Fully transparent pixels lose their color, opaque ones are copied,
+ * and the other ones are rounded to the nearest value.
+ */
+static const guint8 premultiply_rgba_src[] = {
+	0x12, 0x34, 0x56, 0x00,
+	0x12, 0x34, 0x56, 0xff,
+	0xff, 0x01, 0x80, 0x80,
+	0xff, 0x80, 0x7f, 0x01,
+	0xff, 0x00, 0x7f, 0xfe
+};
+static const guint32 premultiply_rgba_expected[] = {
+	0x00000000,
+	0xff123456,
+	0x80800140,
+	0x01010100,
+	0xfefe007f
+};
+
+static const guint8 rgbx_to_xrgb_src[] = {
+	0x12, 0x34, 0x56, 0x78,
+	0xff, 0x00, 0x80, 0x00
+};
+static const guint32 rgbx_to_xrgb_expected[] = {
+	0xff123456,
+	0xffff0080
+};
+
+static const guint8 rgb_to_xrgb_src[] = {
+	0x12, 0x34, 0x56,
+	0xff, 0x00, 0x80
+};
+static const guint32 rgb_to_xrgb_expected[] = {
+	0xff123456,
+	0xffff0080
+};
+
+static const guint8 gray_to_xrgb_src[] = {
+	0x00,
+	0x80,
+	0xff
+};
+static const guint32 gray_to_xrgb_expected[] = {
+	0xff000000,
+	0xff808080,
+	0xffffffff
+};
+
+/* Inverted CMYK, every channel is scaled by the black one and truncated */
+static const guint8 cmyk_to_xrgb_src[] = {
+	0xff, 0x80, 0x00, 0xff,
+	0xff, 0x80, 0x40, 0x00,
+	0xff, 0x80, 0x01, 0x80,
+	0x01, 0x02, 0x03, 0xff
+};
+static const guint32 cmyk_to_xrgb_expected[] = {
+	0xffff8000,
+	0xff000000,
+	0xff804000,
+	0xff010203
+};
+
+/* Red and blue are swapped, alpha and green are kept */
+static const guint32 abgr_to_argb_src[] = {
+	0x80112233,
+	0x00ff0000,
+	0xff0000ff
+};
+static const guint32 abgr_to_argb_expected[] = {
+	0x80332211,
+	0x000000ff,
+	0xffff0000
+};
+
+static const guint32 unpremultiply_rgba_src[] = {
+	0x00000000,
+	0xff123456,
+	0x80800140,
+	0x01010100,
+	0xfe7f0100
+};
+static const guint8 unpremultiply_rgba_expected[] = {
+	0x00, 0x00, 0x00, 0x00,
+	0x12, 0x34, 0x56, 0xff,
+	0xff, 0x02, 0x80, 0x80,
+	0xff, 0xff, 0x00, 0x01,
+	0x80, 0x01, 0x00, 0xfe
+};
+
+static const guint32 xrgb_to_rgbx_src[] = {
+	0xff123456,
+	0x00ff0080
+};
+static const guint8 xrgb_to_rgbx_expected[] = {
+	0x12, 0x34, 0x56, 0x00,
+	0xff, 0x00, 0x80, 0x00
+};
+
+/* Every destination pixel is 4 bytes */
+#define KNOWN_PIXELS(name, prefix) \
+	{ name, prefix ## _src, prefix ## _expected, sizeof (prefix ## _expected) / 4 }
+
+static const KnownPixels known_pixels[] = {
+	KNOWN_PIXELS ("premultiply-rgba", premultiply_rgba),
+	KNOWN_PIXELS ("rgbx-to-xrgb", rgbx_to_xrgb),
+	KNOWN_PIXELS ("rgb-to-xrgb", rgb_to_xrgb),
+	KNOWN_PIXELS ("gray-to-xrgb", gray_to_xrgb),
+	KNOWN_PIXELS ("cmyk-to-xrgb", cmyk_to_xrgb),
+	KNOWN_PIXELS ("abgr-to-argb", abgr_to_argb),
+	KNOWN_PIXELS ("unpremultiply-rgba", unpremultiply_rgba),
+	KNOWN_PIXELS ("xrgb-to-rgbx", xrgb_to_rgbx)
+};
+
+/* Random pixels, including fully transparent and fully opaque ones.
+ * Premultiplied pixels never have a color greater than their alpha.
+ */
+static void
+fill_source (guint8  *src,
+	     gboolean premultiplied)
+{
+	guint i;
+
+	if (!premultiplied) {
+		for (i = 0; i < BUFFER_SIZE; i++)
+			src[i] = g_test_rand_int_range (0, 256);
+		return;
+	}
+
+	for (i = 0; i < BUFFER_SIZE / 4; i++) {
+		guint32 alpha, pixel;
+
+		switch (i % 4) {
+		case 0:
+			alpha = 0;
+			break;
+		case 1:
+			alpha = 0xff;
+			break;
+		default:
+			alpha = g_test_rand_int_range (0, 256);
+		}
+
+		pixel = (alpha << 24) |
+			(g_test_rand_int_range (0, alpha + 1) << 16) |
+			(g_test_rand_int_range (0, alpha + 1) << 8) |
+			g_test_rand_int_range (0, alpha + 1);
+		memcpy (src + i * 4, &pixel, 4);
+	}
+}
+
+static PixelsTest *
+pixels_test_new (const gchar      *implementation,
+		 const Conversion *conversion)
+{
+	PixelsTest *test;
+
+	test = g_new (PixelsTest, 1);
+	test->implementation = implementation;
+	test->conversion = conversion;
+
+	return test;
+}
+
+static void
+convert (const Conversion *conversion,
+	 const gchar      *implementation,
+	 guint8           *dst,
+	 const guint8     *src,
+	 gsize             n_pixels)
+{
+	if (!gxps_pixels_set_implementation (implementation))
+		g_error ("%s can't be used", implementation);
+	conversion->convert (dst, src, n_pixels);
+}
+
+static void
+test_pixels_convert (gconstpointer data)
+{
+	const PixelsTest *test = data;
+	const Conversion *conversion = test->conversion;
+	guint8           *src, *expected, *actual;
+	guint             width, src_offset, dst_offset;
+
+	src = g_malloc (BUFFER_SIZE);
+	expected = g_malloc (BUFFER_SIZE);
+	actual = g_malloc (BUFFER_SIZE);
+	fill_source (src, conversion->premultiplied);
+
+	for (width = 0; width <= MAX_PIXELS; width++) {
+		for (src_offset = 0; src_offset <= MAX_OFFSET; src_offset++) {
+			const guint8 *s = src + src_offset * conversion->src_bpp;
+
+			/* The destination is misaligned differently than the source */
+			dst_offset = (src_offset + 3) % (MAX_OFFSET + 1);
+
+			memset (expected, CANARY, BUFFER_SIZE);
+			memset (actual, CANARY, BUFFER_SIZE);
+			convert (conversion, "scalar", expected + dst_offset * 4, s, width);
+			convert (conversion, test->implementation, actual + dst_offset * 4, s, width);
+			if (memcmp (expected, actual, BUFFER_SIZE) != 0)
+				g_error ("%s %s differs from scalar for %u pixels at source offset %u",
+					 test->implementation, conversion->name, width, src_offset);
+
+			if (conversion->src_bpp != conversion->dst_bpp)
+				continue;
+
+			/* Same size pixels can be converted in place */
+			memcpy (actual, src, BUFFER_SIZE);
+			convert (conversion, test->implementation, actual + src_offset * 4,
+				 actual + src_offset * 4, width);
+			memcpy (expected, src, BUFFER_SIZE);
+			convert (conversion, "scalar", expected + src_offset * 4,
+				 expected + src_offset * 4, width);
+			if (memcmp (expected, actual, BUFFER_SIZE) != 0)
+				g_error ("%s %s in place differs from scalar for %u pixels at offset %u",
+					 test->implementation, conversion->name, width, src_offset);
+		}
+	}
+
+	g_free (src);
+	g_free (expected);
+	g_free (actual);
+}
+
+static const KnownPixels *
+lookup_known_pixels (const Conversion *conversion)
+{
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS (known_pixels); i++) {
+		if (strcmp (known_pixels[i].name, conversion->name) == 0)
+			return &known_pixels[i];
+	}
+
+	g_assert_not_reached ();
+	return NULL;
+}
+
+/* The known pixels are repeated to fill a whole row, so that they
+ * go through the vector loops and the trailing pixels alike.
+ */
+static void
+test_pixels_known (gconstpointer data)
+{
+	const PixelsTest  *test = data;
+	const Conversion  *conversion = test->conversion;
+	const KnownPixels *known = lookup_known_pixels (conversion);
+	guint8            *src, *expected, *actual;
+	guint              i;
+
+	src = g_malloc (MAX_PIXELS * conversion->src_bpp);
+	expected = g_malloc (MAX_PIXELS * conversion->dst_bpp);
+	actual = g_malloc (MAX_PIXELS * conversion->dst_bpp);
+
+	for (i = 0; i < MAX_PIXELS; i++) {
+		guint n = i % known->n_pixels;
+
+		memcpy (src + i * conversion->src_bpp,
+			(const guint8 *)known->src + n * conversion->src_bpp,
+			conversion->src_bpp);
+		memcpy (expected + i * conversion->dst_bpp,
+			(const guint8 *)known->expected + n * conversion->dst_bpp,
+			conversion->dst_bpp);
+	}
+
+	convert (conversion, test->implementation, actual, src, MAX_PIXELS);
+	for (i = 0; i < MAX_PIXELS; i++) {
+		if (memcmp (expected + i * conversion->dst_bpp,
+			    actual + i * conversion->dst_bpp,
+			    conversion->dst_bpp) != 0)
+			g_error ("%s %s gives a wrong result for known pixel %u at %u",
+				 test->implementation, conversion->name,
+				 i % known->n_pixels, i);
+	}
+
+	g_free (src);
+	g_free (expected);
+	g_free (actual);
+}
+
+gint main (gint argc, gchar **argv)
+{
+	guint i, j;
+
+	g_test_init (&argc, &argv, NULL);
+
+	for (i = 0; i < G_N_ELEMENTS (implementations); i++) {
+		/* Only the implementations supported by this CPU can be tested */
+		if (!gxps_pixels_set_implementation (implementations[i])) {
+			g_test_message ("%s is not supported, not testing it", implementations[i]);
+			continue;
+		}
+
+		for (j = 0; j < G_N_ELEMENTS (conversions); j++) {
+			gchar *path;
+
+			path = g_strdup_printf ("/pixels/%s/%s/known", implementations[i], conversions[j].name);
+			g_test_add_data_func_full (path, pixels_test_new (implementations[i], &conversions[j]),
+						   test_pixels_known, g_free);
+			g_free (path);
+
+			/* The scalar implementation is the reference of the other ones */
+			if (strcmp (implementations[i], "scalar") == 0)
+				continue;
+
+			path = g_strdup_printf ("/pixels/%s/%s", implementations[i], conversions[j].name);
+			g_test_add_data_func_full (path, pixels_test_new (implementations[i], &conversions[j]),
+						   test_pixels_convert, g_free);
+			g_free (path);
+		}
+	}
+
+	return g_test_run ();
+}
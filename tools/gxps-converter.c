@@ -37,6 +37,7 @@ static guint crop_x = 0.0;
 static guint crop_y = 0.0;
 static guint crop_width = 0.0;
 static guint crop_height = 0.0;
+static gboolean print_stats = FALSE;
 static const char **file_arguments = NULL;
 
 static const GOptionEntry options[] =
@@ -53,6 +54,7 @@ static const GOptionEntry options[] =
         { "crop-y", 'y', 0, G_OPTION_ARG_INT, &crop_y, "Y coordinate of the crop area top left corner", "Y" },
         { "crop-width", 'w', 0, G_OPTION_ARG_INT, &crop_width, "width of crop area in pixels", "WIDTH" },
         { "crop-height", 'h', 0, G_OPTION_ARG_INT, &crop_height, "height of crop area in pixels", "HEIGHT" },
+        { "stats", '\0', 0, G_OPTION_ARG_NONE, &print_stats, "print performance counters", NULL },
         { G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &file_arguments, NULL, "FILE [OUTPUT FILE]" },
         { NULL }
 };
@@ -65,7 +67,6 @@ gxps_converter_real_init_with_args (GXPSConverter *converter,
 {
         GOptionContext *context;
         GFile          *file;
-        GXPSFile       *xps;
         guint           n_pages;
         GList          *group;
         GError         *error = NULL;
@@ -99,18 +100,20 @@ gxps_converter_real_init_with_args (GXPSConverter *converter,
 
         file = g_file_new_for_commandline_arg (file_arguments[0]);
         converter->input_filename = g_file_get_path (file);
-        xps = gxps_file_new (file, &error);
+        converter->file = gxps_file_new (file, &error);
         g_object_unref (file);
-        if (!xps) {
+        if (!converter->file) {
                 g_printerr ("Error creating XPS file: %s\n", error->message);
                 g_error_free (error);
 
                 return FALSE;
         }
 
-        document = CLAMP (document, 1, gxps_file_get_n_documents (xps));
-        converter->document = gxps_file_get_document (xps, document - 1, &error);
-        g_object_unref (xps);
+        if (print_stats)
+                gxps_file_set_stats_enabled (converter->file, TRUE);
+
+        document = CLAMP (document, 1, gxps_file_get_n_documents (converter->file));
+        converter->document = gxps_file_get_document (converter->file, document - 1, &error);
         if (!converter->document) {
                 g_printerr ("Error getting document %d: %s\n", document, error->message);
                 g_error_free (error);
@@ -176,6 +179,26 @@ gxps_converter_end_page (GXPSConverter *converter)
                 converter_class->end_page (converter);
 }
 
+static void
+gxps_converter_real_render_page (GXPSConverter *converter,
+                                 GXPSPage      *page,
+                                 guint          n_page)
+{
+        cairo_t *cr;
+        GError  *error = NULL;
+
+        cr = gxps_converter_begin_page (converter, page, n_page);
+
+        gxps_page_render (page, cr, &error);
+        if (error) {
+                g_printerr ("Error rendering page %d: %s\n", n_page, error->message);
+                g_error_free (error);
+        }
+        cairo_destroy (cr);
+
+        gxps_converter_end_page (converter);
+}
+
 static void
 gxps_converter_end_document (GXPSConverter *converter)
 {
@@ -188,12 +211,73 @@ gxps_converter_end_document (GXPSConverter *converter)
                 converter_class->end_document (converter);
 }
 
+static const gchar *stats_phase_names[GXPS_STATS_N_PHASES] = {
+        "open",
+        "document",
+        "page",
+        "render",
+        "image decode",
+        "font load"
+};
+
+static const gchar *stats_element_names[GXPS_STATS_N_ELEMENTS] = {
+        "Canvas",
+        "Path",
+        "Glyphs",
+        "PathFigure",
+        "SolidColorBrush",
+        "ImageBrush",
+        "LinearGradientBrush",
+        "RadialGradientBrush",
+        "VisualBrush",
+        "ResourceDictionary"
+};
+
+static void
+gxps_converter_print_stats (const gchar *title,
+                            GXPSStats   *stats)
+{
+        guint i;
+
+#define COUNTER(name) gxps_stats_get_counter (stats, GXPS_STATS_COUNTER_ ## name)
+        g_print ("%s\n", title);
+        g_print ("  bytes inflated: %" G_GUINT64_FORMAT "\n", COUNTER (BYTES_INFLATED));
+        g_print ("  entries opened: %" G_GUINT64_FORMAT "\n", COUNTER (ENTRIES_OPENED));
+        g_print ("  font cache: %" G_GUINT64_FORMAT " hits, %" G_GUINT64_FORMAT " misses\n",
+                 COUNTER (FONT_CACHE_HITS), COUNTER (FONT_CACHE_MISSES));
+        g_print ("  image cache: %" G_GUINT64_FORMAT " hits, %" G_GUINT64_FORMAT " misses\n",
+                 COUNTER (IMAGE_CACHE_HITS), COUNTER (IMAGE_CACHE_MISSES));
+        g_print ("  ICC cache: %" G_GUINT64_FORMAT " hits, %" G_GUINT64_FORMAT " misses\n",
+                 COUNTER (ICC_CACHE_HITS), COUNTER (ICC_CACHE_MISSES));
+        g_print ("  resources: %" G_GUINT64_FORMAT " resolved, %" G_GUINT64_FORMAT " not found\n",
+                 COUNTER (RESOURCES_RESOLVED), COUNTER (RESOURCES_UNRESOLVED));
+        g_print ("  push groups: %" G_GUINT64_FORMAT "\n", COUNTER (PUSH_GROUPS));
+#undef COUNTER
+        for (i = 0; i < GXPS_STATS_N_ELEMENTS; i++) {
+                guint64 n_elements = gxps_stats_get_elements (stats, i);
+
+                if (n_elements == 0)
+                        continue;
+                g_print ("  %s elements: %" G_GUINT64_FORMAT "\n",
+                         stats_element_names[i], n_elements);
+        }
+        for (i = 0; i < GXPS_STATS_N_PHASES; i++) {
+                guint64 phase_time = gxps_stats_get_phase_time (stats, i);
+
+                if (phase_time == 0)
+                        continue;
+                g_print ("  %s time: %.3f ms\n",
+                         stats_phase_names[i], phase_time / 1000.0);
+        }
+}
+
 static void
 gxps_converter_finalize (GObject *object)
 {
         GXPSConverter *converter = GXPS_CONVERTER (object);
 
         g_clear_object (&converter->document);
+        g_clear_object (&converter->file);
         g_clear_object (&converter->surface);
         g_clear_pointer (&converter->input_filename, g_free);
 
@@ -211,6 +295,7 @@ gxps_converter_class_init (GXPSConverterClass *klass)
         GObjectClass *object_class = G_OBJECT_CLASS (klass);
 
         klass->init_with_args = gxps_converter_real_init_with_args;
+        klass->render_page = gxps_converter_real_render_page;
 
         object_class->finalize = gxps_converter_finalize;
 }
@@ -282,7 +367,6 @@ gxps_converter_run (GXPSConverter *converter)
 
         for (i = first_page; i <= converter->last_page; i++) {
                 GXPSPage *page;
-                cairo_t  *cr;
                 GError   *error;
 
                 if (converter->only_even && i % 2 == 0)
@@ -314,20 +398,34 @@ gxps_converter_run (GXPSConverter *converter)
                         g_free (output_filename);
                 }
 
-                cr = gxps_converter_begin_page (converter, page, i);
+                GXPS_CONVERTER_GET_CLASS (converter)->render_page (converter, page, i);
 
-                error = NULL;
-                gxps_page_render (page, cr, &error);
-                if (error) {
-                        g_printerr ("Error rendering page %d: %s\n", i, error->message);
-                        g_error_free (error);
-                }
-                cairo_destroy (cr);
+                if (print_stats) {
+                        GXPSStats *stats;
+
+                        stats = gxps_page_get_stats (page);
+                        if (stats) {
+                                gchar *title;
 
-                gxps_converter_end_page (converter);
+                                title = g_strdup_printf ("Page %d", i);
+                                gxps_converter_print_stats (title, stats);
+                                g_free (title);
+                                gxps_stats_free (stats);
+                        }
+                }
 
                 g_object_unref (page);
         }
 
         gxps_converter_end_document (converter);
+
+        if (print_stats) {
+                GXPSStats *stats;
+
+                stats = gxps_file_get_stats (converter->file);
+                if (stats) {
+                        gxps_converter_print_stats ("Total", stats);
+                        gxps_stats_free (stats);
+                }
+        }
 }
@@ -38,6 +38,7 @@ typedef struct _GXPSConverterClass   GXPSConverterClass;
 struct _GXPSConverter {
 	GObject parent;
 
+        GXPSFile        *file;
         GXPSDocument    *document;
         cairo_surface_t *surface;
         gchar           *input_filename;
@@ -66,6 +67,9 @@ struct _GXPSConverterClass {
                                           GXPSPage      *page,
                                           guint          n_page);
         void         (* end_page)        (GXPSConverter *converter);
+        void         (* render_page)     (GXPSConverter *converter,
+                                          GXPSPage      *page,
+                                          guint          n_page);
         void         (* end_document)    (GXPSConverter *converter);
 
         const gchar *(* get_extension)   (GXPSConverter *converter);
@@ -27,6 +27,78 @@
 
 G_DEFINE_ABSTRACT_TYPE (GXPSImageConverter, gxps_image_converter, GXPS_TYPE_CONVERTER)
 
+static gint band_height = 0;
+static gboolean print_encode_time = FALSE;
+
+/* 0 means the option wasn't given, so any height given must be positive */
+static gboolean
+parse_band_height (const gchar *option_name,
+                   const gchar *value,
+                   gpointer     data,
+                   GError     **error)
+{
+        gchar  *end;
+        gint64  height;
+
+        height = g_ascii_strtoll (value, &end, 10);
+        if (end == value || *end != '\0' || height <= 0 || height > G_MAXINT) {
+                g_set_error (error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+                             "invalid band height %s, it must be a positive number of pixels", value);
+                return FALSE;
+        }
+
+        band_height = height;
+
+        return TRUE;
+}
+
+static const GOptionEntry options[] =
+{
+        { "band-height", 'b', G_OPTION_FLAG_IN_MAIN, G_OPTION_ARG_CALLBACK, parse_band_height, "render pages in bands of HEIGHT pixels to reduce memory use [default: whole page]", "HEIGHT" },
+        { "encode-time", '\0', G_OPTION_FLAG_IN_MAIN, G_OPTION_ARG_NONE, &print_encode_time, "print the time spent encoding every page", NULL },
+        { NULL }
+};
+
+static gboolean
+gxps_image_converter_init_with_args (GXPSConverter *converter,
+                                     gint          *argc,
+                                     gchar       ***argv,
+                                     GList        **option_groups)
+{
+        GXPSImageConverter *image_converter = GXPS_IMAGE_CONVERTER (converter);
+        GOptionContext     *context;
+        GOptionGroup       *option_group;
+        GError             *error = NULL;
+
+        option_group = g_option_group_new ("image", "Image Options", "Show Image Options", NULL, NULL);
+        g_option_group_add_entries (option_group, options);
+
+        *option_groups = g_list_prepend (*option_groups, option_group);
+
+        if (GXPS_CONVERTER_CLASS (gxps_image_converter_parent_class)->init_with_args) {
+                if (!GXPS_CONVERTER_CLASS (gxps_image_converter_parent_class)->init_with_args (converter, argc, argv, option_groups))
+                        return FALSE;
+        }
+
+        context = g_option_context_new (NULL);
+        g_option_context_set_ignore_unknown_options (context, TRUE);
+        g_option_context_set_help_enabled (context, FALSE);
+        g_option_context_add_main_entries (context, options, NULL);
+        if (!g_option_context_parse (context, argc, argv, &error)) {
+                g_printerr ("Error parsing arguments: %s\n", error->message);
+                g_error_free (error);
+                g_option_context_free (context);
+
+                return FALSE;
+        }
+        g_option_context_free (context);
+
+        image_converter->band_height = band_height;
+        image_converter->print_encode_time = print_encode_time;
+
+        return TRUE;
+}
+
 static guint
 get_n_digits (GXPSDocument *document)
 {
@@ -52,30 +124,31 @@ gxps_converter_image_converter_begin_document (GXPSConverter *converter,
         image_converter->n_digits = get_n_digits (converter->document);
 }
 
-static cairo_t *
-gxps_converter_image_converter_begin_page (GXPSConverter *converter,
-                                           GXPSPage      *page,
-                                           guint          n_page)
+static void
+gxps_image_converter_get_output_size (GXPSConverter *converter,
+                                      GXPSPage      *page,
+                                      guint         *width,
+                                      guint         *height)
 {
-        GXPSImageConverter *image_converter = GXPS_IMAGE_CONVERTER (converter);
-        gdouble             page_width, page_height;
-        gdouble             output_width, output_height;
-        cairo_t            *cr;
-
-        g_return_val_if_fail (converter->surface == NULL, NULL);
-
-        image_converter->current_page = n_page;
+        gdouble page_width, page_height;
+        gdouble output_width, output_height;
 
         gxps_page_get_size (page, &page_width, &page_height);
         gxps_converter_get_crop_size (converter,
                                       page_width * (converter->x_resolution / 96.0),
                                       page_height * (converter->y_resolution / 96.0),
                                       &output_width, &output_height);
-        converter->surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
-                                                         ceil (output_width),
-                                                         ceil (output_height));
+        *width = ceil (output_width);
+        *height = ceil (output_height);
+}
 
-        cr = cairo_create (converter->surface);
+/* Sets up @cr to render the rows of the page starting at @y */
+static void
+gxps_image_converter_setup_cairo (GXPSConverter *converter,
+                                  cairo_t       *cr,
+                                  guint          y)
+{
+        GXPSImageConverter *image_converter = GXPS_IMAGE_CONVERTER (converter);
 
         if (image_converter->fill_background) {
                 cairo_save (cr);
@@ -84,32 +157,45 @@ gxps_converter_image_converter_begin_page (GXPSConverter *converter,
                 cairo_restore (cr);
         }
 
-        cairo_translate (cr, -converter->crop.x, -converter->crop.y);
+        cairo_translate (cr, -converter->crop.x, -converter->crop.y - (gdouble)y);
         cairo_scale (cr, converter->x_resolution / 96.0, converter->y_resolution / 96.0);
-
-        return cr;
 }
 
-static void
-gxps_converter_image_converter_end_page (GXPSConverter *converter)
+static cairo_t *
+gxps_converter_image_converter_begin_page (GXPSConverter *converter,
+                                           GXPSPage      *page,
+                                           guint          n_page)
 {
         GXPSImageConverter *image_converter = GXPS_IMAGE_CONVERTER (converter);
-        cairo_status_t      status;
-        const gchar        *extension = gxps_converter_get_extension (converter);
-        gchar              *page_filename;
-        FILE               *fd;
         guint               width, height;
-        gint                stride;
-        guchar             *data;
-        gint                y;
+        cairo_t            *cr;
 
-        g_return_if_fail (converter->surface != NULL);
-        g_return_if_fail (GXPS_IS_IMAGE_WRITER (image_converter->writer));
+        g_return_val_if_fail (converter->surface == NULL, NULL);
 
-        width = cairo_image_surface_get_width (converter->surface);
-        height = cairo_image_surface_get_height (converter->surface);
-        stride = cairo_image_surface_get_stride (converter->surface);
-        data = cairo_image_surface_get_data (converter->surface);
+        image_converter->current_page = n_page;
+
+        gxps_image_converter_get_output_size (converter, page, &width, &height);
+        converter->surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
+
+        cr = cairo_create (converter->surface);
+        gxps_image_converter_setup_cairo (converter, cr, 0);
+
+        return cr;
+}
+
+/* Opens the output file of the current page and initializes the
+ * image writer for it, returns %NULL on error.
+ */
+static FILE *
+gxps_image_converter_open_page_file (GXPSImageConverter *image_converter,
+                                     guint               width,
+                                     guint               height)
+{
+        GXPSConverter *converter = GXPS_CONVERTER (image_converter);
+        const gchar   *extension = gxps_converter_get_extension (converter);
+        gchar         *page_filename;
+        FILE          *fd;
+        gint64         start;
 
         page_filename = g_strdup_printf ("%s-%0*d.%s",
                                          image_converter->page_prefix,
@@ -122,29 +208,83 @@ gxps_converter_image_converter_end_page (GXPSConverter *converter)
                 g_printerr ("Error opening output file %s\n", page_filename);
                 g_free (page_filename);
 
-                cairo_surface_destroy (converter->surface);
-                converter->surface = NULL;
-
-                return;
+                return NULL;
         }
+
+        start = g_get_monotonic_time ();
         if (!gxps_image_writer_init (image_converter->writer, fd, width, height,
                                      converter->x_resolution, converter->y_resolution)) {
                 g_printerr ("Error writing %s\n", page_filename);
                 g_free (page_filename);
                 fclose (fd);
 
+                return NULL;
+        }
+        image_converter->encode_time = g_get_monotonic_time () - start;
+        g_free (page_filename);
+
+        return fd;
+}
+
+static void
+gxps_image_converter_write_rows (GXPSImageConverter *image_converter,
+                                 guchar             *data,
+                                 gint                stride,
+                                 guint               n_rows)
+{
+        gint64 start = g_get_monotonic_time ();
+        guint  i;
+
+        for (i = 0; i < n_rows; i++)
+                gxps_image_writer_write (image_converter->writer, data + i * stride);
+
+        image_converter->encode_time += g_get_monotonic_time () - start;
+}
+
+static void
+gxps_image_converter_close_page_file (GXPSImageConverter *image_converter,
+                                      FILE               *fd)
+{
+        gint64 start = g_get_monotonic_time ();
+
+        gxps_image_writer_finish (image_converter->writer);
+        fclose (fd);
+
+        image_converter->encode_time += g_get_monotonic_time () - start;
+        if (image_converter->print_encode_time) {
+                g_print ("Page %u encoded in %.3f ms\n", image_converter->current_page,
+                         image_converter->encode_time / 1000.);
+        }
+}
+
+static void
+gxps_converter_image_converter_end_page (GXPSConverter *converter)
+{
+        GXPSImageConverter *image_converter = GXPS_IMAGE_CONVERTER (converter);
+        cairo_status_t      status;
+        FILE               *fd;
+        guint               width, height;
+        gint                stride;
+        guchar             *data;
+
+        g_return_if_fail (converter->surface != NULL);
+        g_return_if_fail (GXPS_IS_IMAGE_WRITER (image_converter->writer));
+
+        width = cairo_image_surface_get_width (converter->surface);
+        height = cairo_image_surface_get_height (converter->surface);
+        stride = cairo_image_surface_get_stride (converter->surface);
+        data = cairo_image_surface_get_data (converter->surface);
+
+        fd = gxps_image_converter_open_page_file (image_converter, width, height);
+        if (!fd) {
                 cairo_surface_destroy (converter->surface);
                 converter->surface = NULL;
 
                 return;
         }
 
-        for (y = 0; y < height; y++)
-                gxps_image_writer_write (image_converter->writer, data + y * stride);
-
-        gxps_image_writer_finish (image_converter->writer);
-        fclose (fd);
-        g_free (page_filename);
+        gxps_image_converter_write_rows (image_converter, data, stride, height);
+        gxps_image_converter_close_page_file (image_converter, fd);
 
         cairo_surface_finish (converter->surface);
         status = cairo_surface_status (converter->surface);
@@ -154,6 +294,89 @@ gxps_converter_image_converter_end_page (GXPSConverter *converter)
         converter->surface = NULL;
 }
 
+/* Renders the page in horizontal bands of band_height rows into the
+ * same surface, writing every band before rendering the next one. The
+ * page is parsed once per band, but only a band is kept in memory.
+ */
+static void
+gxps_image_converter_render_page (GXPSConverter *converter,
+                                  GXPSPage      *page,
+                                  guint          n_page)
+{
+        GXPSImageConverter *image_converter = GXPS_IMAGE_CONVERTER (converter);
+        cairo_surface_t    *surface;
+        cairo_status_t      status;
+        FILE               *fd;
+        guint               width, height;
+        guint               rows, y;
+        gint                stride;
+        guchar             *data;
+
+        image_converter->current_page = n_page;
+        gxps_image_converter_get_output_size (converter, page, &width, &height);
+
+        if (image_converter->band_height == 0 || image_converter->band_height >= height) {
+                GXPS_CONVERTER_CLASS (gxps_image_converter_parent_class)->render_page (converter, page, n_page);
+                return;
+        }
+
+        g_return_if_fail (GXPS_IS_IMAGE_WRITER (image_converter->writer));
+
+        surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, image_converter->band_height);
+        status = cairo_surface_status (surface);
+        if (status) {
+                g_printerr ("Cairo error: %s\n", cairo_status_to_string (status));
+                cairo_surface_destroy (surface);
+
+                return;
+        }
+
+        fd = gxps_image_converter_open_page_file (image_converter, width, height);
+        if (!fd) {
+                cairo_surface_destroy (surface);
+
+                return;
+        }
+
+        stride = cairo_image_surface_get_stride (surface);
+        data = cairo_image_surface_get_data (surface);
+
+        for (y = 0; y < height; y += rows) {
+                cairo_t *cr;
+                GError  *error = NULL;
+
+                rows = MIN (image_converter->band_height, height - y);
+
+                cr = cairo_create (surface);
+                cairo_save (cr);
+                cairo_set_operator (cr, CAIRO_OPERATOR_CLEAR);
+                cairo_paint (cr);
+                cairo_restore (cr);
+
+                cairo_rectangle (cr, 0, 0, width, rows);
+                cairo_clip (cr);
+                gxps_image_converter_setup_cairo (converter, cr, y);
+
+                gxps_page_render (page, cr, &error);
+                if (error) {
+                        g_printerr ("Error rendering page %d: %s\n", n_page, error->message);
+                        g_error_free (error);
+                }
+                cairo_destroy (cr);
+
+                cairo_surface_flush (surface);
+                gxps_image_converter_write_rows (image_converter, data, stride, rows);
+        }
+
+        gxps_image_converter_close_page_file (image_converter, fd);
+
+        cairo_surface_finish (surface);
+        status = cairo_surface_status (surface);
+        if (status)
+                g_printerr ("Cairo error: %s\n", cairo_status_to_string (status));
+        cairo_surface_destroy (surface);
+}
+
 static void
 gxps_image_converter_finalize (GObject *object)
 {
@@ -181,8 +404,10 @@ gxps_image_converter_class_init (GXPSImageConverterClass *klass)
 
         object_class->finalize = gxps_image_converter_finalize;
 
+        converter_class->init_with_args = gxps_image_converter_init_with_args;
         converter_class->begin_document = gxps_converter_image_converter_begin_document;
         converter_class->begin_page = gxps_converter_image_converter_begin_page;
         converter_class->end_page = gxps_converter_image_converter_end_page;
+        converter_class->render_page = gxps_image_converter_render_page;
 }
 
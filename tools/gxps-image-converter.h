@@ -42,7 +42,10 @@ struct _GXPSImageConverter {
         guint            current_page;
         gchar           *page_prefix;
         guint            n_digits;
-        guint            fill_background : 1;
+        guint            band_height;
+        gint64           encode_time;
+        guint            fill_background   : 1;
+        guint            print_encode_time : 1;
 };
 
 struct _GXPSImageConverterClass {
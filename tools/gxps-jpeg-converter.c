@@ -40,14 +40,16 @@ gxps_jpeg_converter_get_extension (GXPSConverter *converter)
 }
 
 static void
-gxps_jpeg_converter_end_page (GXPSConverter *converter)
+gxps_jpeg_converter_begin_document (GXPSConverter *converter,
+                                    const gchar   *output_filename,
+                                    GXPSPage      *first_page)
 {
         GXPSImageConverter *image_converter = GXPS_IMAGE_CONVERTER (converter);
 
         if (!image_converter->writer)
                 image_converter->writer = gxps_jpeg_writer_new ();
 
-        GXPS_CONVERTER_CLASS (gxps_jpeg_converter_parent_class)->end_page (converter);
+        GXPS_CONVERTER_CLASS (gxps_jpeg_converter_parent_class)->begin_document (converter, output_filename, first_page);
 }
 
 static void
@@ -61,5 +63,5 @@ gxps_jpeg_converter_class_init (GXPSJpegConverterClass *klass)
         GXPSConverterClass *converter_class = GXPS_CONVERTER_CLASS (klass);
 
         converter_class->get_extension = gxps_jpeg_converter_get_extension;
-        converter_class->end_page = gxps_jpeg_converter_end_page;
+        converter_class->begin_document = gxps_jpeg_converter_begin_document;
 }
@@ -27,7 +27,11 @@
 struct _GXPSPngConverter {
 	GXPSImageConverter parent;
 
-        guint bg_transparent : 1;
+        gint            compression_level;
+        GXPSPngFilter   filter;
+        GXPSPngStrategy strategy;
+        guint           n_threads;
+        guint           bg_transparent : 1;
 };
 
 struct _GXPSPngConverterClass {
@@ -37,10 +41,40 @@ struct _GXPSPngConverterClass {
 G_DEFINE_TYPE (GXPSPngConverter, gxps_png_converter, GXPS_TYPE_IMAGE_CONVERTER)
 
 static gboolean bg_transparent = FALSE;
+static gint compression_level = 9;
+static gchar *filter = NULL;
+static gchar *strategy = NULL;
+static gint n_threads = 1;
+
+static const struct {
+        const gchar  *name;
+        GXPSPngFilter filter;
+} png_filters[] = {
+        { "none",     GXPS_PNG_FILTER_NONE },
+        { "sub",      GXPS_PNG_FILTER_SUB },
+        { "up",       GXPS_PNG_FILTER_UP },
+        { "average",  GXPS_PNG_FILTER_AVERAGE },
+        { "paeth",    GXPS_PNG_FILTER_PAETH },
+        { "adaptive", GXPS_PNG_FILTER_ADAPTIVE }
+};
+
+static const struct {
+        const gchar    *name;
+        GXPSPngStrategy strategy;
+} png_strategies[] = {
+        { "default",  GXPS_PNG_STRATEGY_DEFAULT },
+        { "filtered", GXPS_PNG_STRATEGY_FILTERED },
+        { "rle",      GXPS_PNG_STRATEGY_RLE },
+        { "huffman",  GXPS_PNG_STRATEGY_HUFFMAN_ONLY }
+};
 
 static const GOptionEntry options[] =
 {
         { "transparent-bg", 't', G_OPTION_FLAG_IN_MAIN, G_OPTION_ARG_NONE, &bg_transparent, "use a transparent background instead of white", NULL },
+        { "compression-level", 'c', G_OPTION_FLAG_IN_MAIN, G_OPTION_ARG_INT, &compression_level, "compression level from 0 (fastest) to 9 (smallest) [default: 9]", "LEVEL" },
+        { "filter", '\0', G_OPTION_FLAG_IN_MAIN, G_OPTION_ARG_STRING, &filter, "row filter (none, sub, up, average, paeth or adaptive) [default: adaptive]", "FILTER" },
+        { "strategy", '\0', G_OPTION_FLAG_IN_MAIN, G_OPTION_ARG_STRING, &strategy, "zlib strategy (default, filtered, rle or huffman) [default: default]", "STRATEGY" },
+        { "threads", 'j', G_OPTION_FLAG_IN_MAIN, G_OPTION_ARG_INT, &n_threads, "number of threads used to compress every page, 0 for one per CPU [default: 1]", "THREADS" },
         { NULL }
 };
 
@@ -78,7 +112,58 @@ gxps_png_converter_init_with_args (GXPSConverter *converter,
         }
         g_option_context_free (context);
 
+        if (compression_level < 0 || compression_level > 9) {
+                g_printerr ("Error parsing arguments: invalid compression level %d\n", compression_level);
+
+                return FALSE;
+        }
+
+        png_converter->filter = GXPS_PNG_FILTER_ADAPTIVE;
+        if (filter) {
+                guint i;
+
+                for (i = 0; i < G_N_ELEMENTS (png_filters); i++) {
+                        if (g_ascii_strcasecmp (filter, png_filters[i].name) == 0)
+                                break;
+                }
+
+                if (i == G_N_ELEMENTS (png_filters)) {
+                        g_printerr ("Error parsing arguments: invalid filter %s\n", filter);
+                        g_free (filter);
+
+                        return FALSE;
+                }
+
+                png_converter->filter = png_filters[i].filter;
+                g_free (filter);
+                filter = NULL;
+        }
+
+        png_converter->strategy = GXPS_PNG_STRATEGY_DEFAULT;
+        if (strategy) {
+                guint i;
+
+                for (i = 0; i < G_N_ELEMENTS (png_strategies); i++) {
+                        if (g_ascii_strcasecmp (strategy, png_strategies[i].name) == 0)
+                                break;
+                }
+
+                if (i == G_N_ELEMENTS (png_strategies)) {
+                        g_printerr ("Error parsing arguments: invalid strategy %s\n", strategy);
+                        g_free (strategy);
+                        strategy = NULL;
+
+                        return FALSE;
+                }
+
+                png_converter->strategy = png_strategies[i].strategy;
+                g_free (strategy);
+                strategy = NULL;
+        }
+
         png_converter->bg_transparent = bg_transparent;
+        png_converter->compression_level = compression_level;
+        png_converter->n_threads = n_threads > 0 ? n_threads : g_get_num_processors ();
 
         return TRUE;
 }
@@ -98,22 +183,19 @@ gxps_png_converter_begin_document (GXPSConverter *converter,
         GXPSImageConverter *image_converter = GXPS_IMAGE_CONVERTER (converter);
 
         image_converter->fill_background = !png_converter->bg_transparent;
-        GXPS_CONVERTER_CLASS (gxps_png_converter_parent_class)->begin_document (converter, output_filename, first_page);
-}
-
-static void
-gxps_png_converter_end_page (GXPSConverter *converter)
-{
-        GXPSImageConverter *image_converter = GXPS_IMAGE_CONVERTER (converter);
-        GXPSPngConverter   *png_converter = GXPS_PNG_CONVERTER (converter);
-
         if (!image_converter->writer) {
                 GXPSPngFormat format = png_converter->bg_transparent ? GXPS_PNG_FORMAT_RGBA : GXPS_PNG_FORMAT_RGB;
 
                 image_converter->writer = gxps_png_writer_new (format);
+                gxps_png_writer_set_compression (GXPS_PNG_WRITER (image_converter->writer),
+                                                 png_converter->compression_level,
+                                                 png_converter->filter,
+                                                 png_converter->strategy);
+                gxps_png_writer_set_n_threads (GXPS_PNG_WRITER (image_converter->writer),
+                                               png_converter->n_threads);
         }
 
-        GXPS_CONVERTER_CLASS (gxps_png_converter_parent_class)->end_page (converter);
+        GXPS_CONVERTER_CLASS (gxps_png_converter_parent_class)->begin_document (converter, output_filename, first_page);
 }
 
 static void
@@ -129,5 +211,4 @@ gxps_png_converter_class_init (GXPSPngConverterClass *klass)
         converter_class->init_with_args = gxps_png_converter_init_with_args;
         converter_class->get_extension = gxps_png_converter_get_extension;
         converter_class->begin_document = gxps_png_converter_begin_document;
-        converter_class->end_page = gxps_png_converter_end_page;
 }
@@ -20,22 +20,64 @@
 #include <config.h>
 
 #include "gxps-png-writer.h"
+#include "gxps-pixels.h"
 #include <png.h>
-#include <stdint.h>
+#include <zlib.h>
 #include <string.h>
 
-/* starting with libpng15, png.h no longer #includes zlib.h */
-#ifndef Z_BEST_COMPRESSION
-#define Z_BEST_COMPRESSION 9
-#endif
+/* When more than one thread is used, the filtered rows are split in
+ * blocks of about BLOCK_SIZE bytes that are deflated independently and
+ * written as consecutive IDAT chunks, like pigz does for gzip streams.
+ * Every block is primed with the last DICT_SIZE bytes of the previous
+ * one, so the compression ratio is almost the same as the serial one.
+ */
+#define BLOCK_SIZE (128 * 1024)
+#define DICT_SIZE  32768
+
+typedef struct {
+        guchar  *data;
+        gsize    data_len;
+        guchar  *output;
+        gsize    output_len;
+        guchar   dict[DICT_SIZE];
+        gsize    dict_len;
+        guint32  adler;
+        gboolean first;
+        gboolean last;
+        gboolean done;
+        gboolean failed;
+} GXPSPngBlock;
 
 struct _GXPSPngWriter {
 	GObject parent;
 
         GXPSPngFormat format;
+        gint          compression_level;
+        GXPSPngFilter filter;
+        gint          strategy;
+        guint         n_threads;
 
         png_structp   png_ptr;
         png_infop     info_ptr;
+
+        /* Parallel encoding */
+        GThreadPool  *pool;
+        GMutex        mutex;
+        GCond         cond;
+        GQueue       *blocks;
+        GXPSPngBlock *block;
+        gsize         block_size;
+        guint         n_blocks;
+        guchar        dict[DICT_SIZE];
+        gsize         dict_len;
+        guint32       adler;
+
+        guint         bpp;
+        gsize         rowbytes;
+        guchar       *row;
+        guchar       *prev_row;
+        guchar       *scratch;
+        guint         rows_left;
 };
 
 struct _GXPSPngWriterClass {
@@ -48,14 +90,97 @@ G_DEFINE_TYPE_WITH_CODE (GXPSPngWriter, gxps_png_writer, G_TYPE_OBJECT,
                          G_IMPLEMENT_INTERFACE (GXPS_TYPE_IMAGE_WRITER,
                                                 gxps_png_writer_image_writer_iface_init))
 
+static png_byte png_IDAT[5] = { 'I', 'D', 'A', 'T', '\0' };
+static png_byte png_IEND[5] = { 'I', 'E', 'N', 'D', '\0' };
+
+static GXPSPngBlock *
+gxps_png_block_new (gsize size)
+{
+        GXPSPngBlock *block;
+
+        block = g_slice_new0 (GXPSPngBlock);
+        block->data = g_malloc (size);
+
+        return block;
+}
+
+static void
+gxps_png_block_free (GXPSPngBlock *block)
+{
+        if (G_UNLIKELY (!block))
+                return;
+
+        g_free (block->data);
+        g_free (block->output);
+        g_slice_free (GXPSPngBlock, block);
+}
+
+/* Waits for the blocks still being compressed and releases all the
+ * state of the image being encoded in parallel.
+ */
+static void
+gxps_png_writer_reset (GXPSPngWriter *png_writer)
+{
+        GXPSPngBlock *block;
+
+        if (png_writer->blocks) {
+                while ((block = g_queue_pop_head (png_writer->blocks))) {
+                        g_mutex_lock (&png_writer->mutex);
+                        while (!block->done)
+                                g_cond_wait (&png_writer->cond, &png_writer->mutex);
+                        g_mutex_unlock (&png_writer->mutex);
+                        gxps_png_block_free (block);
+                }
+        }
+
+        gxps_png_block_free (png_writer->block);
+        png_writer->block = NULL;
+
+        g_free (png_writer->row);
+        png_writer->row = NULL;
+        g_free (png_writer->prev_row);
+        png_writer->prev_row = NULL;
+        g_free (png_writer->scratch);
+        png_writer->scratch = NULL;
+}
+
+static void
+gxps_png_writer_finalize (GObject *object)
+{
+        GXPSPngWriter *png_writer = GXPS_PNG_WRITER (object);
+
+        gxps_png_writer_reset (png_writer);
+        if (png_writer->pool)
+                g_thread_pool_free (png_writer->pool, FALSE, TRUE);
+        if (png_writer->blocks)
+                g_queue_free (png_writer->blocks);
+        g_mutex_clear (&png_writer->mutex);
+        g_cond_clear (&png_writer->cond);
+
+        if (png_writer->png_ptr)
+                png_destroy_write_struct (&png_writer->png_ptr, &png_writer->info_ptr);
+
+        G_OBJECT_CLASS (gxps_png_writer_parent_class)->finalize (object);
+}
+
 static void
 gxps_png_writer_init (GXPSPngWriter *png_writer)
 {
+        png_writer->compression_level = Z_BEST_COMPRESSION;
+        png_writer->filter = GXPS_PNG_FILTER_ADAPTIVE;
+        png_writer->strategy = Z_DEFAULT_STRATEGY;
+        png_writer->n_threads = 1;
+
+        g_mutex_init (&png_writer->mutex);
+        g_cond_init (&png_writer->cond);
 }
 
 static void
 gxps_png_writer_class_init (GXPSPngWriterClass *klass)
 {
+        GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+        object_class->finalize = gxps_png_writer_finalize;
 }
 
 GXPSImageWriter *
@@ -68,47 +193,480 @@ gxps_png_writer_new (GXPSPngFormat format)
         return GXPS_IMAGE_WRITER (png_writer);
 }
 
+void
+gxps_png_writer_set_compression (GXPSPngWriter  *png_writer,
+                                 gint            level,
+                                 GXPSPngFilter   filter,
+                                 GXPSPngStrategy strategy)
+{
+        g_return_if_fail (GXPS_IS_PNG_WRITER (png_writer));
+        g_return_if_fail (level >= Z_NO_COMPRESSION && level <= Z_BEST_COMPRESSION);
+
+        png_writer->compression_level = level;
+        png_writer->filter = filter;
+
+        switch (strategy) {
+        case GXPS_PNG_STRATEGY_DEFAULT:
+                png_writer->strategy = Z_DEFAULT_STRATEGY;
+                break;
+        case GXPS_PNG_STRATEGY_FILTERED:
+                png_writer->strategy = Z_FILTERED;
+                break;
+        case GXPS_PNG_STRATEGY_RLE:
+                png_writer->strategy = Z_RLE;
+                break;
+        case GXPS_PNG_STRATEGY_HUFFMAN_ONLY:
+                png_writer->strategy = Z_HUFFMAN_ONLY;
+                break;
+        }
+}
+
+void
+gxps_png_writer_set_n_threads (GXPSPngWriter *png_writer,
+                               guint          n_threads)
+{
+        g_return_if_fail (GXPS_IS_PNG_WRITER (png_writer));
+
+        png_writer->n_threads = MAX (n_threads, 1);
+        if (png_writer->pool && png_writer->n_threads > 1)
+                g_thread_pool_set_max_threads (png_writer->pool, png_writer->n_threads, NULL);
+}
+
 /* Unpremultiplies data and converts native endian ARGB => RGBA bytes */
 static void
 unpremultiply_data (png_structp png, png_row_infop row_info, png_bytep data)
 {
-        unsigned int i;
-
-        for (i = 0; i < row_info->rowbytes; i += 4) {
-                uint8_t *b = &data[i];
-                uint32_t pixel;
-                uint8_t  alpha;
-
-                memcpy (&pixel, b, sizeof (uint32_t));
-                alpha = (pixel & 0xff000000) >> 24;
-                if (alpha == 0) {
-                        b[0] = b[1] = b[2] = b[3] = 0;
-                } else {
-                        b[0] = (((pixel & 0xff0000) >> 16) * 255 + alpha / 2) / alpha;
-                        b[1] = (((pixel & 0x00ff00) >>  8) * 255 + alpha / 2) / alpha;
-                        b[2] = (((pixel & 0x0000ff) >>  0) * 255 + alpha / 2) / alpha;
-                        b[3] = alpha;
-                }
-        }
+        gxps_pixels_unpremultiply_rgba (data, (guint32 *)data, row_info->rowbytes / 4);
 }
 
 /* Converts native endian xRGB => RGBx bytes */
 static void
 convert_data_to_bytes (png_structp png, png_row_infop row_info, png_bytep data)
 {
-        unsigned int i;
+        gxps_pixels_xrgb_to_rgbx (data, (guint32 *)data, row_info->rowbytes / 4);
+}
+
+/* Converts native endian xRGB => RGB bytes */
+static void
+convert_data_to_rgb (guchar        *dst,
+                     const guint32 *src,
+                     gsize          n_pixels)
+{
+        gsize i;
+
+        for (i = 0; i < n_pixels; i++) {
+                guint32 pixel = src[i];
+
+                dst[0] = (pixel >> 16) & 0xff;
+                dst[1] = (pixel >> 8) & 0xff;
+                dst[2] = pixel & 0xff;
+                dst += 3;
+        }
+}
+
+static guchar
+paeth_predictor (guchar a,
+                 guchar b,
+                 guchar c)
+{
+        gint p = a + b - c;
+        gint pa = ABS (p - a);
+        gint pb = ABS (p - b);
+        gint pc = ABS (p - c);
+
+        if (pa <= pb && pa <= pc)
+                return a;
+        if (pb <= pc)
+                return b;
+        return c;
+}
+
+/* Writes the filter type byte followed by row filtered with it */
+static void
+filter_row (guchar        filter,
+            const guchar *row,
+            const guchar *prev_row,
+            gsize         rowbytes,
+            guint         bpp,
+            guchar       *out)
+{
+        gsize i;
+
+        *out++ = filter;
+
+        switch (filter) {
+        case PNG_FILTER_VALUE_NONE:
+                memcpy (out, row, rowbytes);
+                break;
+        case PNG_FILTER_VALUE_SUB:
+                for (i = 0; i < bpp; i++)
+                        out[i] = row[i];
+                for (; i < rowbytes; i++)
+                        out[i] = row[i] - row[i - bpp];
+                break;
+        case PNG_FILTER_VALUE_UP:
+                for (i = 0; i < rowbytes; i++)
+                        out[i] = row[i] - prev_row[i];
+                break;
+        case PNG_FILTER_VALUE_AVG:
+                for (i = 0; i < bpp; i++)
+                        out[i] = row[i] - (prev_row[i] >> 1);
+                for (; i < rowbytes; i++)
+                        out[i] = row[i] - ((row[i - bpp] + prev_row[i]) >> 1);
+                break;
+        case PNG_FILTER_VALUE_PAETH:
+                for (i = 0; i < bpp; i++)
+                        out[i] = row[i] - prev_row[i];
+                for (; i < rowbytes; i++)
+                        out[i] = row[i] - paeth_predictor (row[i - bpp], prev_row[i], prev_row[i - bpp]);
+                break;
+        }
+}
+
+/* Sum of the filtered bytes taken as signed values, the same heuristic
+ * libpng uses to choose the filter of every row.
+ */
+static guint
+filter_row_cost (const guchar *filtered,
+                 gsize         rowbytes)
+{
+        guint cost = 0;
+        gsize i;
+
+        for (i = 0; i < rowbytes; i++)
+                cost += filtered[i] < 128 ? filtered[i] : 256 - filtered[i];
+
+        return cost;
+}
+
+static void
+gxps_png_writer_filter_row (GXPSPngWriter *png_writer,
+                            guchar        *out)
+{
+        guint best_cost = G_MAXUINT;
+        guchar filter;
+
+        switch (png_writer->filter) {
+        case GXPS_PNG_FILTER_NONE:
+                filter_row (PNG_FILTER_VALUE_NONE, png_writer->row, png_writer->prev_row,
+                            png_writer->rowbytes, png_writer->bpp, out);
+                return;
+        case GXPS_PNG_FILTER_SUB:
+                filter_row (PNG_FILTER_VALUE_SUB, png_writer->row, png_writer->prev_row,
+                            png_writer->rowbytes, png_writer->bpp, out);
+                return;
+        case GXPS_PNG_FILTER_UP:
+                filter_row (PNG_FILTER_VALUE_UP, png_writer->row, png_writer->prev_row,
+                            png_writer->rowbytes, png_writer->bpp, out);
+                return;
+        case GXPS_PNG_FILTER_AVERAGE:
+                filter_row (PNG_FILTER_VALUE_AVG, png_writer->row, png_writer->prev_row,
+                            png_writer->rowbytes, png_writer->bpp, out);
+                return;
+        case GXPS_PNG_FILTER_PAETH:
+                filter_row (PNG_FILTER_VALUE_PAETH, png_writer->row, png_writer->prev_row,
+                            png_writer->rowbytes, png_writer->bpp, out);
+                return;
+        case GXPS_PNG_FILTER_ADAPTIVE:
+                break;
+        }
+
+        for (filter = PNG_FILTER_VALUE_NONE; filter <= PNG_FILTER_VALUE_PAETH; filter++) {
+                guint cost;
+
+                filter_row (filter, png_writer->row, png_writer->prev_row,
+                            png_writer->rowbytes, png_writer->bpp, png_writer->scratch);
+                cost = filter_row_cost (png_writer->scratch + 1, png_writer->rowbytes);
+                if (cost < best_cost) {
+                        memcpy (out, png_writer->scratch, png_writer->rowbytes + 1);
+                        best_cost = cost;
+                }
+        }
+}
+
+/* Runs in the thread pool. Every block is a raw deflate stream ended
+ * with a sync flush, so that the blocks can be concatenated; the first
+ * one starts with the zlib header and the last one finishes the stream.
+ */
+static void
+gxps_png_writer_compress_block (gpointer data,
+                                gpointer user_data)
+{
+        GXPSPngBlock  *block = (GXPSPngBlock *)data;
+        GXPSPngWriter *png_writer = GXPS_PNG_WRITER (user_data);
+        gint           level = png_writer->compression_level;
+        gint           flush = block->last ? Z_FINISH : Z_SYNC_FLUSH;
+        z_stream       stream;
+        gsize          size;
+        gint           status;
+
+        block->adler = adler32 (adler32 (0L, Z_NULL, 0), block->data, block->data_len);
+
+        memset (&stream, 0, sizeof (z_stream));
+        status = deflateInit2 (&stream, level, Z_DEFLATED, -MAX_WBITS, 8, png_writer->strategy);
+        if (status == Z_OK && block->dict_len > 0)
+                status = deflateSetDictionary (&stream, block->dict, block->dict_len);
+
+        if (status == Z_OK) {
+                /* Leave room for the zlib header, the sync flush marker
+                 * and the adler32 trailer.
+                 */
+                size = deflateBound (&stream, block->data_len) + 16;
+                block->output = g_malloc (size);
+
+                if (block->first) {
+                        guint flevel = level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3;
+                        guint header = (0x78 << 8) | (flevel << 6);
+
+                        header += 31 - (header % 31);
+                        block->output[0] = header >> 8;
+                        block->output[1] = header & 0xff;
+                        block->output_len = 2;
+                }
+
+                stream.next_in = block->data;
+                stream.avail_in = block->data_len;
+                do {
+                        if (block->output_len + 4 >= size) {
+                                size *= 2;
+                                block->output = g_realloc (block->output, size);
+                        }
+                        stream.next_out = block->output + block->output_len;
+                        stream.avail_out = size - block->output_len - 4;
+                        status = deflate (&stream, flush);
+                        block->output_len = size - 4 - stream.avail_out;
+                } while (status == Z_OK && (flush == Z_FINISH || stream.avail_out == 0));
+
+                /* A sync flush that ended exactly at the end of the
+                 * buffer makes the next call fail with Z_BUF_ERROR.
+                 */
+                if (flush == Z_FINISH)
+                        block->failed = status != Z_STREAM_END;
+                else
+                        block->failed = status != Z_OK && status != Z_BUF_ERROR;
+
+                deflateEnd (&stream);
+        } else {
+                block->failed = TRUE;
+        }
+
+        g_mutex_lock (&png_writer->mutex);
+        block->done = TRUE;
+        g_cond_broadcast (&png_writer->cond);
+        g_mutex_unlock (&png_writer->mutex);
+}
+
+/* Writes the oldest block submitted, waiting for it to be compressed */
+static gboolean
+gxps_png_writer_write_next_block (GXPSPngWriter *png_writer)
+{
+        GXPSPngBlock *block;
+
+        block = g_queue_pop_head (png_writer->blocks);
 
-        for (i = 0; i < row_info->rowbytes; i += 4) {
-                uint8_t *b = &data[i];
-                uint32_t pixel;
+        g_mutex_lock (&png_writer->mutex);
+        while (!block->done)
+                g_cond_wait (&png_writer->cond, &png_writer->mutex);
+        g_mutex_unlock (&png_writer->mutex);
 
-                memcpy (&pixel, b, sizeof (uint32_t));
+        if (block->failed) {
+                g_printerr ("Error writing png: error compressing image data\n");
+                gxps_png_block_free (block);
+                return FALSE;
+        }
+
+        if (block->first)
+                png_writer->adler = block->adler;
+        else
+                png_writer->adler = adler32_combine (png_writer->adler, block->adler, block->data_len);
+
+        if (block->last) {
+                guchar *trailer = block->output + block->output_len;
+
+                trailer[0] = (png_writer->adler >> 24) & 0xff;
+                trailer[1] = (png_writer->adler >> 16) & 0xff;
+                trailer[2] = (png_writer->adler >> 8) & 0xff;
+                trailer[3] = png_writer->adler & 0xff;
+                block->output_len += 4;
+        }
 
-                b[0] = (pixel & 0xff0000) >> 16;
-                b[1] = (pixel & 0x00ff00) >>  8;
-                b[2] = (pixel & 0x0000ff) >>  0;
-                b[3] = 0;
+        if (setjmp (png_jmpbuf (png_writer->png_ptr))) {
+                g_printerr ("Error writing png: error during png data write\n");
+                gxps_png_block_free (block);
+                return FALSE;
         }
+        png_write_chunk (png_writer->png_ptr, png_IDAT, block->output, block->output_len);
+
+        gxps_png_block_free (block);
+
+        return TRUE;
+}
+
+static void
+gxps_png_writer_update_dict (GXPSPngWriter *png_writer,
+                             const guchar  *data,
+                             gsize          len)
+{
+        gsize keep;
+
+        if (len >= DICT_SIZE) {
+                memcpy (png_writer->dict, data + len - DICT_SIZE, DICT_SIZE);
+                png_writer->dict_len = DICT_SIZE;
+
+                return;
+        }
+
+        keep = MIN (png_writer->dict_len, DICT_SIZE - len);
+        memmove (png_writer->dict, png_writer->dict + png_writer->dict_len - keep, keep);
+        memcpy (png_writer->dict + keep, data, len);
+        png_writer->dict_len = keep + len;
+}
+
+static gboolean
+gxps_png_writer_submit_block (GXPSPngWriter *png_writer)
+{
+        GXPSPngBlock *block = png_writer->block;
+
+        png_writer->block = NULL;
+
+        block->first = png_writer->n_blocks++ == 0;
+        block->last = png_writer->rows_left == 0;
+        memcpy (block->dict, png_writer->dict, png_writer->dict_len);
+        block->dict_len = png_writer->dict_len;
+        gxps_png_writer_update_dict (png_writer, block->data, block->data_len);
+
+        g_queue_push_tail (png_writer->blocks, block);
+        g_thread_pool_push (png_writer->pool, block, NULL);
+
+        /* Keep every thread busy without buffering the whole image */
+        while (g_queue_get_length (png_writer->blocks) > 2 * png_writer->n_threads) {
+                if (!gxps_png_writer_write_next_block (png_writer))
+                        return FALSE;
+        }
+
+        return TRUE;
+}
+
+static gboolean
+gxps_png_writer_write_parallel (GXPSPngWriter *png_writer,
+                                guchar        *row)
+{
+        GXPSPngBlock *block;
+        guchar       *tmp;
+
+        if (png_writer->rows_left == 0) {
+                g_printerr ("Error writing png: too many rows\n");
+                return FALSE;
+        }
+
+        switch (png_writer->format) {
+        case GXPS_PNG_FORMAT_RGB:
+                convert_data_to_rgb (png_writer->row, (guint32 *)row, png_writer->rowbytes / 3);
+                break;
+        case GXPS_PNG_FORMAT_RGBA:
+                gxps_pixels_unpremultiply_rgba (png_writer->row, (guint32 *)row, png_writer->rowbytes / 4);
+                break;
+        }
+
+        if (!png_writer->block)
+                png_writer->block = gxps_png_block_new (png_writer->block_size);
+        block = png_writer->block;
+
+        gxps_png_writer_filter_row (png_writer, block->data + block->data_len);
+        block->data_len += png_writer->rowbytes + 1;
+
+        tmp = png_writer->prev_row;
+        png_writer->prev_row = png_writer->row;
+        png_writer->row = tmp;
+
+        png_writer->rows_left--;
+        if (png_writer->rows_left == 0 || block->data_len + png_writer->rowbytes + 1 > png_writer->block_size)
+                return gxps_png_writer_submit_block (png_writer);
+
+        return TRUE;
+}
+
+static void
+gxps_png_writer_init_parallel (GXPSPngWriter *png_writer,
+                               guint          width,
+                               guint          height)
+{
+        gxps_png_writer_reset (png_writer);
+
+        if (!png_writer->pool) {
+                png_writer->pool = g_thread_pool_new (gxps_png_writer_compress_block,
+                                                      png_writer,
+                                                      png_writer->n_threads,
+                                                      FALSE, NULL);
+                png_writer->blocks = g_queue_new ();
+        }
+
+        png_writer->bpp = png_writer->format == GXPS_PNG_FORMAT_RGB ? 3 : 4;
+        png_writer->rowbytes = (gsize)width * png_writer->bpp;
+        png_writer->row = g_malloc (png_writer->rowbytes);
+        png_writer->prev_row = g_malloc0 (png_writer->rowbytes);
+        png_writer->scratch = g_malloc (png_writer->rowbytes + 1);
+        png_writer->block_size = MAX (1, BLOCK_SIZE / (png_writer->rowbytes + 1)) * (png_writer->rowbytes + 1);
+        png_writer->n_blocks = 0;
+        png_writer->dict_len = 0;
+        png_writer->rows_left = height;
+}
+
+static gint
+gxps_png_writer_get_filters (GXPSPngWriter *png_writer)
+{
+        switch (png_writer->filter) {
+        case GXPS_PNG_FILTER_NONE:
+                return PNG_FILTER_NONE;
+        case GXPS_PNG_FILTER_SUB:
+                return PNG_FILTER_SUB;
+        case GXPS_PNG_FILTER_UP:
+                return PNG_FILTER_UP;
+        case GXPS_PNG_FILTER_AVERAGE:
+                return PNG_FILTER_AVG;
+        case GXPS_PNG_FILTER_PAETH:
+                return PNG_FILTER_PAETH;
+        case GXPS_PNG_FILTER_ADAPTIVE:
+                break;
+        }
+
+        return PNG_ALL_FILTERS;
+}
+
+static gboolean
+gxps_png_writer_finish_parallel (GXPSPngWriter *png_writer)
+{
+        gboolean retval = TRUE;
+
+        if (png_writer->rows_left > 0) {
+                g_printerr ("Error finishing png: %u rows missing\n", png_writer->rows_left);
+                retval = FALSE;
+        }
+
+        /* An image without rows still needs an IDAT chunk, with an
+         * empty zlib stream.
+         */
+        if (retval && png_writer->n_blocks == 0) {
+                png_writer->block = gxps_png_block_new (png_writer->block_size);
+                retval = gxps_png_writer_submit_block (png_writer);
+        }
+
+        while (retval && !g_queue_is_empty (png_writer->blocks))
+                retval = gxps_png_writer_write_next_block (png_writer);
+
+        gxps_png_writer_reset (png_writer);
+        if (!retval)
+                return FALSE;
+
+        if (setjmp (png_jmpbuf (png_writer->png_ptr))) {
+                g_printerr ("Error finishing png: error during end of write\n");
+                return FALSE;
+        }
+        png_write_chunk (png_writer->png_ptr, png_IEND, NULL, 0);
+
+        png_destroy_write_struct (&png_writer->png_ptr, &png_writer->info_ptr);
+
+        return TRUE;
 }
 
 static gboolean
@@ -145,7 +703,9 @@ gxps_png_writer_image_writer_init (GXPSImageWriter *image_writer,
                 return FALSE;
         }
 
-        png_set_compression_level (png_writer->png_ptr, Z_BEST_COMPRESSION);
+        png_set_compression_level (png_writer->png_ptr, png_writer->compression_level);
+        png_set_compression_strategy (png_writer->png_ptr, png_writer->strategy);
+        png_set_filter (png_writer->png_ptr, PNG_FILTER_TYPE_BASE, gxps_png_writer_get_filters (png_writer));
 
         png_set_IHDR (png_writer->png_ptr, png_writer->info_ptr,
                       width, height, 8,
@@ -164,6 +724,12 @@ gxps_png_writer_image_writer_init (GXPSImageWriter *image_writer,
                 return FALSE;
         }
 
+        if (png_writer->n_threads > 1) {
+                gxps_png_writer_init_parallel (png_writer, width, height);
+
+                return TRUE;
+        }
+
         switch (png_writer->format) {
         case GXPS_PNG_FORMAT_RGB:
                 png_set_write_user_transform_fn (png_writer->png_ptr, convert_data_to_bytes);
@@ -185,6 +751,9 @@ gxps_png_writer_image_writer_write (GXPSImageWriter *image_writer,
 {
         GXPSPngWriter *png_writer = GXPS_PNG_WRITER (image_writer);
 
+        if (png_writer->row)
+                return gxps_png_writer_write_parallel (png_writer, row);
+
         png_write_rows (png_writer->png_ptr, &row, 1);
         if (setjmp (png_jmpbuf (png_writer->png_ptr))) {
                 g_printerr ("Error writing png: error during png row write\n");
@@ -199,6 +768,9 @@ gxps_png_writer_image_writer_finish (GXPSImageWriter *image_writer)
 {
         GXPSPngWriter *png_writer = GXPS_PNG_WRITER (image_writer);
 
+        if (png_writer->row)
+                return gxps_png_writer_finish_parallel (png_writer);
+
         png_write_end (png_writer->png_ptr, png_writer->info_ptr);
         if (setjmp (png_jmpbuf (png_writer->png_ptr))) {
                 g_printerr ("Error finishing png: error during end of write\n");
@@ -37,11 +37,33 @@ typedef enum {
         GXPS_PNG_FORMAT_RGBA
 } GXPSPngFormat;
 
+typedef enum {
+        GXPS_PNG_FILTER_NONE,
+        GXPS_PNG_FILTER_SUB,
+        GXPS_PNG_FILTER_UP,
+        GXPS_PNG_FILTER_AVERAGE,
+        GXPS_PNG_FILTER_PAETH,
+        GXPS_PNG_FILTER_ADAPTIVE
+} GXPSPngFilter;
+
+typedef enum {
+        GXPS_PNG_STRATEGY_DEFAULT,
+        GXPS_PNG_STRATEGY_FILTERED,
+        GXPS_PNG_STRATEGY_RLE,
+        GXPS_PNG_STRATEGY_HUFFMAN_ONLY
+} GXPSPngStrategy;
+
 typedef struct _GXPSPngWriter        GXPSPngWriter;
 typedef struct _GXPSPngWriterClass   GXPSPngWriterClass;
 
-GType            gxps_png_writer_get_type (void);
-GXPSImageWriter *gxps_png_writer_new      (GXPSPngFormat format);
+GType            gxps_png_writer_get_type        (void);
+GXPSImageWriter *gxps_png_writer_new             (GXPSPngFormat  format);
+void             gxps_png_writer_set_compression (GXPSPngWriter  *png_writer,
+                                                  gint            level,
+                                                  GXPSPngFilter   filter,
+                                                  GXPSPngStrategy strategy);
+void             gxps_png_writer_set_n_threads   (GXPSPngWriter  *png_writer,
+                                                  guint           n_threads);
 
 
 G_END_DECLS